@@ -0,0 +1,44 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <stdint.h>
+
+class Benchmark
+{
+   public:
+      typedef uint32_t (*TickSource)(void);
+
+      struct Result
+      {
+         const char* name;
+         uint32_t calls;
+         uint32_t total; //whole sweep in ticks
+         uint32_t min;
+         uint32_t max;
+      };
+
+      enum { BENCH_SOCFROMVOLTAGE, BENCH_SOCINTEGRATION, BENCH_CHARGECURRENT, BENCH_LIMITMINVOLTAGE,
+             BENCH_LOWTEMPDERATING, BENCH_HIGHTEMPDERATING, BENCH_ADCTOTEMP, BENCH_TEMPLOOKUP, BENCH_LAST };
+
+      static void Run(Result results[BENCH_LAST], TickSource ticks);
+};
+
+#endif // BENCHMARK_H
@@ -21,25 +21,43 @@
 
 #include <stdint.h>
 #include "picontroller.h"
+#include "deratingcurve.h"
 
 class BmsAlgo
 {
    public:
+      enum Derating { DRT_CHARGE_LOWTEMP, DRT_CHARGE_HIGHTEMP, DRT_DISCHARGE_HIGHTEMP, DRT_DISCHARGE_LOWVOLT, DRT_LAST };
+
       static float EstimateSocFromVoltage(float lowestVoltage);
       static float CalculateSocFromIntegration(float lastSoc, float asDiff);
       static float CalculateSoH(float lastSoc, float newSoc, float asDiff);
       static float GetChargeCurrent(float maxCellVoltage);
-      static float LimitMinimumCellVoltage(float minVoltage, float limit);
-      static float LowTemperatureDerating(float lowTemp);
-      static float HighTemperatureDerating(float highTemp, float maxTemp);
+      static float GetDerating(Derating curve, float x);
+      static bool SetDeratingCurve(Derating curve, const float* x, const float* factor, int n);
       static void SetNominalCapacity(float c) { nominalCapacity = c; }
       static void SetSocLookupPoint(uint8_t soc, uint16_t voltage);
       static void SetCCCVCurve(uint8_t idx, float current, uint16_t voltage);
+      static void SetThermalModel(float resistance, float rth, float tau, float horizon);
+      static float EstimateResistance(float voltage, float current);
+      static float UpdateCoreTemperature(float current, float sensorTemp);
+      static float PredictCoreTemperature(float current, float sensorTemp);
+      static void ResetThermalModel();
 
    private:
       static float nominalCapacity;
       static uint16_t voltageToSoc[11];
       static PiController cvControllers[3]; //Support 3 consecutive CC/CV curves
+      static DeratingCurve deratingCurves[DRT_LAST];
+      static float GetHeatingRise(float current);
+
+      static float cellResistance; //mOhm, 0 = use estimatedResistance
+      static float estimatedResistance; //mOhm
+      static float thermalResistance; //K/W core to sensor
+      static float timeConstant; //s
+      static float horizonDecay; //exp(-horizon / timeConstant)
+      static float coreRise; //core temperature above sensor
+      static float refVoltage, refCurrent, stepCurrent;
+      static uint8_t settleCount;
 };
 
 #endif // BMSALGO_H
@@ -34,6 +34,7 @@ class BmsFsm: public CanCallback
       bmsstate Run(bmsstate currentState);
       int GetNumberOfModules() { return numModules; }
       uint8_t GetCellsOfModule(uint8_t mod) { return numChan[mod]; }
+      uint8_t GetIndex() { return ourIndex; }
       Param::PARAM_NUM GetDataItem(Param::PARAM_NUM baseItem, int modNum = -1);
       void HandleRx(uint32_t canId, uint32_t data[2], uint8_t);
       void HandleClear();
@@ -57,6 +58,7 @@ class BmsFsm: public CanCallback
       uint8_t infoIndex;
       uint8_t numModules;
       uint32_t cycles;
+      uint32_t idleSince;
       uint8_t numChan[MAX_SUB_MODULES + 1]; //sub modules plus one master module
 };
 
@@ -21,22 +21,38 @@
 
 #include "bmsfsm.h"
 #include "flyingadcbms.h"
+#include "tempsensor.h"
 
 #define NO_TEMP    128
+#define MAX_TEMP_MUX 8
 
 
 class BmsIO
 {
    public:
+      static void SampleTemperatures();
+      static void ConfigureTempMux(int channels);
       static void ReadTemperatures();
       static void ReadCellVoltages();
       static void TestReadCellVoltage(int chan, FlyingAdcBms::BalanceCommand cmd);
       static void MeasureCurrent();
+      static void CalculateSocSoh(BmsFsm::bmsstate stt, BmsFsm::bmsstate laststt);
+      static void LoadNVRAM();
       static void SetBmsFsm(BmsFsm* b) { bmsFsm = b; }
+      static bool IsBalancingWanted();
+      /** \brief True when the next call of ReadCellVoltages() reads channel 0 */
+      static bool IsSweepStart() { return chan == 0; }
 
    private:
       static void Accumulate(float sum, float min, float max, float avg);
+      static void AddTemperature(float temp, float& tempmin, float& tempmax);
+      static void SelectTempMux(int channel);
       static BmsFsm* bmsFsm;
+      static uint8_t chan;
+      static TempSensor tempSensor1;
+      static TempSensor tempSensor2;
+      static TempSensor muxSensors[MAX_TEMP_MUX];
+      static uint8_t muxChan;
 };
 
 #endif // BMSIO_H
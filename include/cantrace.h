@@ -0,0 +1,92 @@
+/*
+ * This file is part of the FlyingADCBMS project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CANTRACE_H
+#define CANTRACE_H
+
+#include <stdint.h>
+#include "canhardware.h"
+#include "cansdo.h"
+#include "counters.h"
+
+#ifndef CANTRACE_ENTRIES
+#define CANTRACE_ENTRIES     128 //16 bytes each
+#endif
+
+#define SDO_INDEX_CANTRACE   0x5100
+#define SDO_CANTRACE_MODE    0 //r/w, see CanTrace::Mode
+#define SDO_CANTRACE_COUNT   1 //r, number of valid entries
+#define SDO_CANTRACE_SELECT  2 //r/w, entry to read, 0 is the oldest
+#define SDO_CANTRACE_TIME    3 //r, bits 0-27 ms, bits 28-31 dlc
+#define SDO_CANTRACE_ID      4 //r, bits 0-28 id, bit 31 set for sent frames
+#define SDO_CANTRACE_DATA0   5 //r, data bytes 0-3
+#define SDO_CANTRACE_DATA1   6 //r, data bytes 4-7, advances to next entry
+
+/** \brief Records sent and received CAN frames to a RAM ring buffer
+ *
+ * Received frames are picked up by a callback on the CAN interface, sent
+ * frames by wrapping the interface in TracedCan. The buffer is read out
+ * entry by entry via SDO, see SDO_INDEX_CANTRACE.
+ */
+class CanTrace
+{
+   public:
+      enum Mode { STOPPED, RING, ONESHOT };
+
+      struct Entry
+      {
+         uint32_t time;
+         uint32_t id;
+         uint32_t data[2];
+      };
+
+      static const uint32_t FLAG_TX = 1u << 31;
+      static const uint32_t TIME_MASK = 0x0FFFFFFF;
+
+      static void Attach(CanHardware* hw);
+      static void SetMode(Mode m);
+      static Mode GetMode() { return mode; }
+      static void Record(uint32_t canId, const uint32_t data[2], uint8_t dlc, bool tx);
+      static int GetCount();
+      static const Entry* GetEntry(int index);
+      static bool ProcessSdo(CanSdo::SdoFrame* sdoFrame);
+
+   private:
+      static Entry buffer[CANTRACE_ENTRIES];
+      static volatile uint32_t head;
+      static volatile Mode mode;
+      static uint32_t selected;
+};
+
+/** \brief Wraps a CAN driver so that everything it sends ends up in the trace */
+template <class Hw>
+class TracedCan: public Hw
+{
+   public:
+      using Hw::Hw;
+      using CanHardware::Send;
+
+      void Send(uint32_t canId, uint32_t data[2], uint8_t len) override
+      {
+         CanTrace::Record(canId, data, len, true);
+         Counters::Increment(Counters::CNT_CAN_TX);
+         Hw::Send(canId, data, len);
+      }
+};
+
+#endif // CANTRACE_H
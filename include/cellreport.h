@@ -0,0 +1,92 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CELLREPORT_H
+#define CELLREPORT_H
+
+#include <stdint.h>
+#include "cansdo.h"
+#include "bmsfsm.h"
+
+#define SDO_INDEX_CELLS       0x5102
+#define SDO_CELLS_COUNT       0 //r, takes a new snapshot and returns its number of cells
+#define SDO_CELLS_BALANCE     1 //r, balancer states of the snapshot, 2 bits per channel
+#define SDO_CELLS_VOLTAGE     2 //r, 2 to 9: two cells of the snapshot in mV, lower channel in bits 0-15
+
+/** \brief Consistent snapshots of cell voltages and pack values for bulk output
+ *
+ * The values are copied with interrupts disabled, so that a snapshot never
+ * mixes two runs of the scheduler tasks. Each module only knows its own cell
+ * voltages. The main module reads those of the sub modules via SDO from
+ * SDO_INDEX_CELLS, where every module serves a snapshot it takes when
+ * SDO_CELLS_COUNT is read. A remote read yields to the other main loop work
+ * while it waits for the replies. Only a reply from the asked node to the
+ * asked sub index is taken, so late or foreign replies can't shift the cells.
+ */
+class CellReport
+{
+   public:
+      enum { MAX_CELLS = 16, MAX_MODULES = MAX_SUB_MODULES + 1, TIMEOUT_MS = 50 };
+
+      struct Module
+      {
+         uint8_t cells;
+         uint32_t balance; //2 bits per channel, FlyingAdcBms::BalanceCommand
+         uint16_t voltage[MAX_CELLS];
+      };
+
+      struct ModuleSummary
+      {
+         float umin, umax, uavg, tempmin, tempmax; //umax 0 when unknown
+         uint8_t tempflt;
+      };
+
+      struct Pack
+      {
+         float utotal, uavg, umin, umax, udelta;
+         float idc, idcavg, power, soc, soh, chargelim, dischargelim;
+         float tempmin, tempmax;
+         uint8_t opmode, protlevel, cells;
+         uint8_t firstModule, modules; //modules[0] is module number firstModule
+         uint8_t uminModule, umaxModule, tempminModule, tempmaxModule; //index into modules, 0xFF when unknown
+         ModuleSummary module[MAX_MODULES];
+      };
+
+      static void SetBmsFsm(BmsFsm* b) { bmsFsm = b; }
+      static void SetSdo(CanSdo* s) { canSdo = s; }
+      static void TakeLocal(Module& m);
+      static bool TakeModule(int module, Module& m);
+      static void TakePack(Pack& p);
+      static bool ProcessSdo(CanSdo::SdoFrame* sdoFrame);
+      static void Attach(CanHardware* hw);
+      static void HandleReply(uint32_t canId, const uint32_t data[2]);
+
+   private:
+      static void SummarizeRemote(int module, ModuleSummary& s);
+      static bool ReadRemote(uint8_t node, uint8_t subIndex, uint32_t& value);
+
+      static Module latched;
+      static BmsFsm* bmsFsm;
+      static CanSdo* canSdo;
+      static volatile uint32_t replyId;
+      static volatile uint8_t replySubIndex;
+      static volatile uint32_t replyValue;
+      static volatile uint8_t replyCmd;
+};
+
+#endif // CELLREPORT_H
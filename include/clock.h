@@ -0,0 +1,39 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+
+/** \brief Millisecond time base shared by all modules
+ *
+ * main installs a source that keeps counting in STOP mode, the tests install
+ * a fake one. Without a source the time stays at 0.
+ */
+class Clock
+{
+   public:
+      static void SetSource(uint32_t (*msSource)()) { source = msSource; }
+      static uint32_t GetMs() { return source ? source() : 0; }
+
+   private:
+      static uint32_t (*source)();
+};
+
+#endif // CLOCK_H
@@ -0,0 +1,80 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include <stdint.h>
+#include "cansdo.h"
+
+#define SDO_INDEX_COUNTERS    0x5103
+#define SDO_COUNTERS_NUM      0 //r: number of counters, w: resets the counters, gauges stay
+#define SDO_COUNTERS_FIRST    1 //r, 1 to number of counters: value of each entry in COUNTER_LIST order
+
+/* Every subsystem adds its entries here. The order is the SDO sub index,
+ * so append new entries at the end and don't reorder.
+ * COUNTER entries only count up, GAUGE entries hold the last or largest value
+ */
+#define COUNTER_LIST \
+   COUNTER_ENTRY(CNT_CAN_TX,          "cantx",        COUNTER) \
+   COUNTER_ENTRY(CNT_CAN_RX,          "canrx",        COUNTER) \
+   COUNTER_ENTRY(CNT_CAN_RX_OVERRUN,  "canrxovr",     COUNTER) \
+   COUNTER_ENTRY(CNT_CAN_BUSOFF,      "canbusoff",    COUNTER) \
+   COUNTER_ENTRY(CNT_CAN_TX_ERRORS,   "cantec",       GAUGE  ) \
+   COUNTER_ENTRY(CNT_CAN_RX_ERRORS,   "canrec",       GAUGE  ) \
+   COUNTER_ENTRY(CNT_I2C_XFER,        "i2cxfer",      COUNTER) \
+   COUNTER_ENTRY(CNT_I2C_COLLISION,   "i2ccollision", COUNTER) \
+   COUNTER_ENTRY(CNT_SWEEPS,          "sweeps",       COUNTER) \
+   COUNTER_ENTRY(CNT_SWEEP_MS,        "sweepms",      GAUGE  ) \
+   COUNTER_ENTRY(CNT_SWEEP_MS_MAX,    "sweepmsmax",   GAUGE  ) \
+   COUNTER_ENTRY(CNT_SDO_REQUESTS,    "sdoreq",       COUNTER) \
+   COUNTER_ENTRY(CNT_SDO_LATENCY_US,  "sdolatus",     GAUGE  ) \
+   COUNTER_ENTRY(CNT_SDO_LATENCY_MAX, "sdolatusmax",  GAUGE  ) \
+   COUNTER_ENTRY(CNT_ISR_OVERRUNS,    "isroverrun",   COUNTER) \
+   COUNTER_ENTRY(CNT_JOB_DROPS,       "jobdrop",      COUNTER)
+
+/** \brief Registry of 32 bit counters and gauges for health monitoring
+ *
+ * Counters are incremented from any context with an atomic add, so the hot
+ * paths take no lock. Gauges are plain stores or an atomic maximum. The
+ * whole set is read via SDO_INDEX_COUNTERS or with the "counters" terminal
+ * command. Counters wrap around at 2^32, readers look at differences.
+ */
+class Counters
+{
+   public:
+      #define COUNTER_ENTRY(id, name, kind) id,
+      enum Id { COUNTER_LIST CNT_LAST };
+      #undef COUNTER_ENTRY
+
+      enum Kind { COUNTER, GAUGE };
+
+      static void Increment(Id id) { __atomic_fetch_add(&values[id], 1, __ATOMIC_RELAXED); }
+      static void Set(Id id, uint32_t value) { values[id] = value; }
+      static void Max(Id id, uint32_t value);
+      static uint32_t Get(Id id) { return values[id]; }
+      static const char* GetName(Id id);
+      static Kind GetKind(Id id);
+      static void Reset();
+      static bool ProcessSdo(CanSdo::SdoFrame* sdoFrame);
+
+   private:
+      static volatile uint32_t values[CNT_LAST];
+};
+
+#endif // COUNTERS_H
@@ -0,0 +1,48 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef DERATINGCURVE_H
+#define DERATINGCURVE_H
+
+#include <stdint.h>
+
+/** \brief Piecewise linear curve through up to MAX_POINTS points
+ *
+ * The x values must be strictly increasing. The slope of each segment is
+ * calculated when the curve is loaded, so a lookup is a bounded walk over at
+ * most MAX_POINTS - 1 segments plus one multiply-add. Below the first and above
+ * the last point the curve is flat. An empty curve returns 1, i.e. no derating.
+ */
+class DeratingCurve
+{
+   public:
+      static const int MAX_POINTS = 4;
+
+      DeratingCurve(): numPoints(0) {}
+      DeratingCurve(const float* x, const float* y, int n);
+      bool Load(const float* x, const float* y, int n);
+      float Get(float x) const;
+
+   private:
+      uint8_t numPoints;
+      float xs[MAX_POINTS];
+      float ys[MAX_POINTS];
+      float slopes[MAX_POINTS - 1];
+};
+
+#endif // DERATINGCURVE_H
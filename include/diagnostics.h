@@ -0,0 +1,65 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <stdint.h>
+#include "errormessage.h"
+
+/** \brief Background integrity checks while the pack is in use
+ *
+ * Every diagint seconds a round of checks takes a few 25 ms slots of the
+ * cell voltage scan, always between two sweeps. The self tests only run
+ * once at power up, this catches a mux short or a dead balancer that
+ * appears while driving. The open-wire check visits one channel per
+ * round. Failures are posted as errors but measurement carries on.
+ */
+class Diagnostics
+{
+   public:
+      static bool Run(bool sweepStart);
+      static void Reset();
+      static bool IsActive() { return check >= 0; }
+
+   private:
+      enum CheckResult { CheckOngoing, CheckPassed, CheckFailed };
+      typedef CheckResult (*CheckFunction)(int cycle);
+
+      struct Check
+      {
+         CheckFunction run;
+         ERROR_MESSAGE_NUM error;
+      };
+
+      static CheckResult CheckBalancer(int cycle);
+      static CheckResult CheckMuxOff(int cycle);
+      static CheckResult CheckOpenWire(int cycle);
+      static void Evaluate(int index, CheckResult result);
+
+      static const Check checks[];
+      static uint8_t failCount[];
+      static int check;
+      static int cycle;
+      static int errInfo;
+      static uint8_t openWireChannel;
+      static bool openWireCharge;
+      static uint32_t slotsSinceRound;
+};
+
+#endif // DIAGNOSTICS_H
@@ -15,5 +15,8 @@
     DIG_IO_ENTRY(nextena_out,GPIOA, GPIO9,   PinMode::OUTPUT)      \
     DIG_IO_ENTRY(selfena_out,GPIOA, GPIO8,   PinMode::OUTPUT)      \
     DIG_IO_ENTRY(led_out,    GPIOA, GPIO5,   PinMode::OUTPUT)      \
+    DIG_IO_ENTRY(tmux_a0,    GPIOB, GPIO12,  PinMode::INPUT_FLT)   \
+    DIG_IO_ENTRY(tmux_a1,    GPIOA, GPIO15,  PinMode::INPUT_FLT)   \
+    DIG_IO_ENTRY(tmux_a2,    GPIOB, GPIO8,   PinMode::INPUT_FLT)   \
 
 #endif // PinMode_PRJ_H_INCLUDED
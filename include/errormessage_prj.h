@@ -8,5 +8,11 @@
    ERROR_MESSAGE_ENTRY(BALANCER_FAIL, ERROR_STOP) \
    ERROR_MESSAGE_ENTRY(CELL_POLARITY, ERROR_STOP) \
    ERROR_MESSAGE_ENTRY(CELL_OVERVOLTAGE, ERROR_STOP) \
+   ERROR_MESSAGE_ENTRY(OPENWIRE, ERROR_STOP) \
+   ERROR_MESSAGE_ENTRY(CELL_UNDERVOLTAGE, ERROR_STOP) \
+   ERROR_MESSAGE_ENTRY(CELL_DELTA, ERROR_STOP) \
+   ERROR_MESSAGE_ENTRY(OVERTEMP, ERROR_STOP) \
+   ERROR_MESSAGE_ENTRY(UNDERTEMP, ERROR_STOP) \
+   ERROR_MESSAGE_ENTRY(OVERCURRENT, ERROR_STOP) \
 
 #endif // ERRORMESSAGE_PRJ_H_INCLUDED
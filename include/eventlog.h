@@ -0,0 +1,118 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include <stdint.h>
+#include "cansdo.h"
+
+#ifndef EVENTLOG_RAM_ENTRIES
+#define EVENTLOG_RAM_ENTRIES  32 //8 bytes each
+#endif
+
+#define SDO_INDEX_EVENTLOG    0x5101
+#define SDO_EVENTLOG_COUNT    0 //r, number of stored events
+#define SDO_EVENTLOG_SELECT   1 //r/w, next matching event at or after this index, 0 is the oldest
+#define SDO_EVENTLOG_CODES    2 //r/w, bit n set shows events with code n, 0 shows all
+#define SDO_EVENTLOG_FROM     3 //r/w, only show events at or after this time in ms
+#define SDO_EVENTLOG_TIME     4 //r, time of selected event in ms since its boot
+#define SDO_EVENTLOG_DATA     5 //r, bits 0-7 code, 8-11 channel, 12-15 module, 16-31 value, advances
+#define SDO_EVENTLOG_CONTROL  6 //w, 1 flushes to flash, 2 clears the log
+
+#ifndef SDO_ERR_STATE
+#define SDO_ERR_STATE         0x08000022 //not possible in the present device state, e.g. clearing in RUN
+#endif
+
+/** \brief Timestamped log of state changes, faults and warnings
+ *
+ * Events are added to a RAM ring buffer from any context. A slot is claimed
+ * with a compare and swap so that interrupts don't tear each other's entries.
+ * When the ring is full new events are dropped and counted. The main loop
+ * copies the ring to a reserved flash page in batches. When the page is full
+ * it is erased and the newest KEEP_ON_WRAP events are written back. Erasing
+ * stalls all code running from flash, so while it is not allowed the full
+ * page is left alone and events wait in RAM. Time
+ * stamps restart at every boot, which is marked by an EVT_BOOT event.
+ */
+class EventLog
+{
+   public:
+      enum Code
+      {
+         EVT_NONE,         //marks an empty or unfinished slot
+         EVT_BOOT,         //value: hardware revision
+         EVT_STATE,        //channel: previous state, value: new state
+         EVT_ERROR,        //channel: error number, value: errinfo
+         EVT_PROTECTION,   //channel: Protection::Signal, value: new level
+         EVT_TEMPSENSOR,   //value: new tempflt bits
+         EVT_LAST
+      };
+
+      struct Entry
+      {
+         uint32_t time;
+         uint8_t code;
+         uint8_t source; //bits 0-3 channel, 4-7 module
+         int16_t value;
+      };
+
+      typedef void (*EraseFunc)();
+      typedef void (*ProgramFunc)(int slot, const Entry& e);
+
+      static const int FLUSH_BATCH = 8;
+      static const uint32_t FLUSH_DELAY_MS = 10000;
+      static const int KEEP_ON_WRAP = 32;
+
+      static void SetStorage(const Entry* area, int entries, EraseFunc eraseFunc, ProgramFunc programFunc);
+      static void SetModule(uint8_t module) { ourModule = module; }
+      static void SetEraseAllowed(bool allowed) { eraseAllowed = allowed; }
+      static bool Record(Code code, int channel, int value);
+      static bool NeedsFlush();
+      static void Flush();
+      static bool Clear();
+      static int GetCount();
+      static bool GetEntry(int index, Entry& e);
+      static int Find(int start, uint32_t codeMask, uint32_t fromTime);
+      static uint32_t GetDropped() { return dropped; }
+      static bool ProcessSdo(CanSdo::SdoFrame* sdoFrame);
+
+   private:
+      static bool IsValid(const Entry& e) { return e.code != EVT_NONE && e.code < EVT_LAST; }
+      static bool IsErased(const Entry& e) { return e.time == 0xFFFFFFFF && e.code == 0xFF; }
+      static bool MustWait() { return storageUsed >= storageSize && !eraseAllowed; }
+      static void Store(const Entry& e);
+
+      static Entry ring[EVENTLOG_RAM_ENTRIES];
+      static volatile uint32_t head;
+      static volatile uint32_t tail;
+      static volatile uint32_t dropped;
+      static volatile bool urgent;
+      static bool eraseAllowed;
+      static uint8_t ourModule;
+      static const Entry* storage;
+      static int storageSize;
+      static int storageUsed;
+      static EraseFunc erase;
+      static ProgramFunc program;
+      static uint32_t selected;
+      static uint32_t codeFilter;
+      static uint32_t timeFilter;
+};
+
+#endif // EVENTLOG_H
@@ -0,0 +1,58 @@
+/*
+ * This file is part of the FlyingADCBMS project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include <stdint.h>
+
+/** \brief Cooperative executor for the work done in the main loop
+ *
+ * Work items are posted as job functions and run in order. A long job like
+ * the parameter dump calls Yield() at convenient points, which checks for
+ * new events and runs the other pending jobs before it continues. This way
+ * SDO requests are answered while the dump is in progress.
+ */
+class Executor
+{
+   public:
+      /** \brief Returns true when finished, false to be run again later */
+      typedef bool (*Job)(void);
+
+      static void SetEventPoll(void (*poll)(void)) { eventPoll = poll; }
+      static bool Post(Job job);
+      static bool RunNext();
+      static void Yield();
+      static bool IsPending(Job job);
+      static void Clear();
+
+   private:
+      enum { MAX_JOBS = 8, MAX_NESTING = 4 };
+
+      static bool IsActive(Job job);
+      static bool Run(Job job);
+      static void Remove(int index);
+
+      static Job jobs[MAX_JOBS];
+      static int numJobs;
+      static Job active[MAX_NESTING];
+      static int nesting;
+      static void (*eventPoll)(void);
+};
+
+#endif // EXECUTOR_H
@@ -0,0 +1,52 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef FASTTRIP_H
+#define FASTTRIP_H
+
+#include <stdint.h>
+
+/** \brief Hard cell voltage limits checked on every sample
+ *
+ * BmsIO hands over each cell voltage right after reading it. When a cell is
+ * outside utripmin/utripmax the trip latches, the error is posted and, with
+ * tripmode=OpenChain, the enable output to the next module is switched off.
+ * The trip is released with tripreset once all cells are back inside the
+ * limits by utriphyst for a whole sweep.
+ */
+class FastTrip
+{
+   public:
+      enum State { TRIP_OK, TRIP_OVERVOLTAGE, TRIP_UNDERVOLTAGE };
+
+      static void ConversionStarted();
+      static void CheckCell(int channel, float udc);
+      static State GetState() { return state; }
+      static void Reset();
+
+   private:
+      static void Trip(State s, int channel);
+      static void Release();
+
+      static State state;
+      static uint32_t conversionStart;
+      static int cellsInside;
+      static bool chainOpen;
+};
+
+#endif // FASTTRIP_H
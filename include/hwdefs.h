@@ -11,6 +11,10 @@
 #define PARAM_BLKSIZE FLASH_PAGE_SIZE
 #define PARAM_BLKNUM  1   //last block of 1k
 #define CAN1_BLKNUM   2
+#define EVENTLOG_BLKNUM 4 //pin definitions of the boot loader are in block 3
+//Application area, the boot loader takes the first 4k. Must match linker.ld
+#define APP_FLASH_START (FLASH_BASE + 0x1000)
+#define APP_FLASH_SIZE  (120 * 1024)
 
 enum HwRev { HW_UNKNOWN, HW_1X, HW_20, HW_21, HW_22, HW_23 };
 
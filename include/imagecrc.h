@@ -0,0 +1,61 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef IMAGECRC_H
+#define IMAGECRC_H
+
+#include <stdint.h>
+#include "cansdo.h"
+
+#define SDO_INDEX_IMAGECRC    0x5104
+#define SDO_IMAGECRC_PAGES    0 //r, number of flash pages of the application area
+#define SDO_IMAGECRC_PAGESIZE 1 //r, page size in bytes
+#define SDO_IMAGECRC_SELECT   2 //r/w, page of the next CRC read, 0 is the first application page
+#define SDO_IMAGECRC_PAGE     3 //r, CRC of the selected page, advances to the next page
+#define SDO_IMAGECRC_IMAGE    4 //w: image length in bytes, r: CRC over that many bytes
+
+/** \brief CRC inventory of the running firmware
+ *
+ * A host tool reads the CRC of every application page from each module and
+ * compares them with the pages of an image, which shows which modules run
+ * another firmware and where it differs. After an update the CRC over the
+ * whole image confirms each module. CRCs are CRC-32/MPEG-2 over little endian
+ * words, which is what the STM32 CRC unit computes, so main passes the
+ * hardware unit and Crc32() is the software reference for host tools.
+ */
+class ImageCrc
+{
+   public:
+      typedef uint32_t (*CrcFunc)(const uint32_t* data, uint32_t words);
+
+      static void SetImage(const uint32_t* start, int pages, int pageSize, CrcFunc crcFunc);
+      static uint32_t GetPageCrc(int page);
+      static uint32_t GetImageCrc(uint32_t bytes);
+      static uint32_t Crc32(const uint32_t* data, uint32_t words);
+      static bool ProcessSdo(CanSdo::SdoFrame* sdoFrame);
+
+   private:
+      static const uint32_t* image;
+      static int numPages;
+      static int pageWords;
+      static CrcFunc crc;
+      static int selected;
+      static uint32_t imageBytes;
+};
+
+#endif // IMAGECRC_H
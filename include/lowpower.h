@@ -0,0 +1,47 @@
+/*
+ * This file is part of the FlyingADCBMS project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LOWPOWER_H
+#define LOWPOWER_H
+
+#include <stdint.h>
+#include "bmsfsm.h"
+
+/* Power saving while parked. The main loop sleeps with WFI until the next
+ * interrupt. With lowpower=1 the cell voltages are only scanned during one
+ * second out of every idlescan seconds while in IDLE and not balancing. With
+ * lowpower=2 a single, disabled module also enters STOP mode between those
+ * scans and wakes up once a second from the RTC alarm.
+ */
+class LowPower
+{
+   public:
+      static bool IsScanDue();
+      static void Sleep(BmsFsm* bmsFsm);
+      static uint32_t GetSleepPercent();
+
+   private:
+      static bool IsStopAllowed(BmsFsm* bmsFsm);
+      static void EnterStop();
+      static uint32_t GetTicks();
+
+      static volatile uint32_t sleepTicks;
+      static uint32_t lastTicks;
+};
+
+#endif // LOWPOWER_H
@@ -46,8 +46,9 @@
    2. Temporary parameters (id = 0)
    3. Display values
  */
-//Next param id (increase when adding new parameter!): 151  
-//Next value Id: 2105
+//Next param id (increase when adding new parameter!): 240
+//Next value Id: 2141
+//Retired ids, do not reuse: 159, 164, 165
 /*              category     name         unit       min     max     default id */
 #define PARAM_LIST \
     PARAM_ENTRY(CAT_BMS,     gain,        "mV/dig",  1,      1000,   587,    3   ) \
@@ -60,6 +61,9 @@
     PARAM_ENTRY(CAT_BMS,     idlewait,    "s",       0,      100000, 60,     12  ) \
     PARAM_ENTRY(CAT_BMS,     sleeptimeout,"h",        0,      99,     2,      56  ) \
     PARAM_ENTRY(CAT_BMS,     idlecurrent, "mA",       0,      9999,   800,    57  ) \
+    PARAM_ENTRY(CAT_BMS,     lowpower,    LOWPOWER,  0,      2,      0,      169 ) \
+    PARAM_ENTRY(CAT_BMS,     idlescan,    "s",       1,      600,    10,     170 ) \
+    PARAM_ENTRY(CAT_BMS,     diagint,     "s",       0,      3600,   10,     171 ) \
     PARAM_ENTRY(CAT_BAT,     dischargemax,"A",       1,      2047,   200,    32  ) \
     PARAM_ENTRY(CAT_BAT,     nomcap,      "Ah",      0,      1000,   100,    9   ) \
     PARAM_ENTRY(CAT_BAT,     icc1,        "A",       1,      2000,   70,     43  ) \
@@ -81,17 +85,85 @@
     PARAM_ENTRY(CAT_BAT,     ucell90soc,  "mV",      2000,   4500,   4100,   26  ) \
     PARAM_ENTRY(CAT_BAT,     ucell100soc, "mV",      2000,   4500,   4200,   27  ) \
     PARAM_ENTRY(CAT_BAT,     sohpreset,   "%",       10,     100,    100,    53  ) \
+    PARAM_ENTRY(CAT_BAT,     thermmodel,  OFFON,     0,      1,      0,      208 ) \
+    PARAM_ENTRY(CAT_BAT,     rcell,       "mOhm",    0,      100,    0,      209 ) \
+    PARAM_ENTRY(CAT_BAT,     rthcell,     "K/W",     0,      20,     1.5,    210 ) \
+    PARAM_ENTRY(CAT_BAT,     tauthcell,   "s",       10,     10000,  600,    211 ) \
+    PARAM_ENTRY(CAT_BAT,     thorizon,    "s",       0,      3600,   120,    212 ) \
+    PARAM_ENTRY(CAT_LIM,     tripmode,    TRIPMODE,  0,      2,      1,      172 ) \
+    PARAM_ENTRY(CAT_LIM,     utripmax,    "mV",      1000,   5000,   4250,   173 ) \
+    PARAM_ENTRY(CAT_LIM,     utripmin,    "mV",      1000,   5000,   2500,   174 ) \
+    PARAM_ENTRY(CAT_LIM,     utriphyst,   "mV",      0,      500,    50,     175 ) \
+    PARAM_ENTRY(CAT_LIM,     ucellwarnhi, "mV",      1000,   5000,   4190,   177 ) \
+    PARAM_ENTRY(CAT_LIM,     ucellalarmhi,"mV",      1000,   5000,   4220,   178 ) \
+    PARAM_ENTRY(CAT_LIM,     ucellfaulthi,"mV",      1000,   5000,   4240,   179 ) \
+    PARAM_ENTRY(CAT_LIM,     ucellwarnlo, "mV",      1000,   5000,   3250,   180 ) \
+    PARAM_ENTRY(CAT_LIM,     ucellalarmlo,"mV",      1000,   5000,   3000,   181 ) \
+    PARAM_ENTRY(CAT_LIM,     ucellfaultlo,"mV",      1000,   5000,   2800,   182 ) \
+    PARAM_ENTRY(CAT_LIM,     udeltawarn,  "mV",      2,      1000,   150,    183 ) \
+    PARAM_ENTRY(CAT_LIM,     udeltaalarm, "mV",      2,      1000,   300,    184 ) \
+    PARAM_ENTRY(CAT_LIM,     udeltafault, "mV",      2,      1000,   500,    185 ) \
+    PARAM_ENTRY(CAT_LIM,     tempwarnhi,  "°C",      -40,    100,    55,     186 ) \
+    PARAM_ENTRY(CAT_LIM,     tempalarmhi, "°C",      -40,    100,    60,     187 ) \
+    PARAM_ENTRY(CAT_LIM,     tempfaulthi, "°C",      -40,    100,    65,     188 ) \
+    PARAM_ENTRY(CAT_LIM,     tempwarnlo,  "°C",      -40,    100,    0,      189 ) \
+    PARAM_ENTRY(CAT_LIM,     tempalarmlo, "°C",      -40,    100,    -10,    190 ) \
+    PARAM_ENTRY(CAT_LIM,     tempfaultlo, "°C",      -40,    100,    -20,    191 ) \
+    PARAM_ENTRY(CAT_LIM,     iwarn,       "%",       0,      500,    100,    192 ) \
+    PARAM_ENTRY(CAT_LIM,     ialarm,      "%",       0,      500,    110,    193 ) \
+    PARAM_ENTRY(CAT_LIM,     ifault,      "%",       0,      500,    125,    194 ) \
+    PARAM_ENTRY(CAT_LIM,     tchglo1,     "°C",      -40,    100,    -20,    213 ) \
+    PARAM_ENTRY(CAT_LIM,     fchglo1,     "%",       0,      100,    0,      214 ) \
+    PARAM_ENTRY(CAT_LIM,     tchglo2,     "°C",      -40,    100,    0,      215 ) \
+    PARAM_ENTRY(CAT_LIM,     fchglo2,     "%",       0,      100,    30,     216 ) \
+    PARAM_ENTRY(CAT_LIM,     tchglo3,     "°C",      -40,    100,    25,     217 ) \
+    PARAM_ENTRY(CAT_LIM,     fchglo3,     "%",       0,      100,    100,    218 ) \
+    PARAM_ENTRY(CAT_LIM,     tchghi1,     "°C",      -40,    100,    43.33,  219 ) \
+    PARAM_ENTRY(CAT_LIM,     fchghi1,     "%",       0,      100,    100,    220 ) \
+    PARAM_ENTRY(CAT_LIM,     tchghi2,     "°C",      -40,    100,    46.67,  221 ) \
+    PARAM_ENTRY(CAT_LIM,     fchghi2,     "%",       0,      100,    50,     222 ) \
+    PARAM_ENTRY(CAT_LIM,     tchghi3,     "°C",      -40,    100,    50,     223 ) \
+    PARAM_ENTRY(CAT_LIM,     fchghi3,     "%",       0,      100,    0,      224 ) \
+    PARAM_ENTRY(CAT_LIM,     tdchhi1,     "°C",      -40,    100,    46.33,  225 ) \
+    PARAM_ENTRY(CAT_LIM,     fdchhi1,     "%",       0,      100,    100,    226 ) \
+    PARAM_ENTRY(CAT_LIM,     tdchhi2,     "°C",      -40,    100,    49.67,  227 ) \
+    PARAM_ENTRY(CAT_LIM,     fdchhi2,     "%",       0,      100,    50,     228 ) \
+    PARAM_ENTRY(CAT_LIM,     tdchhi3,     "°C",      -40,    100,    53,     229 ) \
+    PARAM_ENTRY(CAT_LIM,     fdchhi3,     "%",       0,      100,    0,      230 ) \
+    PARAM_ENTRY(CAT_LIM,     udchlo1,     "mV",      0,      1000,   0,      231 ) \
+    PARAM_ENTRY(CAT_LIM,     fdchlo1,     "%",       0,      100,    0,      232 ) \
+    PARAM_ENTRY(CAT_LIM,     udchlo2,     "mV",      0,      1000,   25,     233 ) \
+    PARAM_ENTRY(CAT_LIM,     fdchlo2,     "%",       0,      100,    50,     234 ) \
+    PARAM_ENTRY(CAT_LIM,     udchlo3,     "mV",      0,      1000,   50,     235 ) \
+    PARAM_ENTRY(CAT_LIM,     fdchlo3,     "%",       0,      100,    100,    236 ) \
     PARAM_ENTRY(CAT_SENS,    idcgain,     "dig/A",  -1000,   1000,   10,     6   ) \
     PARAM_ENTRY(CAT_SENS,    idcofs,      "dig",    -4095,   4095,   0,      7   ) \
     PARAM_ENTRY(CAT_SENS,    idcmode,     IDCMODES,  0,      3,      0,      8   ) \
     PARAM_ENTRY(CAT_SENS,    tempsns,     TEMPSNS,   0,      3,      0,      52  ) \
     PARAM_ENTRY(CAT_SENS,    tempres,     "Ohm",     10,     500000, 10000,  50  ) \
     PARAM_ENTRY(CAT_SENS,    tempbeta,    "",        1,      100000, 3900,   51  ) \
+    PARAM_ENTRY(CAT_SENS,    tempcurve,   TEMPCURVE, 0,      1,      0,      195 ) \
+    PARAM_ENTRY(CAT_SENS,    ntcm30,      "Ohm",     10,     500000, 192752, 196 ) \
+    PARAM_ENTRY(CAT_SENS,    ntcm20,      "Ohm",     10,     500000, 102289, 197 ) \
+    PARAM_ENTRY(CAT_SENS,    ntcm10,      "Ohm",     10,     500000, 56961,  198 ) \
+    PARAM_ENTRY(CAT_SENS,    ntc0,        "Ohm",     10,     500000, 33109,  199 ) \
+    PARAM_ENTRY(CAT_SENS,    ntc10,       "Ohm",     10,     500000, 19996,  200 ) \
+    PARAM_ENTRY(CAT_SENS,    ntc20,       "Ohm",     10,     500000, 12500,  201 ) \
+    PARAM_ENTRY(CAT_SENS,    ntc30,       "Ohm",     10,     500000, 8059,   202 ) \
+    PARAM_ENTRY(CAT_SENS,    ntc40,       "Ohm",     10,     500000, 5344,   203 ) \
+    PARAM_ENTRY(CAT_SENS,    ntc50,       "Ohm",     10,     500000, 3635,   204 ) \
+    PARAM_ENTRY(CAT_SENS,    ntc60,       "Ohm",     10,     500000, 2530,   205 ) \
+    PARAM_ENTRY(CAT_SENS,    ntc70,       "Ohm",     10,     500000, 1799,   206 ) \
+    PARAM_ENTRY(CAT_SENS,    tempmuxch,   "",        0,      8,      0,      207 ) \
     PARAM_ENTRY(CAT_COMM,    pdobase,     "",        0,      2047,   500,    10  ) \
     PARAM_ENTRY(CAT_COMM,    sdobase,     "",        0,      63,     10,     11  ) \
+    PARAM_ENTRY(CAT_COMM,    tlmchan,     TLMCHAN,   0,      31,     0,      237 ) \
+    PARAM_ENTRY(CAT_COMM,    tlmrate,     "ms",      25,     10000,  100,    238 ) \
+    PARAM_ENTRY(CAT_COMM,    tlmcanid,    "",        1,      2047,   1984,   239 ) \
     TESTP_ENTRY(CAT_TEST,    enable,      OFFON,     0,      1,      1,      48  ) \
     TESTP_ENTRY(CAT_TEST,    testchan,    "",        -1,     15,     -1,     49  ) \
     TESTP_ENTRY(CAT_TEST,    testbalance, BALMODE,   0,      2,      0,      54  ) \
+    TESTP_ENTRY(CAT_TEST,    tripreset,   OFFON,     0,      1,      0,      176 ) \
     PARAM_ENTRY(CAT_VX1,     VX1mode,     VX1MODE,    0,      1,      1,      101  ) \
     PARAM_ENTRY(CAT_VX1_MC,  VX1drvCurr,   "A",       30,     230,    180,    110 ) \
     PARAM_ENTRY(CAT_VX1_MC,  VX1regenCurr, "A",       0,      100,    100,    111 ) \
@@ -113,13 +185,10 @@
     PARAM_ENTRY(CAT_VX1_CAN,     VX1TempWarn,  "0=Off, 1=On",     0,      1,      1,      155 ) \
     PARAM_ENTRY(CAT_VX1_CAN,     VX1TempWarnTest, "0=Off, 1=On",     0,      1,      0,      157 ) \
     PARAM_ENTRY(CAT_VX1_CAN,     VX1uDeltaWarn,  "0=Off, 1=On",     0,      1,      1,      158 ) \
-    PARAM_ENTRY(CAT_VX1_CAN,     VX1uDeltaWarnTresh, "mV",     2,     500,    150,    159 ) \
     PARAM_ENTRY(CAT_VX1_CAN,     VX1uDeltaWarnTest,  "0=Off, 1=On",     0,      1,      0,      160 ) \
     PARAM_ENTRY(CAT_VX1_CAN,     VX1SendConfigMsg, "0=off, 2=regVX1drvCurr, 3=VX1regenMaxU 4=VX1regenMaxI, 5=VX1chrCellNo, 6=VX1chrCellMaxV, 7=VX1chrBattCap",   0,      8 ,      0,      161 ) \
     PARAM_ENTRY(CAT_VX1_CAN,     VX1EmulateBMSmsg, "0=off, 1=on",   0,      1 ,      1,      162 ) \
     PARAM_ENTRY(CAT_VX1_CAN,     VX1kWhResetDist, "km",   0.1,    20,      5,      163 ) \
-    PARAM_ENTRY(CAT_VX1_CAN,     VX1TempWarnHiPoint, "°C",     40,     80,     55,     164 ) \
-    PARAM_ENTRY(CAT_VX1_CAN,     VX1TempWarnLoPoint, "°C",     40,     80,     55,     165 ) \
     PARAM_ENTRY(CAT_VX1_CAN,     VX1FanDuty, "%",     0,    100,     50,     166 ) \
     PARAM_ENTRY(CAT_VX1_CAN,     VX1mockTemp, "°C",     -20,    55,     24,     167 ) \
     PARAM_ENTRY(CAT_VX1_CAN,     VX1ModuleNumber, "1-15",     1,     15,     1,     168 ) \
@@ -133,6 +202,11 @@
     VALUE_ENTRY(totalcells,  "",     2074 ) \
     VALUE_ENTRY(counter,     "",     2076 ) \
     VALUE_ENTRY(uptime,      "s",    2103 ) \
+    VALUE_ENTRY(selftesttime,"ms",   2114 ) \
+    VALUE_ENTRY(tripstt,     TRIPSTT,2115 ) \
+    VALUE_ENTRY(triplat,     "ms",   2116 ) \
+    VALUE_ENTRY(protlevel,   PROTLEVEL,2117 ) \
+    VALUE_ENTRY(protsignal,  PROTSIG,2118 ) \
     VALUE_ENTRY(chargein,    "As",   2040 ) \
     VALUE_ENTRY(chargeout,   "As",   2041 ) \
     VALUE_ENTRY(soc,         "%",    2071 ) \
@@ -144,6 +218,20 @@
     VALUE_ENTRY(power,       "W",    2075 ) \
     VALUE_ENTRY(tempmin,     "°C",   2044 ) \
     VALUE_ENTRY(tempmax,     "°C",   2077 ) \
+    VALUE_ENTRY(tempcore,    "°C",   2137 ) \
+    VALUE_ENTRY(temppred,    "°C",   2138 ) \
+    VALUE_ENTRY(rcellest,    "mOhm", 2139 ) \
+    VALUE_ENTRY(tlmdrop,     "",     2140 ) \
+    VALUE_ENTRY(t1stt,       TEMPSTT,2119 ) \
+    VALUE_ENTRY(t2stt,       TEMPSTT,2120 ) \
+    VALUE_ENTRY(tmux0,       "°C",   2129 ) \
+    VALUE_ENTRY(tmux1,       "°C",   2130 ) \
+    VALUE_ENTRY(tmux2,       "°C",   2131 ) \
+    VALUE_ENTRY(tmux3,       "°C",   2132 ) \
+    VALUE_ENTRY(tmux4,       "°C",   2133 ) \
+    VALUE_ENTRY(tmux5,       "°C",   2134 ) \
+    VALUE_ENTRY(tmux6,       "°C",   2135 ) \
+    VALUE_ENTRY(tmux7,       "°C",   2136 ) \
     VALUE_ENTRY(uavg,        "mV",   2002 ) \
     VALUE_ENTRY(umin,        "mV",   2003 ) \
     VALUE_ENTRY(umax,        "mV",   2004 ) \
@@ -170,41 +258,49 @@
     VALUE_ENTRY(umax0,       "mV",   2049 ) \
     VALUE_ENTRY(tempmin0,    "°C",   2078 ) \
     VALUE_ENTRY(tempmax0,    "°C",   2079 ) \
+    VALUE_ENTRY(tempflt0,    TEMPFLT,2121 ) \
     VALUE_ENTRY(uavg1,       "mV",   2050 ) \
     VALUE_ENTRY(umin1,       "mV",   2051 ) \
     VALUE_ENTRY(umax1,       "mV",   2052 ) \
     VALUE_ENTRY(tempmin1,    "°C",   2087 ) \
     VALUE_ENTRY(tempmax1,    "°C",   2088 ) \
+    VALUE_ENTRY(tempflt1,    TEMPFLT,2122 ) \
     VALUE_ENTRY(uavg2,       "mV",   2053 ) \
     VALUE_ENTRY(umin2,       "mV",   2054 ) \
     VALUE_ENTRY(umax2,       "mV",   2055 ) \
     VALUE_ENTRY(tempmin2,    "°C",   2089 ) \
     VALUE_ENTRY(tempmax2,    "°C",   2090 ) \
+    VALUE_ENTRY(tempflt2,    TEMPFLT,2123 ) \
     VALUE_ENTRY(uavg3,       "mV",   2056 ) \
     VALUE_ENTRY(umin3,       "mV",   2057 ) \
     VALUE_ENTRY(umax3,       "mV",   2058 ) \
     VALUE_ENTRY(tempmin3,    "°C",   2091 ) \
     VALUE_ENTRY(tempmax3,    "°C",   2092 ) \
+    VALUE_ENTRY(tempflt3,    TEMPFLT,2124 ) \
     VALUE_ENTRY(uavg4,       "mV",   2059 ) \
     VALUE_ENTRY(umin4,       "mV",   2060 ) \
     VALUE_ENTRY(umax4,       "mV",   2061 ) \
     VALUE_ENTRY(tempmin4,    "°C",   2093 ) \
     VALUE_ENTRY(tempmax4,    "°C",   2094 ) \
+    VALUE_ENTRY(tempflt4,    TEMPFLT,2125 ) \
     VALUE_ENTRY(uavg5,       "mV",   2062 ) \
     VALUE_ENTRY(umin5,       "mV",   2063 ) \
     VALUE_ENTRY(umax5,       "mV",   2064 ) \
     VALUE_ENTRY(tempmin5,    "°C",   2095 ) \
     VALUE_ENTRY(tempmax5,    "°C",   2096 ) \
+    VALUE_ENTRY(tempflt5,    TEMPFLT,2126 ) \
     VALUE_ENTRY(uavg6,       "mV",   2065 ) \
     VALUE_ENTRY(umin6,       "mV",   2066 ) \
     VALUE_ENTRY(umax6,       "mV",   2067 ) \
     VALUE_ENTRY(tempmin6,    "°C",   2097 ) \
     VALUE_ENTRY(tempmax6,    "°C",   2098 ) \
+    VALUE_ENTRY(tempflt6,    TEMPFLT,2127 ) \
     VALUE_ENTRY(uavg7,       "mV",   2068 ) \
     VALUE_ENTRY(umin7,       "mV",   2069 ) \
     VALUE_ENTRY(umax7,       "mV",   2070 ) \
     VALUE_ENTRY(tempmin7,    "°C",   2099 ) \
     VALUE_ENTRY(tempmax7,    "°C",   2100 ) \
+    VALUE_ENTRY(tempflt7,    TEMPFLT,2128 ) \
     VALUE_ENTRY(u0cmd,       BAL,    2022 ) \
     VALUE_ENTRY(u1cmd,       BAL,    2023 ) \
     VALUE_ENTRY(u2cmd,       BAL,    2024 ) \
@@ -222,6 +318,9 @@
     VALUE_ENTRY(u14cmd,      BAL,    2036 ) \
     VALUE_ENTRY(u15cmd,      BAL,    2037 ) \
     VALUE_ENTRY(cpuload,     "%",    2038 ) \
+    VALUE_ENTRY(sleeppct,    "%",    2113 ) \
+    VALUE_ENTRY(stackfree,   "B",    2111 ) \
+    VALUE_ENTRY(isrmax,      "us",   2112 ) \
     VALUE_ENTRY(VX1speed,    "km/h", 2105 ) \
     VALUE_ENTRY(VX1busVoltage, "V", 2106 ) \
     VALUE_ENTRY(VX1busCurrent, "A", 2107 ) \
@@ -238,6 +337,15 @@
 #define BAL          "0=None, 1=Discharge, 2=ChargePos, 3=ChargeNeg"
 #define IDCMODES     "0=Off, 1=AdcSingle, 2=AdcDifferential, 3=IsaCan"
 #define TEMPSNS      "0=None, 1=Chan1, 2=Chan2, 3=Both"
+#define TEMPCURVE    "0=Beta, 1=Table"
+#define TEMPSTT      "0=Ok, 1=Open, 2=Short, 3=Implausible, 4=Rate"
+#define TEMPFLT      "0=None, 1=Sensor1, 2=Sensor2OrMux"
+#define LOWPOWER     "0=Off, 1=SlowIdleScan, 2=StopBetweenScans"
+#define TRIPMODE     "0=Off, 1=Report, 2=OpenChain"
+#define TRIPSTT      "0=Ok, 1=OverVoltage, 2=UnderVoltage"
+#define PROTLEVEL    "0=Ok, 1=Warning, 2=Alarm, 3=Fault"
+#define TLMCHAN      "1=Cells, 2=Current, 4=Temps, 8=Balancer, 16=SoC"
+#define PROTSIG      "0=CellHigh, 1=CellLow, 2=CellDelta, 3=TempHigh, 4=TempLow, 5=ChargeCurrent, 6=DischargeCurrent"
 #define CAT_TEST     "Testing"
 #define CAT_BMS      "BMS"
 #define CAT_SENS     "Sensor setup"
@@ -273,6 +381,12 @@ enum
    IDC_OFF, IDC_SINGLE, IDC_DIFFERENTIAL, IDC_ISACAN
 };
 
+enum _tempcurve
+{
+   TEMPCURVE_BETA = 0,
+   TEMPCURVE_TABLE = 1
+};
+
 enum _canspeeds
 {
    CAN_PERIOD_100MS = 0,
@@ -280,6 +394,20 @@ enum _canspeeds
    CAN_PERIOD_LAST
 };
 
+enum _lowpower
+{
+   LP_OFF = 0,
+   LP_SLOWSCAN = 1,
+   LP_STOP = 2
+};
+
+enum _tripmode
+{
+   TRIP_OFF = 0,
+   TRIP_REPORT = 1,
+   TRIP_OPENCHAIN = 2
+};
+
 enum _balmode
 {
    BAL_OFF = 0,
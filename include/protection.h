@@ -0,0 +1,72 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef PROTECTION_H
+#define PROTECTION_H
+
+#include <stdint.h>
+#include "params.h"
+#include "errormessage.h"
+
+/** \brief Warning, alarm and fault levels of the pack signals
+ *
+ * The main module evaluates all signals once per sweep from a table of
+ * rules. A level is only entered or left after the signal stayed there for
+ * the rule's time qualifier, and it is left with hysteresis. The resulting
+ * state vector is used by the current limits, the VX1 messages and the
+ * error log.
+ */
+class Protection
+{
+   public:
+      enum Signal
+      {
+         SIG_UCELLHIGH, SIG_UCELLLOW, SIG_UDELTA, SIG_TEMPHIGH, SIG_TEMPLOW, SIG_ICHARGE, SIG_IDISCHARGE,
+         NUM_SIGNALS
+      };
+      enum Level { LEVEL_OK, LEVEL_WARNING, LEVEL_ALARM, LEVEL_FAULT };
+      enum Direction { CHARGE = 1, DISCHARGE = 2 };
+
+      static void Evaluate();
+      static void Reset();
+      static Level GetLevel(Signal s) { return (Level)level[s]; }
+      static Level GetWorstLevel();
+      static Level Classify(Signal s, float value);
+      static float GetDerating(Direction d);
+
+   private:
+      struct Rule
+      {
+         Param::PARAM_NUM threshold[3]; //warning, alarm and fault
+         bool high;                     //true when values above the threshold are bad
+         float hysteresis;
+         uint16_t qualifyMs;
+         uint8_t limits;                //Direction(s) derated by this signal
+         ERROR_MESSAGE_NUM error;       //posted when entering LEVEL_FAULT
+      };
+
+      static float GetValue(Signal s);
+      static bool IsBeyond(const Rule& rule, float value, int lvl, float hysteresis);
+
+      static const Rule rules[NUM_SIGNALS];
+      static uint8_t level[NUM_SIGNALS];
+      static uint8_t pending[NUM_SIGNALS];
+      static uint32_t pendingSince[NUM_SIGNALS];
+};
+
+#endif // PROTECTION_H
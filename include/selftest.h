@@ -25,9 +25,11 @@ class SelfTest
    public:
       enum TestResult { TestOngoing, TestSuccess, TestFailed, TestsDone };
       static TestResult RunTest(int& testStep);
+      static void Reset();
       static TestResult GetLastResult() { return lastResult; }
       static void SetNumChannels(int c) { numChannels = c; }
       static int GetErrorChannel() { return errChannel; }
+      static int GetTotalCycles() { return totalCycles; }
 
    private:
       typedef TestResult (*TestFunction)(void);
@@ -36,11 +38,15 @@ class SelfTest
       static TestResult RunTestBalancer();
       static TestResult TestCellConnection();
       static TestResult NoTest();
+      static int ChannelAt(int position);
 
       static TestFunction testFunctions[];
       static int cycleCounter;
+      static int totalCycles;
       static int numChannels;
       static int errChannel;
+      static bool overVoltage;
+      static bool polarityCheckComplete;
       static TestResult lastResult;
 };
 
@@ -0,0 +1,39 @@
+/*
+ * This file is part of the FlyingADCBMS project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef STACKMONITOR_H
+#define STACKMONITOR_H
+
+#include <stdint.h>
+
+/* Stack high water mark. The unused RAM between the end of .bss and the
+ * main stack pointer is filled with a pattern at boot. The stack grows down
+ * into it, so the lowest overwritten word marks the deepest stack usage.
+ */
+class StackMonitor
+{
+   public:
+      static void Paint();
+      static uint32_t GetFree();
+      static uint32_t GetUsed();
+
+   private:
+      static uint32_t* lowestUsed;
+};
+
+#endif // STACKMONITOR_H
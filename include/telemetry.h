@@ -0,0 +1,96 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include "canhardware.h"
+
+#ifndef TELEMETRY_BUFFER_SIZE
+#define TELEMETRY_BUFFER_SIZE 128 //two of these
+#endif
+
+/** \brief Streams raw measurements as packed binary records over CAN
+ *
+ * Run() is called from the 25 ms task. Every interval it appends a record of
+ * the selected channel groups to the fill buffer. Whenever the send side is
+ * idle the two buffers are swapped and the filled one is sent in up to
+ * FRAMES_PER_RUN frames per call, so records pile up while a slow bus drains.
+ * The first byte of each frame is a 7 bit sequence counter, bit 7 marks the
+ * first frame of a buffer. The other 7 bytes are the stream. A buffer always
+ * starts with a record, so after a lost frame the decoder skips to the next
+ * marked frame.
+ *
+ * A record starts with its length in bytes, the channel mask and the time
+ * in ms, all little endian, followed by the selected groups in mask order:
+ * - TLM_CELLS: number of cells, then each cell voltage in mV as uint16
+ * - TLM_CURRENT: idc in 0.1 A as int16
+ * - TLM_TEMPS: tempmin0 and tempmax0 in 0.1 °C as int16
+ * - TLM_BALANCE: u0cmd to u15cmd, 2 bits each as uint32
+ * - TLM_SOC: soc in 0.01 %, soh in 0.1 %, idcavg in 0.1 A and tempcore in 0.1 °C as int16
+ *
+ * Frames go out on the configured id plus the module index, so that all
+ * modules can stream with the same settings.
+ *
+ * When the fill buffer can't take another record it is dropped and counted.
+ * Configure() may be called from the main loop, the new settings are taken
+ * over at the start of the next Run().
+ */
+class Telemetry
+{
+   public:
+      enum Channels { TLM_CELLS = 1, TLM_CURRENT = 2, TLM_TEMPS = 4, TLM_BALANCE = 8, TLM_SOC = 16, TLM_ALL = 31 };
+
+      static const int RUN_INTERVAL_MS = 25;
+      static const int FRAMES_PER_RUN = 8;
+      static const uint8_t FLAG_FIRST = 0x80;
+
+      static void SetCan(CanHardware* hw) { can = hw; }
+      static void SetModule(uint8_t index) { module = index; }
+      static void Configure(uint8_t channels, int intervalMs, uint32_t canId);
+      static void Run();
+      static uint32_t GetDropped() { return dropped; }
+
+   private:
+      static void ApplyConfig();
+      static void AddRecord();
+      static void SendFrames();
+      static void Put(uint8_t*& p, int32_t value, int bytes);
+      static int32_t Scale(int param, int factor);
+
+      static uint8_t buffers[2][TELEMETRY_BUFFER_SIZE];
+      static uint8_t fillLength[2];
+      static uint8_t fillIndex;
+      static uint8_t sendPos;
+      static bool sending;
+      static uint8_t sequence;
+      static uint8_t channels;
+      static uint16_t decimation;
+      static uint16_t runs;
+      static uint32_t canId;
+      static uint8_t newChannels;
+      static uint16_t newDecimation;
+      static uint32_t newCanId;
+      static volatile bool configChanged;
+      static uint32_t dropped;
+      static uint8_t module;
+      static CanHardware* can;
+};
+
+#endif // TELEMETRY_H
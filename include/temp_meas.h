@@ -19,10 +19,30 @@
 #ifndef TEMP_MEAS_H_INCLUDED
 #define TEMP_MEAS_H_INCLUDED
 
+#include <stdint.h>
+
+/** \brief NTC temperature from the 12 bit ADC reading
+ *
+ * AdcToTemperature() evaluates the beta equation, which costs a logf and
+ * several float divisions on the soft float core. Lookup() interpolates a
+ * table of temperatures in 0.1 °C every 32 ADC digits instead, every 2 digits
+ * below digit 128 where the curve bends towards the cold end. The table is
+ * recalculated from the beta equation or from a user supplied R-T curve
+ * whenever the sensor parameters change.
+ */
 class TempMeas
 {
 public:
    static float AdcToTemperature(int digit, int nomRes, int beta);
+   static void CalculateBetaTable(int nomRes, int beta);
+   static void CalculateCurveTable(const float resistance[], int points, int firstTemp, int tempStep);
+   static float Lookup(int digit);
+
+private:
+   static float AdcToResistance(int digit);
+   static int EntryToDigit(int i);
+   static int16_t ToTableEntry(float temp);
+   static int16_t table[];
 };
 
 
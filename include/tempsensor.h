@@ -0,0 +1,57 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef TEMPSENSOR_H
+#define TEMPSENSOR_H
+
+#include <stdint.h>
+
+/** \brief Filtered NTC input with fault detection
+ *
+ * The ADC reading is sampled several times per update and averaged. The
+ * averaged reading is checked for an open or shorted NTC, for a temperature
+ * outside the plausible range and for a jump against the filtered value.
+ * Good readings go through a first order IIR filter. A failing reading is
+ * dropped, and only a fault that persists for FAULT_UPDATES updates marks
+ * the sensor as failed. It is good again after RECOVER_UPDATES good updates.
+ */
+class TempSensor
+{
+   public:
+      enum Status { SNS_OK, SNS_OPEN, SNS_SHORT, SNS_IMPLAUSIBLE, SNS_RATE };
+
+      TempSensor();
+      void Sample(int digit);
+      bool Update();
+      void Reset();
+      float Get() const { return filtered; }
+      Status GetStatus() const { return status; }
+
+   private:
+      Status Check(int digit, float temp) const;
+
+      uint32_t sum;
+      uint8_t samples;
+      uint8_t faultCount;
+      uint8_t goodCount;
+      bool valid;
+      Status status;
+      float filtered;
+};
+
+#endif // TEMPSENSOR_H
@@ -0,0 +1,156 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "benchmark.h"
+#include "bmsalgo.h"
+#include "temp_meas.h"
+#include "my_math.h"
+
+//Results are written here so the compiler can't drop the calls
+static volatile float sink;
+static uint32_t overhead;
+static Benchmark::TickSource ticks;
+
+#define MEASURE(r, perCall, call) \
+   do { \
+      if (perCall) \
+      { \
+         uint32_t start = ticks(); \
+         sink = call; \
+         Record(r, ticks() - start); \
+      } \
+      else \
+         sink = call; \
+   } while (0)
+
+typedef void (*Sweep)(Benchmark::Result& r, bool perCall);
+
+static void Record(Benchmark::Result& r, uint32_t elapsed)
+{
+   elapsed = elapsed > overhead ? elapsed - overhead : 0;
+   r.calls++;
+   r.min = MIN(r.min, elapsed);
+   r.max = MAX(r.max, elapsed);
+}
+
+//Whole lookup table plus both ends
+static void SweepSocFromVoltage(Benchmark::Result& r, bool perCall)
+{
+   for (int u = 3000; u <= 4300; u++)
+      MEASURE(r, perCall, BmsAlgo::EstimateSocFromVoltage(u));
+}
+
+//Charge differences of a 1000 s drive at +/-100 A
+static void SweepSocIntegration(Benchmark::Result& r, bool perCall)
+{
+   for (int i = 0; i < 1000; i++)
+      MEASURE(r, perCall, BmsAlgo::CalculateSocFromIntegration(50, (i % 200 - 100) * 0.1f * i));
+}
+
+//Charge up through all three CV stages and back down
+static void SweepChargeCurrent(Benchmark::Result& r, bool perCall)
+{
+   for (int u = 3300; u <= 4250; u++)
+      MEASURE(r, perCall, BmsAlgo::GetChargeCurrent(u));
+   for (int u = 4250; u >= 3300; u--)
+      MEASURE(r, perCall, BmsAlgo::GetChargeCurrent(u));
+}
+
+static void SweepLimitMinVoltage(Benchmark::Result& r, bool perCall)
+{
+   for (int u = 2900; u <= 3500; u++)
+      MEASURE(r, perCall, BmsAlgo::GetDerating(BmsAlgo::DRT_DISCHARGE_LOWVOLT, u - 3300));
+}
+
+//-30 to 60 °C in 0.1 °C steps
+static void SweepLowTempDerating(Benchmark::Result& r, bool perCall)
+{
+   for (int t = -300; t <= 600; t++)
+      MEASURE(r, perCall, BmsAlgo::GetDerating(BmsAlgo::DRT_CHARGE_LOWTEMP, t * 0.1f));
+}
+
+static void SweepHighTempDerating(Benchmark::Result& r, bool perCall)
+{
+   for (int t = -300; t <= 600; t++)
+      MEASURE(r, perCall, BmsAlgo::GetDerating(BmsAlgo::DRT_CHARGE_HIGHTEMP, t * 0.1f));
+}
+
+//Whole usable ADC range with the default 10k/3900 NTC
+static void SweepAdcToTemperature(Benchmark::Result& r, bool perCall)
+{
+   for (int digit = 200; digit <= 4000; digit++)
+      MEASURE(r, perCall, TempMeas::AdcToTemperature(digit, 10000, 3900));
+}
+
+//Same range from the lookup table, it must have been calculated before
+static void SweepTemperatureLookup(Benchmark::Result& r, bool perCall)
+{
+   for (int digit = 200; digit <= 4000; digit++)
+      MEASURE(r, perCall, TempMeas::Lookup(digit));
+}
+
+static const Sweep sweeps[Benchmark::BENCH_LAST] =
+{
+   SweepSocFromVoltage, SweepSocIntegration, SweepChargeCurrent, SweepLimitMinVoltage,
+   SweepLowTempDerating, SweepHighTempDerating, SweepAdcToTemperature, SweepTemperatureLookup
+};
+
+static const char* const names[Benchmark::BENCH_LAST] =
+{
+   "EstimateSocFromVoltage", "CalculateSocFromIntegration", "GetChargeCurrent", "GetDerating low voltage",
+   "GetDerating low temp", "GetDerating high temp", "AdcToTemperature", "TempMeas::Lookup"
+};
+
+/** \brief Runs the 100 ms task math over representative input sweeps
+ *
+ * Each sweep runs twice. The first pass times every call on its own, so min
+ * is the undisturbed cost and max shows the effect of interrupts. The second
+ * pass is timed as a whole which gives a meaningful average even where a
+ * single call is below the resolution of the tick source.
+ * Note that the charge current sweep moves the integrators of the CC/CV controllers.
+ *
+ * \param results one entry per benchmark, indexed by BENCH_xxx
+ * \param tickSource free running up-counter, cycles on target, ns on the host
+ *
+ */
+void Benchmark::Run(Result results[BENCH_LAST], TickSource tickSource)
+{
+   ticks = tickSource;
+   overhead = 0xFFFFFFFF;
+
+   for (int i = 0; i < 16; i++)
+   {
+      uint32_t start = ticks();
+      overhead = MIN(overhead, ticks() - start);
+   }
+
+   for (int i = 0; i < BENCH_LAST; i++)
+   {
+      Result& r = results[i];
+
+      r.name = names[i];
+      r.calls = 0;
+      r.min = 0xFFFFFFFF;
+      r.max = 0;
+      sweeps[i](r, true);
+
+      uint32_t start = ticks();
+      sweeps[i](r, false);
+      r.total = ticks() - start;
+   }
+}
@@ -18,11 +18,45 @@
  */
 #include "bmsalgo.h"
 #include "my_math.h"
+#include <math.h>
+
+//Resistance is estimated from current steps larger than this
+#define RES_STEP_CURRENT   10.0f
+//Wait one second after the step, the cell scan updates uavg once per sweep
+#define RES_SETTLE_UPDATES 10
+#define RES_MIN            0.05f
+#define RES_MAX            50.0f
+#define RES_FILTER_GAIN    0.25f
+//UpdateCoreTemperature() is called at 10 Hz
+#define THERMAL_DT         0.1f
 
 float BmsAlgo::nominalCapacity;
 //voltage to state of charge            0%    10%   20%   30%   40%   50%   60%   70%   80%   90%   100%
 uint16_t BmsAlgo::voltageToSoc[] =    { 3300, 3400, 3450, 3500, 3560, 3600, 3700, 3800, 4000, 4100, 4200 };
 PiController BmsAlgo::cvControllers[3];
+//Until the parameters are loaded: charge from 0.3 at 0 °C to 1 at 25 °C and inhibited at -20 °C,
+//reduce by 15 %/°C towards 50 °C for charge and 53 °C for discharge, and limit discharge 50 mV above ucellmin
+static const float lowTempX[] = { -20, 0, 25 }, lowTempY[] = { 0, 0.3f, 1 };
+static const float chargeHighTempX[] = { 43.33f, 46.67f, 50 }, dischargeHighTempX[] = { 46.33f, 49.67f, 53 };
+static const float highTempY[] = { 1, 0.5f, 0 };
+static const float lowVoltX[] = { 0, 25, 50 }, lowVoltY[] = { 0, 0.5f, 1 };
+DeratingCurve BmsAlgo::deratingCurves[DRT_LAST] =
+{
+   DeratingCurve(lowTempX, lowTempY, 3),
+   DeratingCurve(chargeHighTempX, highTempY, 3),
+   DeratingCurve(dischargeHighTempX, highTempY, 3),
+   DeratingCurve(lowVoltX, lowVoltY, 3)
+};
+float BmsAlgo::cellResistance;
+float BmsAlgo::estimatedResistance;
+float BmsAlgo::thermalResistance;
+float BmsAlgo::timeConstant = 600;
+float BmsAlgo::horizonDecay = 1;
+float BmsAlgo::coreRise;
+float BmsAlgo::refVoltage;
+float BmsAlgo::refCurrent;
+float BmsAlgo::stepCurrent;
+uint8_t BmsAlgo::settleCount;
 
 /** \brief Calculates SoC from a starting point adding the charge through the battery
  *
@@ -122,95 +156,31 @@ float BmsAlgo::GetChargeCurrent(float maxCellVoltage)
    return result;
 }
 
-/**
- * @brief Calculates a limiting factor based on the minimum cell voltage and a specified limit.
- *
- * This function determines a limiting factor that scales linearly based on the difference
- * between the provided minimum voltage and a specified limit. The limiting factor is
- * designed to start limiting when the minimum voltage is 50 mV above the specified limit.
- * The resulting factor is constrained to a range between 0 and 1.
+/** \brief Looks up a derating factor
  *
- * @param minVoltage The minimum voltage of the cell, expressed as a float.
- * @param limit The voltage limit to compare against, expressed as a float.
+ * \param curve which curve to use
+ * \param x input of the curve: temperature in °C, or for DRT_DISCHARGE_LOWVOLT
+ *        the lowest cell voltage above ucellmin in mV
+ * \return float factor for the current limit, 0 inhibits, 1 doesn't derate
  *
- * @return A float representing the limiting factor, which will be in the range [0, 1].
- *         A factor of 0 indicates no limitation, while a factor of 1 indicates full
- *         limitation based on the minimum voltage.
- */
-float BmsAlgo::LimitMinimumCellVoltage(float minVoltage, float limit)
-{
-   float factor = (minVoltage - limit) / 50; //start limiting 50mV before hitting minimum
-   factor = MAX(0, factor);
-   factor = MIN(1, factor);
-   return factor;
-}
-
-/**
- * @brief Calculates the derating factor for battery charging based on low temperature.
- *
- * This function determines a derating factor for battery charging based on the
- * provided low temperature. The derating is applied to ensure safe charging
- * conditions at low temperatures. The function defines specific temperature thresholds
- * to adjust the charging factor:
- * - Above 25°C, the ideal charge curve is allowed (factor = 1).
- * - Between 0°C and 25°C, the factor increases linearly from a minimum value
- *   (factorAtDrt2 = 0.3) to 1 as the temperature rises.
- * - Between -20°C and 0°C, the factor decreases linearly from the minimum value
- *   to 0.
- * - Below -20°C, charging is inhibited (factor = 0).
- *
- * @param lowTemp The low temperature value, expressed as a float.
- *
- * @return A float representing the derating factor for charging, which will be in
- *         the range [0, 1]. A factor of 0 indicates that charging is inhibited,
- *         while a factor of 1 indicates no derating.
  */
-float BmsAlgo::LowTemperatureDerating(float lowTemp)
+float BmsAlgo::GetDerating(Derating curve, float x)
 {
-   const float drt1Temp = 25.0f;
-   const float drt2Temp = 0;
-   const float drt3Temp = -20.0f;
-   const float factorAtDrt2 = 0.3f;
-   float factor;
-
-   //We allow the ideal charge curve above 25°C
-   if (lowTemp > drt1Temp)
-      factor = 1;
-   else if (lowTemp > drt2Temp) //above 0°C allow at least factorAtDrt2 fraction of the charge current and ramp up linearly with temperature
-      factor = factorAtDrt2 + (1 - factorAtDrt2) * (lowTemp - drt2Temp) / (drt1Temp - drt2Temp);
-   else if (lowTemp > drt3Temp) //below 0°C ramp down linearly
-      factor = factorAtDrt2 * (lowTemp - drt3Temp) / (drt2Temp - drt3Temp);
-   else
-      factor = 0; //inhibit charging below -20°C
-
-   return factor;
+   return deratingCurves[curve].Get(x);
 }
 
-/**
- * @brief Calculates the derating factor for battery current based on high temperature.
+/** \brief Replaces the points of a derating curve
  *
- * This function determines a derating factor for battery current based on the
- * provided high temperature and a maximum temperature limit. The derating factor
- * is calculated to ensure safe operating conditions at high temperatures. The
- * factor is derived from the difference between the maximum temperature and the
- * current high temperature, scaled by a factor of 0.15.
+ * \param curve which curve to replace
+ * \param x breakpoints, strictly increasing
+ * \param factor derating factor 0..1 at each breakpoint
+ * \param n number of points
+ * \return true when the curve was taken, false keeps the previous curve
  *
- * The resulting factor is constrained to be within the range [0, 1].
- *
- * @param highTemp The high temperature value, expressed as a float.
- * @param maxTemp The maximum allowable temperature, expressed as a float.
- *
- * @return A float representing the derating factor for charging, which will be in
- *         the range [0, 1]. A factor of 0 indicates full derating, while a factor
- *         of 1 indicates no derating.
  */
-float BmsAlgo::HighTemperatureDerating(float highTemp, float maxTemp)
+bool BmsAlgo::SetDeratingCurve(Derating curve, const float* x, const float* factor, int n)
 {
-   float factor = (maxTemp - highTemp) * 0.15f;
-   factor = MIN(1, factor);
-   factor = MAX(0, factor);
-
-   return factor;
+   return deratingCurves[curve].Load(x, factor, n);
 }
 
 /** \brief Sets a lookup point for open circuit SoC estimation
@@ -280,3 +250,117 @@ float BmsAlgo::CalculateSoH(float lastSoc, float newSoc, float asDiff)
    }
    return soh;
 }
+
+/** \brief Sets the parameters of the lumped thermal model
+ *
+ * The cell core is a single thermal mass that is heated by I²R and cools
+ * towards the temperature sensor through a thermal resistance.
+ *
+ * \param resistance Resistance of one series element in mOhm, 0 uses the estimate
+ * \param rth Thermal resistance from core to sensor in K/W
+ * \param tau Thermal time constant of the core in s
+ * \param horizon How far PredictCoreTemperature() looks ahead in s
+ *
+ */
+void BmsAlgo::SetThermalModel(float resistance, float rth, float tau, float horizon)
+{
+   cellResistance = resistance;
+   thermalResistance = rth;
+   timeConstant = MAX(1, tau);
+   horizonDecay = expf(-horizon / timeConstant);
+}
+
+/** \brief Estimates the resistance of a series element from current steps
+ *
+ * A step of at least RES_STEP_CURRENT starts a measurement. When the current has
+ * stayed at the new level for RES_SETTLE_UPDATES calls, the voltage change over
+ * the current change is filtered into the estimate. Must be called at 10 Hz.
+ *
+ * \param voltage average cell voltage in mV
+ * \param current battery current in A, positive when charging
+ * \return float estimated resistance in mOhm, 0 until the first step was seen
+ *
+ */
+float BmsAlgo::EstimateResistance(float voltage, float current)
+{
+   if (settleCount > 0)
+   {
+      if (ABS(current - stepCurrent) > (RES_STEP_CURRENT / 2))
+      {
+         settleCount = 0; //current moved on, the voltage doesn't belong to the step
+      }
+      else if (--settleCount == 0)
+      {
+         float r = (voltage - refVoltage) / (current - refCurrent); //mV/A = mOhm
+
+         if (r > RES_MIN && r < RES_MAX)
+         {
+            if (estimatedResistance > 0)
+               estimatedResistance += (r - estimatedResistance) * RES_FILTER_GAIN;
+            else
+               estimatedResistance = r;
+         }
+      }
+      else
+      {
+         return estimatedResistance; //keep the voltage from before the step
+      }
+   }
+   else if (ABS(current - refCurrent) > RES_STEP_CURRENT)
+   {
+      stepCurrent = current;
+      settleCount = RES_SETTLE_UPDATES;
+      return estimatedResistance;
+   }
+
+   refVoltage = voltage;
+   refCurrent = current;
+
+   return estimatedResistance;
+}
+
+/** \brief Advances the thermal model by one 100 ms step
+ *
+ * \param current battery current in A
+ * \param sensorTemp temperature at the sensor in °C
+ * \return float estimated core temperature in °C
+ *
+ */
+float BmsAlgo::UpdateCoreTemperature(float current, float sensorTemp)
+{
+   coreRise += (GetHeatingRise(current) - coreRise) * THERMAL_DT / timeConstant;
+   return sensorTemp + coreRise;
+}
+
+/** \brief Predicts the core temperature at the configured horizon
+ *
+ * Assumes the current and sensor temperature stay as they are. The core then
+ * approaches its steady state rise exponentially with the thermal time constant.
+ *
+ * \param current battery current in A
+ * \param sensorTemp temperature at the sensor in °C
+ * \return float predicted core temperature in °C
+ *
+ */
+float BmsAlgo::PredictCoreTemperature(float current, float sensorTemp)
+{
+   float steadyRise = GetHeatingRise(current);
+   return sensorTemp + steadyRise + (coreRise - steadyRise) * horizonDecay;
+}
+
+void BmsAlgo::ResetThermalModel()
+{
+   coreRise = 0;
+   estimatedResistance = 0;
+   settleCount = 0;
+   refVoltage = 0;
+   refCurrent = 0;
+}
+
+/** \brief Steady state temperature rise of the core at the given current */
+float BmsAlgo::GetHeatingRise(float current)
+{
+   float resistance = cellResistance > 0 ? cellResistance : estimatedResistance;
+   float power = current * current * resistance / 1000; //W
+   return power * thermalResistance;
+}
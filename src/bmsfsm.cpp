@@ -22,6 +22,8 @@
 #include "my_math.h"
 #include "flyingadcbms.h"
 #include "selftest.h"
+#include "eventlog.h"
+#include "clock.h"
 
 #define IS_FIRST_THRESH       1800
 #define IS_ENABLED_THRESH     500
@@ -29,7 +31,7 @@
 #define BOOT_DELAY_CYCLES     5
 
 BmsFsm::BmsFsm(CanMap* cm, CanSdo* cs)
-   : canMap(cm), canSdo(cs), isMain(false), infoIndex(1), numModules(1), cycles(0)
+   : canMap(cm), canSdo(cs), isMain(false), infoIndex(1), numModules(1), cycles(0), idleSince(0)
 {
    cm->GetHardware()->AddCallback(this);
    HandleClear();
@@ -72,7 +74,7 @@ BmsFsm::bmsstate BmsFsm::Run(bmsstate currentState)
    uint32_t data[2] = { 0 };
    uint32_t sdoReply;
    float idleCurrentThreshold = 0.0f;
-   uint32_t sleepTimeoutCycles = 0;
+   uint32_t sleepTimeoutMs = 0;
 
    switch (currentState)
    {
@@ -98,6 +100,7 @@ BmsFsm::bmsstate BmsFsm::Run(bmsstate currentState)
       {
          ourNodeId = recvNodeId;
          ourIndex = recvIndex;
+         EventLog::SetModule(ourIndex);
          pdobase = recvPdoBase;
          canSdo->SetNodeId(ourNodeId);
          DigIo::nextena_out.Set();
@@ -163,6 +166,7 @@ BmsFsm::bmsstate BmsFsm::Run(bmsstate currentState)
          if (cycles > ((uint32_t)Param::GetInt(Param::idlewait) * 10))
          {
             cycles = 0;
+            idleSince = Clock::GetMs();
             return IDLE;
          }
       }
@@ -182,12 +186,12 @@ BmsFsm::bmsstate BmsFsm::Run(bmsstate currentState)
          return RUN;
       }
 
-      // Calculate sleep timeout in cycles (100ms per cycle)
-      // 3600 cycles = 1 hour, multiply by sleeptimeout parameter (in hours)
-      sleepTimeoutCycles = (uint32_t)(Param::GetFloat(Param::sleeptimeout) * 3600 * 10);
-      
+      // Sleep timeout in ms, sleeptimeout is in hours. This is clock time rather
+      // than calls, because in low power mode we are only called during scans
+      sleepTimeoutMs = (uint32_t)(Param::GetFloat(Param::sleeptimeout) * 3600 * 1000);
+
       // Turn off after sleep timeout if not enabled
-      if (cycles > sleepTimeoutCycles && !IsEnabled())
+      if ((Clock::GetMs() - idleSince) > sleepTimeoutMs && !IsEnabled())
       {
          DigIo::selfena_out.Clear();
          DigIo::nextena_out.Clear();
@@ -203,7 +207,7 @@ BmsFsm::bmsstate BmsFsm::Run(bmsstate currentState)
 
 Param::PARAM_NUM BmsFsm::GetDataItem(Param::PARAM_NUM baseItem, int modNum)
 {
-   const int numberOfParametersPerModule = 5;
+   const int numberOfParametersPerModule = 6;
    if (modNum < 0) modNum = ourIndex;
 
    return (Param::PARAM_NUM)((int)baseItem + modNum * numberOfParametersPerModule);
@@ -243,6 +247,7 @@ void BmsFsm::MapCanSubmodule()
 {
    int id = pdobase + ourIndex + 1; //main module has two PDO messages
    canMap->AddSend(Param::umin0, id, 0, 13, 1);
+   canMap->AddSend(Param::tempflt0, id, 13, 2, 1);
    canMap->AddSend(Param::umax0, id, 16, 13, 1);
    canMap->AddSend(Param::counter, id, 30, 2, 1);
    canMap->AddSend(Param::uavg0, id, 32, 13, 1);
@@ -261,6 +266,7 @@ void BmsFsm::MapCanMainmodule()
    {
       int id = pdobase + i + 1;
       canMap->AddRecv(GetDataItem(Param::umin0, i), id, 0, 13, 1);
+      canMap->AddRecv(GetDataItem(Param::tempflt0, i), id, 13, 2, 1);
       canMap->AddRecv(GetDataItem(Param::umax0, i), id, 16, 13, 1);
       canMap->AddRecv(GetDataItem(Param::uavg0, i), id, 32, 13, 1);
       canMap->AddRecv(GetDataItem(Param::tempmin0, i), id, 48, 8, 1, -40);
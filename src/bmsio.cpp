@@ -16,22 +16,41 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <libopencm3/stm32/f1/bkp.h>
 #include "bmsio.h"
 #include "params.h"
 #include "anain.h"
+#include "digio.h"
 #include "temp_meas.h"
 #include "my_math.h"
 #include "flyingadcbms.h"
+#include "bmsalgo.h"
+#include "fasttrip.h"
+#include "protection.h"
+#include "eventlog.h"
 
 BmsFsm* BmsIO::bmsFsm;
+uint8_t BmsIO::chan = 0;
+TempSensor BmsIO::tempSensor1;
+TempSensor BmsIO::tempSensor2;
+TempSensor BmsIO::muxSensors[MAX_TEMP_MUX];
+uint8_t BmsIO::muxChan = 0;
+
+/** \brief Balancing is done in IDLE when the average cell voltage is above ubalance */
+bool BmsIO::IsBalancingWanted()
+{
+   return Param::GetInt(Param::opmode) == BmsFsm::IDLE &&
+          Param::GetFloat(Param::uavg) > Param::GetFloat(Param::ubalance) &&
+          BAL_OFF != Param::GetInt(Param::balmode);
+}
 
 void BmsIO::ReadCellVoltages()
 {
    const int totalBalanceCycles = 30;
-   static uint8_t chan = 0, balanceCycles = 0;
+   static uint8_t balanceCycles = 0;
    static float sum = 0, min, max, avg;
    int balMode = Param::GetInt(Param::balmode);
-   bool balance = Param::GetInt(Param::opmode) == BmsFsm::IDLE && Param::GetFloat(Param::uavg) > Param::GetFloat(Param::ubalance) && BAL_OFF != balMode;
+   bool balance = IsBalancingWanted();
    FlyingAdcBms::BalanceStatus bstt;
 
    if (balance)
@@ -110,6 +129,7 @@ void BmsIO::ReadCellVoltages()
       float udc = FlyingAdcBms::GetResult() * (gain / 1000.0f);
 
       Param::SetFloat((Param::PARAM_NUM)(Param::u0 + chan), udc);
+      FastTrip::CheckCell(chan, udc);
 
       min = MIN(min, udc);
       max = MAX(max, udc);
@@ -156,28 +176,74 @@ void BmsIO::ReadCellVoltages()
 
       FlyingAdcBms::SelectChannel(chan);
       FlyingAdcBms::StartAdc();
+      FastTrip::ConversionStarted();
+   }
+}
+
+/** \brief Oversample the NTC inputs, called every 25 ms
+ * With an external mux on the temp2 input one mux channel is sampled per call.
+ * The next channel is selected right after, so it has 25 ms to settle.
+ */
+void BmsIO::SampleTemperatures()
+{
+   int muxChannels = Param::GetInt(Param::tempmuxch);
+
+   tempSensor1.Sample(AnaIn::temp1.Get());
+
+   if (muxChannels > 0)
+   {
+      if (muxChan < muxChannels)
+         muxSensors[muxChan].Sample(AnaIn::temp2.Get());
+
+      muxChan = muxChan + 1 < muxChannels ? muxChan + 1 : 0;
+      SelectTempMux(muxChan);
+   }
+   else
+   {
+      tempSensor2.Sample(AnaIn::temp2.Get());
    }
 }
 
 void BmsIO::ReadTemperatures()
 {
    int sensor = Param::GetInt(Param::tempsns);
-   int nomRes = Param::GetInt(Param::tempres);
-   int beta = Param::GetInt(Param::tempbeta);
-   float temp1 = NO_TEMP, temp2 = NO_TEMP, tempmin = NO_TEMP, tempmax = NO_TEMP;
+   int muxChannels = Param::GetInt(Param::tempmuxch);
+   float tempmin = NO_TEMP, tempmax = -NO_TEMP;
+   //A failed sensor is left out, the others are still used
+   bool valid1 = (sensor & 1) && tempSensor1.Update();
+   bool valid2 = muxChannels == 0 && (sensor & 2) && tempSensor2.Update();
+   bool muxFailed = false;
 
-   if (sensor & 1)
-      tempmin = tempmax = temp1 = TempMeas::AdcToTemperature(AnaIn::temp1.Get(), nomRes, beta);
+   if (valid1)
+      AddTemperature(tempSensor1.Get(), tempmin, tempmax);
 
-   if (sensor & 2)
-      tempmin = tempmax = temp2 = TempMeas::AdcToTemperature(AnaIn::temp2.Get(), nomRes, beta);
+   if (valid2)
+      AddTemperature(tempSensor2.Get(), tempmin, tempmax);
 
-   if (sensor == 3) //two sensors, calculate min and max
+   for (int i = 0; i < muxChannels; i++)
    {
-      tempmin = MIN(temp1, temp2);
-      tempmax = MAX(temp1, temp2);
+      bool valid = muxSensors[i].Update();
+
+      if (valid)
+         AddTemperature(muxSensors[i].Get(), tempmin, tempmax);
+      else
+         muxFailed = true;
+
+      Param::SetFloat((Param::PARAM_NUM)(Param::tmux0 + i), valid ? muxSensors[i].Get() : NO_TEMP);
    }
 
+   if (tempmax < tempmin) //no working sensor
+      tempmin = tempmax = NO_TEMP;
+
+   Param::SetInt(Param::t1stt, (sensor & 1) ? tempSensor1.GetStatus() : TempSensor::SNS_OK);
+   Param::SetInt(Param::t2stt, muxChannels == 0 && (sensor & 2) ? tempSensor2.GetStatus() : TempSensor::SNS_OK);
+   bool failed2 = muxChannels == 0 ? (sensor & 2) && !valid2 : muxFailed;
+   int tempflt = ((sensor & 1) && !valid1) | (failed2 << 1);
+
+   if (tempflt != Param::GetInt(Param::tempflt0))
+      EventLog::Record(EventLog::EVT_TEMPSENSOR, 0, tempflt);
+
+   Param::SetInt(Param::tempflt0, tempflt);
    Param::SetFloat(Param::tempmin0, tempmin);
    Param::SetFloat(Param::tempmax0, tempmax);
 }
@@ -240,6 +306,89 @@ void BmsIO::MeasureCurrent()
    }
 }
 
+/** \brief Updates SoC by coulomb counting and re-estimates SoC and SoH from open circuit voltage in IDLE
+ *
+ * \param stt state the FSM is in now
+ * \param laststt state the FSM was in during the previous call
+ *
+ */
+void BmsIO::CalculateSocSoh(BmsFsm::bmsstate stt, BmsFsm::bmsstate laststt)
+{
+   static float estimatedSoc = 0, estimatedSocAtValidSoh = -1, asDiffAfterEstimate = 0, soh = 0;
+   float asDiff = Param::GetFloat(Param::chargein) - Param::GetFloat(Param::chargeout);
+
+   if (estimatedSoc == 0)
+   {
+      estimatedSoc = Param::GetFloat(Param::soc);
+      estimatedSocAtValidSoh = estimatedSoc;
+   }
+
+   /* if we change over from IDLE to RUN we have to stop all estimation processes
+      because there is now current through the battery again, skewing open voltage readings.
+      So the estimations do not get any better at this point and we store the results */
+   if (laststt == BmsFsm::IDLE && stt == BmsFsm::RUN)
+   {
+      /* Remember the Ampere Seconds at the point of the last estimation
+         in order to be prepared for the next estimation */
+      asDiffAfterEstimate = asDiff;
+
+      /* If the SoC difference was large enough we have a valid SoH */
+      if (soh > 0)
+      {
+         float lastSoh = (float)BKP_DR2 / 100.0f;
+         //Don't just overwrite the existing SoH but average it to the existing SoH with a slow IIR filter
+         soh = IIRFILTERF(lastSoh, soh, 10);
+         //Store in NVRAM
+         BKP_DR2 = (uint16_t)(soh * 100);
+         Param::SetFloat(Param::soh, soh);
+         Param::SetFloat(Param::sohpreset, soh);
+         /* Remember SoC at the point of this estimation
+            in order to be prepared for the next estimation */
+         estimatedSocAtValidSoh = estimatedSoc;
+         BmsAlgo::SetNominalCapacity(Param::GetFloat(Param::nomcap) * soh / 100.0f);
+      }
+   }
+
+   /* IDLE state means we haven't seen any current for some (configurable) time
+      so cell voltage is approaching the true open circuit voltage */
+   if (stt == BmsFsm::IDLE && Param::GetFloat(Param::idc) < 0.8f)
+   {
+      estimatedSoc = BmsAlgo::EstimateSocFromVoltage(Param::GetFloat(Param::umin));
+      Param::SetFloat(Param::soc, estimatedSoc);
+      //Store estimated SoC in NVRAM
+      BKP_DR1 = (uint16_t)(estimatedSoc * 100);
+
+      soh = BmsAlgo::CalculateSoH(estimatedSocAtValidSoh, estimatedSoc, asDiff - asDiffAfterEstimate);
+
+      if (estimatedSocAtValidSoh < 0)
+         estimatedSocAtValidSoh = estimatedSoc;
+   }
+   else
+   {
+      float soc = BmsAlgo::CalculateSocFromIntegration(estimatedSoc, asDiff - asDiffAfterEstimate);
+      Param::SetFloat(Param::soc, soc);
+      BKP_DR1 = (uint16_t)(soc * 100);
+   }
+}
+
+/** \brief Restores SoC and SoH from the battery backed registers after power up */
+void BmsIO::LoadNVRAM()
+{
+   float soc = (float)BKP_DR1 / 100.0f;
+
+   if (soc >= 0 && soc <= 100)
+      Param::SetFloat(Param::soc, soc);
+
+   if (BKP_DR2 != 0)
+      Param::SetFloat(Param::soh, (float)BKP_DR2 / 100.0f);
+   else
+      Param::SetFixed(Param::soh, Param::Get(Param::sohpreset));
+
+   //Param::Change() ran before we knew the SoH
+   BmsAlgo::SetNominalCapacity(Param::GetFloat(Param::nomcap) * Param::GetFloat(Param::soh) / 100.0f);
+}
+
+
 void BmsIO::TestReadCellVoltage(int chan, FlyingAdcBms::BalanceCommand cmd)
 {
    float gain = Param::GetFloat(Param::gain);
@@ -258,6 +407,32 @@ void BmsIO::TestReadCellVoltage(int chan, FlyingAdcBms::BalanceCommand cmd)
    Param::SetFloat((Param::PARAM_NUM)(Param::u0 + chan), udc);
 }
 
+void BmsIO::AddTemperature(float temp, float& tempmin, float& tempmax)
+{
+   tempmin = MIN(tempmin, temp);
+   tempmax = MAX(tempmax, temp);
+}
+
+/** \brief Drive the mux address lines only when a mux is fitted
+ * Otherwise PB12, PA15 and PB8 stay floating inputs.
+ * \param channels number of NTCs on the mux, tempmuxch
+ */
+void BmsIO::ConfigureTempMux(int channels)
+{
+   PinMode::PinMode mode = channels > 0 ? PinMode::OUTPUT : PinMode::INPUT_FLT;
+
+   DigIo::tmux_a0.Configure(GPIOB, GPIO12, mode);
+   DigIo::tmux_a1.Configure(GPIOA, GPIO15, mode);
+   DigIo::tmux_a2.Configure(GPIOB, GPIO8, mode);
+}
+
+void BmsIO::SelectTempMux(int channel)
+{
+   if (channel & 1) DigIo::tmux_a0.Set(); else DigIo::tmux_a0.Clear();
+   if (channel & 2) DigIo::tmux_a1.Set(); else DigIo::tmux_a1.Clear();
+   if (channel & 4) DigIo::tmux_a2.Set(); else DigIo::tmux_a2.Clear();
+}
+
 void BmsIO::Accumulate(float sum, float min, float max, float avg)
 {
    if (bmsFsm->IsFirst())
@@ -297,6 +472,7 @@ void BmsIO::Accumulate(float sum, float min, float max, float avg)
       Param::SetFloat(Param::utotal, totalSum);
       Param::SetFloat(Param::tempmin, tempmin);
       Param::SetFloat(Param::tempmax, tempmax);
+      Protection::Evaluate();
    }
    else //if we are a sub module write averages straight to data module
    {
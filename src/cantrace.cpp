@@ -0,0 +1,167 @@
+/*
+ * This file is part of the FlyingADCBMS project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "cantrace.h"
+#include "clock.h"
+
+CanTrace::Entry CanTrace::buffer[CANTRACE_ENTRIES];
+volatile uint32_t CanTrace::head;
+volatile CanTrace::Mode CanTrace::mode = CanTrace::STOPPED;
+uint32_t CanTrace::selected;
+
+class TraceCallback: public CanCallback
+{
+public:
+   void HandleRx(uint32_t canId, uint32_t data[2], uint8_t dlc) override
+   {
+      CanTrace::Record(canId, data, dlc, false);
+      Counters::Increment(Counters::CNT_CAN_RX);
+   }
+
+   void HandleClear() override {}
+};
+
+static TraceCallback traceCallback;
+
+/** \brief Have all frames received on hw recorded */
+void CanTrace::Attach(CanHardware* hw)
+{
+   hw->AddCallback(&traceCallback);
+}
+
+/** \brief Start or stop recording. Starting always clears the buffer */
+void CanTrace::SetMode(Mode m)
+{
+   mode = STOPPED;
+
+   if (m != STOPPED)
+   {
+      head = 0;
+      selected = 0;
+   }
+   mode = m;
+}
+
+/** \brief Append one frame, may be called from interrupt context
+ *
+ * The slot is claimed atomically so that frames received in the CAN
+ * interrupt do not tear frames sent from a task.
+ */
+void CanTrace::Record(uint32_t canId, const uint32_t data[2], uint8_t dlc, bool tx)
+{
+   Mode m = mode;
+
+   if (m == STOPPED) return;
+
+   uint32_t slot = __atomic_fetch_add(&head, 1, __ATOMIC_RELAXED);
+
+   if (m == ONESHOT && slot >= CANTRACE_ENTRIES)
+   {
+      head = CANTRACE_ENTRIES;
+      mode = STOPPED;
+      return;
+   }
+
+   Entry& e = buffer[slot % CANTRACE_ENTRIES];
+   uint32_t now = Clock::GetMs();
+
+   e.time = (now & TIME_MASK) | ((uint32_t)(dlc & 0xF) << 28);
+   e.id = canId | (tx ? FLAG_TX : 0);
+   e.data[0] = data[0];
+   e.data[1] = data[1];
+}
+
+int CanTrace::GetCount()
+{
+   uint32_t n = head;
+   return n < CANTRACE_ENTRIES ? n : CANTRACE_ENTRIES;
+}
+
+/** \brief Get recorded frame, index 0 being the oldest one still in the buffer
+ * \return entry or 0 when index is out of range
+ */
+const CanTrace::Entry* CanTrace::GetEntry(int index)
+{
+   uint32_t n = head;
+   int count = GetCount();
+
+   if (index < 0 || index >= count) return 0;
+
+   return &buffer[(n - count + index) % CANTRACE_ENTRIES];
+}
+
+/** \brief Serve SDO_INDEX_CANTRACE
+ * \return true if the frame was ours and has been turned into a reply
+ */
+bool CanTrace::ProcessSdo(CanSdo::SdoFrame* sdoFrame)
+{
+   if (sdoFrame->index != SDO_INDEX_CANTRACE) return false;
+
+   uint32_t error = 0;
+
+   if (sdoFrame->cmd == SDO_WRITE)
+   {
+      if (sdoFrame->subIndex == SDO_CANTRACE_MODE && sdoFrame->data <= ONESHOT)
+         SetMode((Mode)sdoFrame->data);
+      else if (sdoFrame->subIndex == SDO_CANTRACE_MODE)
+         error = SDO_ERR_RANGE;
+      else if (sdoFrame->subIndex == SDO_CANTRACE_SELECT)
+         selected = sdoFrame->data;
+      else
+         error = SDO_ERR_INVIDX;
+
+      sdoFrame->cmd = SDO_WRITE_REPLY;
+   }
+   else if (sdoFrame->cmd == SDO_READ)
+   {
+      const Entry* e = GetEntry(selected);
+
+      switch (sdoFrame->subIndex)
+      {
+      case SDO_CANTRACE_MODE: sdoFrame->data = mode; break;
+      case SDO_CANTRACE_COUNT: sdoFrame->data = GetCount(); break;
+      case SDO_CANTRACE_SELECT: sdoFrame->data = selected; break;
+      case SDO_CANTRACE_TIME: sdoFrame->data = e ? e->time : 0; break;
+      case SDO_CANTRACE_ID: sdoFrame->data = e ? e->id : 0; break;
+      case SDO_CANTRACE_DATA0: sdoFrame->data = e ? e->data[0] : 0; break;
+      case SDO_CANTRACE_DATA1:
+         sdoFrame->data = e ? e->data[1] : 0;
+         selected += e != 0;
+         break;
+      default:
+         error = SDO_ERR_INVIDX;
+         break;
+      }
+
+      if (0 == e && sdoFrame->subIndex >= SDO_CANTRACE_TIME && sdoFrame->subIndex <= SDO_CANTRACE_DATA1)
+         error = SDO_ERR_RANGE;
+
+      sdoFrame->cmd = SDO_READ_REPLY;
+   }
+   else
+   {
+      error = SDO_ERR_INVIDX;
+   }
+
+   if (error != 0)
+   {
+      sdoFrame->cmd = SDO_ABORT;
+      sdoFrame->data = error;
+   }
+   return true;
+}
@@ -0,0 +1,278 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <libopencm3/cm3/cortex.h>
+#include "cellreport.h"
+#include "clock.h"
+#include "bmsio.h"
+#include "executor.h"
+#include "params.h"
+
+//The main module receives the values of this many modules into umin0 to umin7 and so on
+static const int SUMMARY_MODULES = (Param::umin7 - Param::umin0) / (Param::umin1 - Param::umin0) + 1;
+
+CellReport::Module CellReport::latched;
+BmsFsm* CellReport::bmsFsm;
+CanSdo* CellReport::canSdo;
+volatile uint32_t CellReport::replyId;
+volatile uint8_t CellReport::replySubIndex;
+volatile uint32_t CellReport::replyValue;
+volatile uint8_t CellReport::replyCmd;
+
+class ReplyCallback: public CanCallback
+{
+public:
+   void HandleRx(uint32_t canId, uint32_t data[2], uint8_t) override
+   {
+      CellReport::HandleReply(canId, data);
+   }
+
+   void HandleClear() override {}
+};
+
+static ReplyCallback replyCallback;
+
+/** \brief Have the SDO replies received on hw checked against the pending remote read */
+void CellReport::Attach(CanHardware* hw)
+{
+   hw->AddCallback(&replyCallback);
+}
+
+/** \brief Takes the reply of the pending remote read, may be called from interrupt context
+ * Replies from other nodes, to other indexes or to an earlier sub index are discarded
+ */
+void CellReport::HandleReply(uint32_t canId, const uint32_t data[2])
+{
+   const CanSdo::SdoFrame* frame = (const CanSdo::SdoFrame*)data;
+
+   if (canId != replyId || frame->index != SDO_INDEX_CELLS || frame->subIndex != replySubIndex) return;
+   if (frame->cmd != SDO_READ_REPLY && frame->cmd != SDO_ABORT) return;
+
+   replyValue = frame->data;
+   __atomic_store_n(&replyCmd, frame->cmd, __ATOMIC_RELEASE);
+}
+
+/** \brief Copies the cell voltages and balancer states of this module */
+void CellReport::TakeLocal(Module& m)
+{
+   cm_disable_interrupts();
+
+   m.cells = Param::GetInt(Param::numchan);
+   m.balance = 0;
+
+   for (int i = 0; i < MAX_CELLS; i++)
+   {
+      m.voltage[i] = i < m.cells ? Param::GetInt((Param::PARAM_NUM)(Param::u0 + i)) : 0;
+      m.balance |= (uint32_t)(Param::GetInt((Param::PARAM_NUM)(Param::u0cmd + i)) & 3) << (2 * i);
+   }
+
+   cm_enable_interrupts();
+}
+
+/** \brief Takes the cells of the given module, remote modules are read via SDO
+ * \return false when a remote module didn't answer or the modules are still being enumerated
+ */
+bool CellReport::TakeModule(int module, Module& m)
+{
+   uint32_t value;
+
+   if (module == bmsFsm->GetIndex())
+   {
+      TakeLocal(m);
+      return true;
+   }
+
+   //The state machine reads the module info with the same SDO client
+   if (Param::GetInt(Param::opmode) < BmsFsm::INIT) return false;
+
+   uint8_t node = Param::GetInt(Param::sdobase) + module;
+
+   if (!ReadRemote(node, SDO_CELLS_COUNT, value)) return false;
+   m.cells = value < MAX_CELLS ? value : MAX_CELLS;
+
+   if (!ReadRemote(node, SDO_CELLS_BALANCE, value)) return false;
+   m.balance = value;
+
+   for (int i = 0; i < MAX_CELLS; i += 2)
+   {
+      if (i < m.cells && !ReadRemote(node, SDO_CELLS_VOLTAGE + i / 2, value)) return false;
+
+      m.voltage[i] = i < m.cells ? value & 0xFFFF : 0;
+      m.voltage[i + 1] = i + 1 < m.cells ? value >> 16 : 0;
+   }
+   return true;
+}
+
+/** \brief Copies the pack values and the summaries of all modules this module knows
+ * The main module knows all modules, a sub module only itself. Modules beyond the
+ * summary parameters are read via SDO, so this yields like TakeModule()
+ */
+void CellReport::TakePack(Pack& p)
+{
+   bool isMain = bmsFsm->IsFirst();
+
+   p.firstModule = isMain ? 0 : bmsFsm->GetIndex();
+   p.modules = isMain ? bmsFsm->GetNumberOfModules() : 1;
+   if (p.modules > MAX_MODULES) p.modules = MAX_MODULES;
+
+   cm_disable_interrupts();
+
+   p.utotal = Param::GetFloat(Param::utotal);
+   p.uavg = Param::GetFloat(Param::uavg);
+   p.umin = Param::GetFloat(Param::umin);
+   p.umax = Param::GetFloat(Param::umax);
+   p.udelta = Param::GetFloat(Param::udelta);
+   p.idc = Param::GetFloat(Param::idc);
+   p.idcavg = Param::GetFloat(Param::idcavg);
+   p.power = Param::GetFloat(Param::power);
+   p.soc = Param::GetFloat(Param::soc);
+   p.soh = Param::GetFloat(Param::soh);
+   p.chargelim = Param::GetFloat(Param::chargelim);
+   p.dischargelim = Param::GetFloat(Param::dischargelim);
+   p.tempmin = Param::GetFloat(Param::tempmin);
+   p.tempmax = Param::GetFloat(Param::tempmax);
+   p.opmode = Param::GetInt(Param::opmode);
+   p.protlevel = Param::GetInt(Param::protlevel);
+   p.cells = isMain ? Param::GetInt(Param::totalcells) : Param::GetInt(Param::numchan);
+
+   for (int i = 0; i < p.modules && i < SUMMARY_MODULES; i++)
+   {
+      //A sub module keeps its own values in the slot of module 0
+      int slot = isMain ? i : 0;
+      ModuleSummary& s = p.module[i];
+
+      s.umin = Param::GetFloat(bmsFsm->GetDataItem(Param::umin0, slot));
+      s.umax = Param::GetFloat(bmsFsm->GetDataItem(Param::umax0, slot));
+      s.uavg = Param::GetFloat(bmsFsm->GetDataItem(Param::uavg0, slot));
+      s.tempmin = Param::GetFloat(bmsFsm->GetDataItem(Param::tempmin0, slot));
+      s.tempmax = Param::GetFloat(bmsFsm->GetDataItem(Param::tempmax0, slot));
+      s.tempflt = Param::GetInt(bmsFsm->GetDataItem(Param::tempflt0, slot));
+   }
+
+   cm_enable_interrupts();
+
+   for (int i = SUMMARY_MODULES; i < p.modules; i++)
+      SummarizeRemote(i, p.module[i]);
+
+   p.uminModule = p.umaxModule = p.tempminModule = p.tempmaxModule = 0xFF;
+
+   for (int i = 0; i < p.modules; i++)
+   {
+      const ModuleSummary& s = p.module[i];
+
+      if (s.umax <= 0) continue;
+
+      if (p.uminModule == 0xFF || s.umin < p.module[p.uminModule].umin) p.uminModule = i;
+      if (p.umaxModule == 0xFF || s.umax > p.module[p.umaxModule].umax) p.umaxModule = i;
+
+      //Modules without a working sensor report NO_TEMP
+      if (s.tempmin >= NO_TEMP) continue;
+
+      if (p.tempminModule == 0xFF || s.tempmin < p.module[p.tempminModule].tempmin) p.tempminModule = i;
+      if (p.tempmaxModule == 0xFF || s.tempmax > p.module[p.tempmaxModule].tempmax) p.tempmaxModule = i;
+   }
+}
+
+/** \brief Summary of a module that has no values of its own in the parameters,
+ * taken from its cells. Such a module reports no temperatures
+ */
+void CellReport::SummarizeRemote(int module, ModuleSummary& s)
+{
+   Module m;
+
+   s.umin = s.umax = s.uavg = 0;
+   s.tempmin = s.tempmax = NO_TEMP;
+   s.tempflt = 0;
+
+   if (!TakeModule(module, m) || m.cells == 0) return;
+
+   float sum = 0;
+
+   s.umin = m.voltage[0];
+
+   for (int i = 0; i < m.cells; i++)
+   {
+      s.umin = m.voltage[i] < s.umin ? m.voltage[i] : s.umin;
+      s.umax = m.voltage[i] > s.umax ? m.voltage[i] : s.umax;
+      sum += m.voltage[i];
+   }
+   s.uavg = sum / m.cells;
+}
+
+/** \brief Serves the snapshot of this module on SDO_INDEX_CELLS
+ * \return true when the request was for us, false to pass it on
+ */
+bool CellReport::ProcessSdo(CanSdo::SdoFrame* sdoFrame)
+{
+   if (sdoFrame->index != SDO_INDEX_CELLS) return false;
+
+   uint32_t error = 0;
+   int sub = sdoFrame->subIndex;
+
+   if (sdoFrame->cmd != SDO_READ)
+   {
+      error = SDO_ERR_INVIDX;
+   }
+   else if (sub == SDO_CELLS_COUNT)
+   {
+      TakeLocal(latched);
+      sdoFrame->data = latched.cells;
+   }
+   else if (sub == SDO_CELLS_BALANCE)
+   {
+      sdoFrame->data = latched.balance;
+   }
+   else if (sub >= SDO_CELLS_VOLTAGE && sub < SDO_CELLS_VOLTAGE + MAX_CELLS / 2)
+   {
+      int chan = 2 * (sub - SDO_CELLS_VOLTAGE);
+      sdoFrame->data = latched.voltage[chan] | ((uint32_t)latched.voltage[chan + 1] << 16);
+   }
+   else
+   {
+      error = SDO_ERR_INVIDX;
+   }
+
+   sdoFrame->cmd = SDO_READ_REPLY;
+
+   if (error != 0)
+   {
+      sdoFrame->cmd = SDO_ABORT;
+      sdoFrame->data = error;
+   }
+   return true;
+}
+
+bool CellReport::ReadRemote(uint8_t node, uint8_t subIndex, uint32_t& value)
+{
+   uint32_t start = Clock::GetMs();
+   uint8_t cmd;
+
+   //A late reply to the previous read must not be taken for this one
+   replyCmd = 0;
+   replySubIndex = subIndex;
+   replyId = 0x580 + node;
+   canSdo->SDORead(node, SDO_INDEX_CELLS, subIndex);
+
+   while ((cmd = __atomic_load_n(&replyCmd, __ATOMIC_ACQUIRE)) == 0)
+   {
+      if ((Clock::GetMs() - start) > TIMEOUT_MS) return false;
+      Executor::Yield();
+   }
+   value = replyValue;
+   return cmd == SDO_READ_REPLY;
+}
@@ -0,0 +1,97 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "counters.h"
+
+volatile uint32_t Counters::values[CNT_LAST];
+
+#define COUNTER_ENTRY(id, name, kind) name,
+static const char* const names[] = { COUNTER_LIST };
+#undef COUNTER_ENTRY
+
+#define COUNTER_ENTRY(id, name, kind) Counters::kind,
+static const Counters::Kind kinds[] = { COUNTER_LIST };
+#undef COUNTER_ENTRY
+
+/** \brief Raise a gauge to value if it is larger, safe from any context */
+void Counters::Max(Id id, uint32_t value)
+{
+   uint32_t current = values[id];
+
+   while (value > current &&
+          !__atomic_compare_exchange_n(&values[id], &current, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+      ;
+}
+
+const char* Counters::GetName(Id id)
+{
+   return names[id];
+}
+
+Counters::Kind Counters::GetKind(Id id)
+{
+   return kinds[id];
+}
+
+/** \brief Zero all counters, gauges keep their value */
+void Counters::Reset()
+{
+   for (int i = 0; i < CNT_LAST; i++)
+   {
+      if (kinds[i] == COUNTER)
+         values[i] = 0;
+   }
+}
+
+/** \brief Serves the registry on SDO_INDEX_COUNTERS
+ * \return true when the request was for us, false to pass it on
+ */
+bool Counters::ProcessSdo(CanSdo::SdoFrame* sdoFrame)
+{
+   if (sdoFrame->index != SDO_INDEX_COUNTERS) return false;
+
+   uint32_t error = 0;
+   int sub = sdoFrame->subIndex;
+
+   if (sdoFrame->cmd == SDO_WRITE && sub == SDO_COUNTERS_NUM)
+   {
+      Reset();
+      sdoFrame->cmd = SDO_WRITE_REPLY;
+   }
+   else if (sdoFrame->cmd == SDO_READ && sub == SDO_COUNTERS_NUM)
+   {
+      sdoFrame->data = CNT_LAST;
+      sdoFrame->cmd = SDO_READ_REPLY;
+   }
+   else if (sdoFrame->cmd == SDO_READ && sub >= SDO_COUNTERS_FIRST && sub < SDO_COUNTERS_FIRST + CNT_LAST)
+   {
+      sdoFrame->data = values[sub - SDO_COUNTERS_FIRST];
+      sdoFrame->cmd = SDO_READ_REPLY;
+   }
+   else
+   {
+      error = SDO_ERR_INVIDX;
+   }
+
+   if (error != 0)
+   {
+      sdoFrame->cmd = SDO_ABORT;
+      sdoFrame->data = error;
+   }
+   return true;
+}
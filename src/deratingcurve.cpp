@@ -0,0 +1,69 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "deratingcurve.h"
+
+DeratingCurve::DeratingCurve(const float* x, const float* y, int n)
+   : numPoints(0)
+{
+   Load(x, y, n);
+}
+
+/** \brief Replaces the curve points
+ *
+ * \param x breakpoints, strictly increasing
+ * \param y value at each breakpoint
+ * \param n number of points, 1 to MAX_POINTS
+ * \return true when the points were taken, false leaves the curve unchanged
+ *
+ */
+bool DeratingCurve::Load(const float* x, const float* y, int n)
+{
+   if (n < 1 || n > MAX_POINTS) return false;
+
+   for (int i = 1; i < n; i++)
+   {
+      if (x[i] <= x[i - 1]) return false;
+   }
+
+   for (int i = 0; i < n; i++)
+   {
+      xs[i] = x[i];
+      ys[i] = y[i];
+
+      if (i > 0)
+         slopes[i - 1] = (y[i] - y[i - 1]) / (x[i] - x[i - 1]);
+   }
+
+   numPoints = n;
+   return true;
+}
+
+float DeratingCurve::Get(float x) const
+{
+   if (numPoints == 0) return 1;
+   if (x <= xs[0]) return ys[0];
+
+   for (int i = 1; i < numPoints; i++)
+   {
+      if (x < xs[i])
+         return ys[i - 1] + (x - xs[i - 1]) * slopes[i - 1];
+   }
+
+   return ys[numPoints - 1];
+}
@@ -0,0 +1,204 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "diagnostics.h"
+#include "flyingadcbms.h"
+#include "bmsfsm.h"
+#include "params.h"
+#include "my_math.h"
+#include "fasttrip.h"
+#include "eventlog.h"
+
+#define SLOTS_PER_SECOND 40 //called from the 25 ms scan task
+#define FAILS_TO_REPORT  2  //a check must fail in two rounds in a row
+#define OPENWIRE_TOLERANCE 200 //mV the input may move away from the last scanned voltage
+#define NUM_CHECKS       (sizeof(checks) / sizeof(checks[0]))
+
+/* Like the self tests each check starts its conversion in cycle 0 and reads
+ * it one cycle later. The next check is started in the same cycle, so a
+ * round takes one slot more than the checks need. The balancer check comes first so
+ * that the mux off check discharges the saturated input again.
+ */
+const Diagnostics::Check Diagnostics::checks[] = {
+   { CheckBalancer, ERR_BALANCER_FAIL },
+   { CheckMuxOff, ERR_MUXSHORT },
+   { CheckOpenWire, ERR_OPENWIRE }
+};
+
+uint8_t Diagnostics::failCount[NUM_CHECKS];
+int Diagnostics::check = -1;
+int Diagnostics::cycle = 0;
+int Diagnostics::errInfo = 0;
+uint8_t Diagnostics::openWireChannel = 0;
+bool Diagnostics::openWireCharge = false;
+uint32_t Diagnostics::slotsSinceRound = 0;
+
+/** \brief Runs the background checks in place of a cell voltage reading
+ *
+ * \param sweepStart true when the cell scan is about to read channel 0
+ * \return true when this slot was used by the checks, false when the scan can go on
+ *
+ */
+bool Diagnostics::Run(bool sweepStart)
+{
+   if (check < 0)
+   {
+      uint32_t interval = Param::GetInt(Param::diagint) * SLOTS_PER_SECOND;
+
+      if (slotsSinceRound < interval) slotsSinceRound++;
+
+      //Only start in RUN, IDLE has the self test numbers and might be balancing
+      if (interval == 0 || slotsSinceRound < interval || !sweepStart ||
+          Param::GetInt(Param::opmode) != BmsFsm::RUN)
+         return false;
+
+      check = 0;
+      cycle = 0;
+      slotsSinceRound = 0;
+   }
+
+   CheckResult result = checks[check].run(cycle++);
+
+   while (result != CheckOngoing)
+   {
+      Evaluate(check, result);
+      check++;
+      cycle = 0;
+
+      if (check == (int)NUM_CHECKS)
+      {
+         check = -1;
+         //Hand back to the scan, it expects the conversion of channel 0 to be running
+         FlyingAdcBms::SelectChannel(0);
+         FlyingAdcBms::StartAdc();
+         FastTrip::ConversionStarted();
+         break;
+      }
+      result = checks[check].run(cycle++);
+   }
+
+   return true;
+}
+
+/** \brief Abort a running round and clear the fault counters */
+void Diagnostics::Reset()
+{
+   check = -1;
+   cycle = 0;
+   errInfo = 0;
+   slotsSinceRound = 0;
+   openWireChannel = 0;
+   openWireCharge = false;
+
+   for (unsigned i = 0; i < NUM_CHECKS; i++)
+      failCount[i] = 0;
+}
+
+/** \brief Drive the H-bridge with the mux off, the ADC must saturate */
+Diagnostics::CheckResult Diagnostics::CheckBalancer(int cycle)
+{
+   if (cycle == 0)
+   {
+      FlyingAdcBms::SelectChannel(0); //even channel, so the H-bridge drives the input positive
+      FlyingAdcBms::MuxOff();
+      FlyingAdcBms::SetBalancing(FlyingAdcBms::BAL_CHARGE);
+      FlyingAdcBms::StartAdc();
+      return CheckOngoing;
+   }
+
+   int adc = FlyingAdcBms::GetResult();
+   FlyingAdcBms::SetBalancing(FlyingAdcBms::BAL_OFF);
+   errInfo = adc;
+
+   return adc < 8190 ? CheckFailed : CheckPassed;
+}
+
+/** \brief Discharge the input with the mux off, the ADC must read close to 0 */
+Diagnostics::CheckResult Diagnostics::CheckMuxOff(int cycle)
+{
+   if (cycle == 0)
+   {
+      FlyingAdcBms::MuxOff();
+      FlyingAdcBms::SetBalancing(FlyingAdcBms::BAL_DISCHARGE);
+      FlyingAdcBms::StartAdc();
+      return CheckOngoing;
+   }
+
+   int adc = FlyingAdcBms::GetResult();
+   FlyingAdcBms::SetBalancing(FlyingAdcBms::BAL_OFF);
+   errInfo = adc;
+
+   return ABS(adc) < 5 ? CheckPassed : CheckFailed;
+}
+
+/** \brief Give a cell a short balancer pulse and see if its voltage holds
+ * A connected cell is a stiff source, a 25 ms pulse moves it by microvolts.
+ * With a broken sense lead the pulse charges or discharges the input filter
+ * instead, which then holds far from the last scanned voltage. Charge and
+ * discharge pulses alternate from round to round. A failing channel is
+ * checked again in the next round, with the opposite pulse.
+ */
+Diagnostics::CheckResult Diagnostics::CheckOpenWire(int cycle)
+{
+   if (cycle == 0)
+   {
+      FlyingAdcBms::SelectChannel(openWireChannel);
+      FlyingAdcBms::SetBalancing(openWireCharge ? FlyingAdcBms::BAL_CHARGE : FlyingAdcBms::BAL_DISCHARGE);
+      return CheckOngoing;
+   }
+   else if (cycle == 1)
+   {
+      //Measure with the balancer off like the regular scan does
+      FlyingAdcBms::SetBalancing(FlyingAdcBms::BAL_OFF);
+      FlyingAdcBms::StartAdc();
+      return CheckOngoing;
+   }
+
+   float udc = FlyingAdcBms::GetResult() * (Param::GetFloat(Param::gain) / 1000.0f);
+   float expected = Param::GetFloat((Param::PARAM_NUM)(Param::u0 + openWireChannel));
+   bool open = ABS(udc - expected) > OPENWIRE_TOLERANCE;
+
+   errInfo = openWireChannel;
+   openWireCharge = !openWireCharge;
+
+   if (!open && ++openWireChannel >= Param::GetInt(Param::numchan))
+      openWireChannel = 0;
+
+   return open ? CheckFailed : CheckPassed;
+}
+
+void Diagnostics::Evaluate(int index, CheckResult result)
+{
+   if (result == CheckPassed)
+   {
+      failCount[index] = 0;
+      return;
+   }
+
+   if (failCount[index] >= FAILS_TO_REPORT) return; //already reported
+
+   failCount[index]++;
+
+   if (failCount[index] == FAILS_TO_REPORT)
+   {
+      ErrorMessage::Post(checks[index].error);
+      Param::SetInt(Param::lasterr, checks[index].error);
+      Param::SetInt(Param::errinfo, errInfo);
+      EventLog::Record(EventLog::EVT_ERROR, checks[index].error, errInfo);
+   }
+}
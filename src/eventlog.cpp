@@ -0,0 +1,314 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "eventlog.h"
+#include "clock.h"
+#include "my_math.h"
+
+EventLog::Entry EventLog::ring[EVENTLOG_RAM_ENTRIES];
+volatile uint32_t EventLog::head;
+volatile uint32_t EventLog::tail;
+volatile uint32_t EventLog::dropped;
+volatile bool EventLog::urgent;
+bool EventLog::eraseAllowed = true;
+uint8_t EventLog::ourModule;
+const EventLog::Entry* EventLog::storage;
+int EventLog::storageSize;
+int EventLog::storageUsed;
+EventLog::EraseFunc EventLog::erase;
+EventLog::ProgramFunc EventLog::program;
+uint32_t EventLog::selected;
+uint32_t EventLog::codeFilter;
+uint32_t EventLog::timeFilter;
+
+/** \brief Set up the persistent part of the log
+ *
+ * \param area erased or previously written storage, read directly
+ * \param entries size of area in entries
+ * \param eraseFunc erases the whole area
+ * \param programFunc writes one entry to an erased slot
+ *
+ */
+void EventLog::SetStorage(const Entry* area, int entries, EraseFunc eraseFunc, ProgramFunc programFunc)
+{
+   storage = area;
+   storageSize = MAX(0, entries);
+   erase = eraseFunc;
+   program = storageSize > 0 ? programFunc : 0;
+   storageUsed = storageSize;
+
+   //Entries are appended, so everything after the last written slot is still erased
+   while (storageUsed > 0 && IsErased(storage[storageUsed - 1]))
+      storageUsed--;
+}
+
+/** \brief Add an event, may be called from any context
+ *
+ * \param code what happened
+ * \param channel sub code or channel, 0-15
+ * \param value event specific, saturated to 16 bits
+ * \return false when the RAM buffer is full and the event was dropped
+ *
+ */
+bool EventLog::Record(Code code, int channel, int value)
+{
+   uint32_t slot = head;
+
+   do
+   {
+      if (slot - tail >= EVENTLOG_RAM_ENTRIES)
+      {
+         __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+         return false;
+      }
+   } while (!__atomic_compare_exchange_n(&head, &slot, slot + 1, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+   Entry& e = ring[slot % EVENTLOG_RAM_ENTRIES];
+
+   e.time = Clock::GetMs();
+   e.source = (channel & 0xF) | (ourModule << 4);
+   e.value = MAX(-32768, MIN(32767, value));
+   //Publish last, Flush() stops at a slot whose code is still EVT_NONE
+   __atomic_store_n(&e.code, (uint8_t)code, __ATOMIC_RELEASE);
+
+   if (code == EVT_ERROR)
+      urgent = true;
+
+   return true;
+}
+
+/** \brief Whether Flush() should run. Errors are written right away, anything
+ * else when a batch is complete or the oldest event has waited long enough
+ */
+bool EventLog::NeedsFlush()
+{
+   uint32_t pending = head - tail;
+
+   if (0 == program || 0 == pending || MustWait()) return false;
+   if (urgent || pending >= FLUSH_BATCH) return true;
+
+   const Entry& oldest = ring[tail % EVENTLOG_RAM_ENTRIES];
+   uint32_t now = Clock::GetMs();
+
+   return IsValid(oldest) && (now - oldest.time) >= FLUSH_DELAY_MS;
+}
+
+/** \brief Move events from RAM to storage. Only call this from the main loop,
+ * programming stalls code execution from flash
+ */
+void EventLog::Flush()
+{
+   if (0 == program || MustWait()) return;
+
+   urgent = false;
+
+   while (tail != head)
+   {
+      Entry& r = ring[tail % EVENTLOG_RAM_ENTRIES];
+
+      if (__atomic_load_n(&r.code, __ATOMIC_ACQUIRE) == EVT_NONE)
+         break; //claimed but not yet written by an interrupted context
+
+      Store(r);
+      r.code = EVT_NONE;
+      __atomic_store_n(&tail, tail + 1, __ATOMIC_RELEASE);
+   }
+}
+
+/** \brief Discard all events in RAM and storage
+ * \return false when the storage would have to be erased while that is not allowed, nothing is discarded then
+ */
+bool EventLog::Clear()
+{
+   if (storageUsed > 0 && erase && !eraseAllowed)
+      return false;
+
+   while (tail != head)
+   {
+      Entry& r = ring[tail % EVENTLOG_RAM_ENTRIES];
+
+      if (__atomic_load_n(&r.code, __ATOMIC_ACQUIRE) == EVT_NONE)
+         break;
+
+      r.code = EVT_NONE;
+      __atomic_store_n(&tail, tail + 1, __ATOMIC_RELEASE);
+   }
+
+   if (erase && storageUsed > 0)
+      erase();
+
+   storageUsed = 0;
+   dropped = 0;
+   selected = 0;
+   return true;
+}
+
+/** \return number of events, stored ones first followed by those still in RAM */
+int EventLog::GetCount()
+{
+   return storageUsed + (head - tail);
+}
+
+/** \brief Get event, index 0 being the oldest one
+ * \return false when index is out of range or the slot is not valid
+ */
+bool EventLog::GetEntry(int index, Entry& e)
+{
+   if (index < 0) return false;
+
+   if (index < storageUsed)
+   {
+      e = storage[index];
+   }
+   else
+   {
+      uint32_t offset = index - storageUsed;
+
+      if (offset >= head - tail) return false;
+
+      e = ring[(tail + offset) % EVENTLOG_RAM_ENTRIES];
+   }
+
+   return IsValid(e);
+}
+
+/** \brief Search for an event matching a filter
+ *
+ * \param start index to start at
+ * \param codeMask bit n set matches code n, 0 matches all codes
+ * \param fromTime only match events at or after this time in ms
+ * \return index of the first matching event or -1 if there is none
+ *
+ */
+int EventLog::Find(int start, uint32_t codeMask, uint32_t fromTime)
+{
+   int count = GetCount();
+   Entry e;
+
+   for (int i = MAX(0, start); i < count; i++)
+   {
+      if (GetEntry(i, e) && (0 == codeMask || (codeMask & (1u << e.code))) && e.time >= fromTime)
+         return i;
+   }
+   return -1;
+}
+
+void EventLog::Store(const Entry& e)
+{
+   if (storageUsed >= storageSize)
+   {
+      //A page can only be erased as a whole. Save the newest events and write them back
+      Entry keep[KEEP_ON_WRAP];
+      int numKeep = MIN(KEEP_ON_WRAP, storageSize - 1);
+
+      for (int i = 0; i < numKeep; i++)
+         keep[i] = storage[storageSize - numKeep + i];
+
+      erase();
+
+      for (int i = 0; i < numKeep; i++)
+         program(i, keep[i]);
+
+      storageUsed = numKeep;
+   }
+
+   program(storageUsed++, e);
+}
+
+/** \brief Serve SDO_INDEX_EVENTLOG
+ * \return true if the frame was ours and has been turned into a reply
+ */
+bool EventLog::ProcessSdo(CanSdo::SdoFrame* sdoFrame)
+{
+   if (sdoFrame->index != SDO_INDEX_EVENTLOG) return false;
+
+   uint32_t error = 0;
+
+   if (sdoFrame->cmd == SDO_WRITE)
+   {
+      switch (sdoFrame->subIndex)
+      {
+      case SDO_EVENTLOG_SELECT: selected = sdoFrame->data; break;
+      case SDO_EVENTLOG_CODES: codeFilter = sdoFrame->data; break;
+      case SDO_EVENTLOG_FROM: timeFilter = sdoFrame->data; break;
+      case SDO_EVENTLOG_CONTROL:
+         if (sdoFrame->data == 1)
+            Flush();
+         else if (sdoFrame->data == 2)
+            error = Clear() ? 0 : SDO_ERR_STATE;
+         else
+            error = SDO_ERR_RANGE;
+         break;
+      default:
+         error = SDO_ERR_INVIDX;
+         break;
+      }
+
+      sdoFrame->cmd = SDO_WRITE_REPLY;
+   }
+   else if (sdoFrame->cmd == SDO_READ)
+   {
+      int index = -1;
+      Entry e;
+
+      if (sdoFrame->subIndex == SDO_EVENTLOG_TIME || sdoFrame->subIndex == SDO_EVENTLOG_DATA)
+      {
+         index = Find(selected, codeFilter, timeFilter);
+
+         if (index < 0)
+            error = SDO_ERR_RANGE;
+         else
+         {
+            GetEntry(index, e);
+            selected = index;
+         }
+      }
+
+      switch (sdoFrame->subIndex)
+      {
+      case SDO_EVENTLOG_COUNT: sdoFrame->data = GetCount(); break;
+      case SDO_EVENTLOG_SELECT: sdoFrame->data = selected; break;
+      case SDO_EVENTLOG_CODES: sdoFrame->data = codeFilter; break;
+      case SDO_EVENTLOG_FROM: sdoFrame->data = timeFilter; break;
+      case SDO_EVENTLOG_TIME: sdoFrame->data = index < 0 ? 0 : e.time; break;
+      case SDO_EVENTLOG_DATA:
+         if (index >= 0)
+         {
+            sdoFrame->data = e.code | (e.source << 8) | ((uint32_t)(uint16_t)e.value << 16);
+            selected = index + 1;
+         }
+         break;
+      default:
+         error = SDO_ERR_INVIDX;
+         break;
+      }
+
+      sdoFrame->cmd = SDO_READ_REPLY;
+   }
+   else
+   {
+      error = SDO_ERR_INVIDX;
+   }
+
+   if (error != 0)
+   {
+      sdoFrame->cmd = SDO_ABORT;
+      sdoFrame->data = error;
+   }
+   return true;
+}
@@ -0,0 +1,140 @@
+/*
+ * This file is part of the FlyingADCBMS project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "executor.h"
+#include "counters.h"
+
+Executor::Job Executor::jobs[MAX_JOBS];
+int Executor::numJobs;
+Executor::Job Executor::active[MAX_NESTING];
+int Executor::nesting;
+void (*Executor::eventPoll)(void);
+
+/** \brief Queue a job unless it is already queued or running
+ * \return false if the queue is full
+ */
+bool Executor::Post(Job job)
+{
+   if (IsPending(job) || IsActive(job))
+      return true;
+   if (numJobs >= MAX_JOBS)
+   {
+      Counters::Increment(Counters::CNT_JOB_DROPS);
+      return false;
+   }
+
+   jobs[numJobs++] = job;
+   return true;
+}
+
+/** \brief Poll for events and run the oldest queued job once
+ * An unfinished job goes to the back of the queue.
+ * \return false when there was nothing to do, i.e. we may sleep
+ */
+bool Executor::RunNext()
+{
+   if (eventPoll)
+      eventPoll();
+
+   if (numJobs == 0)
+      return false;
+
+   Job job = jobs[0];
+   Remove(0);
+
+   if (!Run(job))
+      Post(job);
+
+   return true;
+}
+
+/** \brief Called from within a long job, runs all other pending jobs
+ * Jobs further up the call chain are skipped, so nothing runs re-entrantly.
+ */
+void Executor::Yield()
+{
+   if (eventPoll)
+      eventPoll();
+
+   Job snapshot[MAX_JOBS];
+   int count = numJobs;
+
+   //Each job runs at most once per Yield(), even if it posts itself again
+   for (int i = 0; i < count; i++)
+      snapshot[i] = jobs[i];
+
+   for (int i = 0; i < count && nesting < MAX_NESTING; i++)
+   {
+      Job job = snapshot[i];
+
+      if (IsActive(job) || !IsPending(job))
+         continue;
+
+      for (int j = 0; j < numJobs; j++)
+      {
+         if (jobs[j] == job)
+         {
+            Remove(j);
+            break;
+         }
+      }
+
+      if (!Run(job))
+         Post(job);
+   }
+}
+
+bool Executor::IsPending(Job job)
+{
+   for (int i = 0; i < numJobs; i++)
+   {
+      if (jobs[i] == job) return true;
+   }
+   return false;
+}
+
+void Executor::Clear()
+{
+   numJobs = 0;
+   nesting = 0;
+}
+
+bool Executor::IsActive(Job job)
+{
+   for (int i = 0; i < nesting; i++)
+   {
+      if (active[i] == job) return true;
+   }
+   return false;
+}
+
+bool Executor::Run(Job job)
+{
+   active[nesting++] = job;
+   bool finished = job();
+   nesting--;
+   return finished;
+}
+
+void Executor::Remove(int index)
+{
+   numJobs--;
+
+   for (int i = index; i < numJobs; i++)
+      jobs[i] = jobs[i + 1];
+}
@@ -0,0 +1,119 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "fasttrip.h"
+#include "clock.h"
+#include "params.h"
+#include "digio.h"
+#include "errormessage.h"
+#include "eventlog.h"
+
+FastTrip::State FastTrip::state = FastTrip::TRIP_OK;
+uint32_t FastTrip::conversionStart = 0;
+int FastTrip::cellsInside = 0;
+bool FastTrip::chainOpen = false;
+
+/** \brief Called when the conversion of the next cell is started, for the latency measurement */
+void FastTrip::ConversionStarted()
+{
+   conversionStart = Clock::GetMs();
+}
+
+/** \brief Compare a fresh cell sample against the hard limits
+ *
+ * \param channel cell channel the sample belongs to
+ * \param udc cell voltage in mV
+ *
+ */
+void FastTrip::CheckCell(int channel, float udc)
+{
+   int mode = Param::GetInt(Param::tripmode);
+
+   if (mode == TRIP_OFF)
+   {
+      //Nothing else releases a latched trip once the checks are off
+      if (state != TRIP_OK)
+         Release();
+      return;
+   }
+
+   float umax = Param::GetFloat(Param::utripmax);
+   float umin = Param::GetFloat(Param::utripmin);
+
+   if (state == TRIP_OK)
+   {
+      if (udc > umax)
+         Trip(TRIP_OVERVOLTAGE, channel);
+      else if (udc < umin)
+         Trip(TRIP_UNDERVOLTAGE, channel);
+      return;
+   }
+
+   //Latched: count cells that are back inside the limits with hysteresis
+   float hyst = Param::GetFloat(Param::utriphyst);
+
+   if (udc < (umax - hyst) && udc > (umin + hyst))
+      cellsInside++;
+   else
+      cellsInside = 0;
+
+   if (cellsInside >= Param::GetInt(Param::numchan) && Param::GetBool(Param::tripreset))
+      Release();
+}
+
+/** \brief Release the trip and go back to normal operation */
+void FastTrip::Reset()
+{
+   if (state != TRIP_OK)
+      Release();
+   cellsInside = 0;
+}
+
+void FastTrip::Trip(State s, int channel)
+{
+   //Switch off first, report later
+   if (Param::GetInt(Param::tripmode) == TRIP_OPENCHAIN)
+   {
+      DigIo::nextena_out.Clear();
+      chainOpen = true;
+   }
+
+   state = s;
+   cellsInside = 0;
+   Param::SetInt(Param::triplat, Clock::GetMs() - conversionStart);
+   Param::SetInt(Param::tripstt, s);
+
+   ERROR_MESSAGE_NUM err = s == TRIP_OVERVOLTAGE ? ERR_CELL_OVERVOLTAGE : ERR_CELL_UNDERVOLTAGE;
+   ErrorMessage::Post(err);
+   Param::SetInt(Param::lasterr, err);
+   Param::SetInt(Param::errinfo, channel);
+   EventLog::Record(EventLog::EVT_ERROR, err, channel);
+}
+
+void FastTrip::Release()
+{
+   if (chainOpen)
+      DigIo::nextena_out.Set();
+
+   chainOpen = false;
+
+   state = TRIP_OK;
+   cellsInside = 0;
+   Param::SetInt(Param::tripstt, TRIP_OK);
+   Param::SetInt(Param::tripreset, 0);
+}
@@ -21,6 +21,7 @@
 #include "flyingadcbms.h"
 #include "digio.h"
 #include "hwdefs.h"
+#include "counters.h"
 
 #define READ            true
 #define WRITE           false
@@ -167,9 +168,15 @@ FlyingAdcBms::BalanceStatus FlyingAdcBms::SetBalancing(BalanceCommand cmd)
 
 void FlyingAdcBms::SendRecvI2C(uint8_t address, bool read, uint8_t* data, uint8_t len)
 {
-   if (lock) return;
+   //A transfer started from another interrupt level is still running
+   if (lock)
+   {
+      Counters::Increment(Counters::CNT_I2C_COLLISION);
+      return;
+   }
 
    lock = true;
+   Counters::Increment(Counters::CNT_I2C_XFER);
 
    BitBangI2CStart();
 
@@ -0,0 +1,149 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "imagecrc.h"
+
+const uint32_t* ImageCrc::image;
+int ImageCrc::numPages;
+int ImageCrc::pageWords;
+ImageCrc::CrcFunc ImageCrc::crc = Crc32;
+int ImageCrc::selected;
+uint32_t ImageCrc::imageBytes;
+
+/** \brief Set the application area in flash
+ * \param start first word of the application
+ * \param pages number of pages up to the reserved blocks at the end of flash
+ * \param pageSize flash page size in bytes
+ * \param crcFunc function that computes the CRC, e.g. with the CRC unit
+ */
+void ImageCrc::SetImage(const uint32_t* start, int pages, int pageSize, CrcFunc crcFunc)
+{
+   image = start;
+   numPages = pages;
+   pageWords = pageSize / sizeof(uint32_t);
+   crc = crcFunc;
+   selected = 0;
+   imageBytes = pages * pageSize;
+}
+
+/** \brief CRC of one application page, 0 for pages outside the area */
+uint32_t ImageCrc::GetPageCrc(int page)
+{
+   if (page < 0 || page >= numPages) return 0;
+
+   return crc(image + page * pageWords, pageWords);
+}
+
+/** \brief CRC over the first bytes of the application area
+ * The length is rounded up to whole words, the tool pads its image with 0xFF
+ * like the boot loader leaves the unwritten rest of the last page.
+ */
+uint32_t ImageCrc::GetImageCrc(uint32_t bytes)
+{
+   uint32_t words = (bytes + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+   uint32_t maxWords = numPages * pageWords;
+
+   return crc(image, words < maxWords ? words : maxWords);
+}
+
+/** \brief Software CRC-32/MPEG-2 with the same result as the STM32 CRC unit */
+uint32_t ImageCrc::Crc32(const uint32_t* data, uint32_t words)
+{
+   uint32_t result = 0xFFFFFFFF;
+
+   for (uint32_t i = 0; i < words; i++)
+   {
+      result ^= data[i];
+
+      for (int bit = 0; bit < 32; bit++)
+         result = (result & 0x80000000) ? (result << 1) ^ 0x04C11DB7 : result << 1;
+   }
+   return result;
+}
+
+/** \brief Serves page and image CRCs on SDO_INDEX_IMAGECRC
+ * \return true when the request was for us, false to pass it on
+ */
+bool ImageCrc::ProcessSdo(CanSdo::SdoFrame* sdoFrame)
+{
+   if (sdoFrame->index != SDO_INDEX_IMAGECRC) return false;
+
+   uint32_t error = 0;
+
+   if (sdoFrame->cmd == SDO_WRITE)
+   {
+      switch (sdoFrame->subIndex)
+      {
+      case SDO_IMAGECRC_SELECT:
+         if (sdoFrame->data < (uint32_t)numPages)
+            selected = sdoFrame->data;
+         else
+            error = SDO_ERR_RANGE;
+         break;
+      case SDO_IMAGECRC_IMAGE:
+         if (sdoFrame->data > 0 && sdoFrame->data <= (uint32_t)(numPages * pageWords * sizeof(uint32_t)))
+            imageBytes = sdoFrame->data;
+         else
+            error = SDO_ERR_RANGE;
+         break;
+      default:
+         error = SDO_ERR_INVIDX;
+         break;
+      }
+      if (error == 0) sdoFrame->cmd = SDO_WRITE_REPLY;
+   }
+   else if (sdoFrame->cmd == SDO_READ)
+   {
+      switch (sdoFrame->subIndex)
+      {
+      case SDO_IMAGECRC_PAGES:
+         sdoFrame->data = numPages;
+         break;
+      case SDO_IMAGECRC_PAGESIZE:
+         sdoFrame->data = pageWords * sizeof(uint32_t);
+         break;
+      case SDO_IMAGECRC_SELECT:
+         sdoFrame->data = selected;
+         break;
+      case SDO_IMAGECRC_PAGE:
+         if (selected < numPages)
+            sdoFrame->data = GetPageCrc(selected++);
+         else
+            error = SDO_ERR_RANGE;
+         break;
+      case SDO_IMAGECRC_IMAGE:
+         sdoFrame->data = GetImageCrc(imageBytes);
+         break;
+      default:
+         error = SDO_ERR_INVIDX;
+         break;
+      }
+      if (error == 0) sdoFrame->cmd = SDO_READ_REPLY;
+   }
+   else
+   {
+      error = SDO_ERR_INVIDX;
+   }
+
+   if (error != 0)
+   {
+      sdoFrame->cmd = SDO_ABORT;
+      sdoFrame->data = error;
+   }
+   return true;
+}
@@ -0,0 +1,142 @@
+/*
+ * This file is part of the FlyingADCBMS project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <libopencm3/cm3/scb.h>
+#include <libopencm3/cm3/nvic.h>
+#include <libopencm3/cm3/cortex.h>
+#include <libopencm3/stm32/rtc.h>
+#include <libopencm3/stm32/pwr.h>
+#include <libopencm3/stm32/exti.h>
+#include <libopencm3/stm32/iwdg.h>
+#include <libopencm3/stm32/rcc.h>
+#include "lowpower.h"
+#include "hwdefs.h"
+#include "params.h"
+#include "my_math.h"
+#include "bmsio.h"
+
+#define RTC_TICKS_PER_SECOND 40000
+
+volatile uint32_t LowPower::sleepTicks = 0;
+uint32_t LowPower::lastTicks = 0;
+
+/** \brief Whether the cell voltages should be scanned now
+ * Outside IDLE or while balancing the scan runs continuously. Otherwise
+ * only the first second of each idlescan period is used for a scan burst.
+ */
+bool LowPower::IsScanDue()
+{
+   if (Param::GetInt(Param::lowpower) == LP_OFF ||
+       Param::GetInt(Param::opmode) != BmsFsm::IDLE ||
+       BmsIO::IsBalancingWanted())
+      return true;
+
+   return (rtc_get_counter_val() % Param::GetInt(Param::idlescan)) == 0;
+}
+
+/** \brief Called from the main loop when there is nothing to do
+ * Returns after the next interrupt, which is at most 5 ms away when the
+ * scheduler is running and at most 1 s in STOP mode.
+ */
+void LowPower::Sleep(BmsFsm* bmsFsm)
+{
+   uint32_t start = GetTicks();
+
+   if (IsStopAllowed(bmsFsm))
+      EnterStop();
+   else
+      __asm__ volatile("wfi");
+
+   //GetSleepPercent() clears the sum from the 100 ms task
+   __atomic_fetch_add(&sleepTicks, GetTicks() - start, __ATOMIC_RELAXED);
+}
+
+/** \brief Share of time spent in WFI or STOP since the last call in percent */
+uint32_t LowPower::GetSleepPercent()
+{
+   uint32_t now = GetTicks();
+   uint32_t elapsed = now - lastTicks;
+   uint32_t slept = __atomic_exchange_n(&sleepTicks, 0, __ATOMIC_RELAXED);
+
+   lastTicks = now;
+
+   return elapsed > 0 ? MIN(100, (slept * 100ULL) / elapsed) : 0;
+}
+
+/** \brief STOP mode halts the scheduler and CAN, so only a standalone module
+ * with a low enable input may enter it, i.e. on a parked vehicle.
+ */
+bool LowPower::IsStopAllowed(BmsFsm* bmsFsm)
+{
+   return Param::GetInt(Param::lowpower) == LP_STOP &&
+          Param::GetInt(Param::opmode) == BmsFsm::IDLE &&
+          bmsFsm->GetNumberOfModules() == 1 &&
+          bmsFsm->IsFirst() && !bmsFsm->IsEnabled() &&
+          !IsScanDue();
+}
+
+void LowPower::EnterStop()
+{
+   //The watchdog keeps running in STOP, hence wake up once a second
+   uint32_t alarm = rtc_get_counter_val() + 1;
+
+   iwdg_reset();
+   exti_set_trigger(EXTI17, EXTI_TRIGGER_RISING);
+   exti_enable_request(EXTI17);
+   rtc_clear_flag(RTC_ALR);
+   rtc_set_alarm_time(alarm);
+   rtc_interrupt_enable(RTC_ALR);
+   nvic_enable_irq(NVIC_RTC_ALARM_IRQ);
+
+   pwr_set_stop_mode();
+   pwr_voltage_regulator_low_power_in_stop();
+   SCB_SCR |= SCB_SCR_SLEEPDEEP;
+   //A pending interrupt still ends WFI with interrupts masked. This way an
+   //alarm that fired just now can't leave us in STOP until the watchdog bites
+   cm_disable_interrupts();
+   if (rtc_get_counter_val() < alarm)
+      __asm__ volatile("wfi");
+   SCB_SCR &= ~SCB_SCR_SLEEPDEEP;
+
+   //We wake up on HSI without PLL
+   RCC_CLOCK_SETUP();
+   //RTC registers may only be read after resynchronization
+   RTC_CRL &= ~RTC_CRL_RSF;
+   while (!(RTC_CRL & RTC_CRL_RSF));
+   cm_enable_interrupts();
+}
+
+/** \brief 40 kHz RTC ticks, keeps counting in STOP */
+uint32_t LowPower::GetTicks()
+{
+   uint32_t seconds, divider;
+
+   do
+   {
+      seconds = rtc_get_counter_val();
+      divider = ((RTC_DIVH & 0xF) << 16) | RTC_DIVL;
+   } while (seconds != rtc_get_counter_val());
+
+   return seconds * RTC_TICKS_PER_SECOND + (RTC_TICKS_PER_SECOND - 1 - divider);
+}
+
+extern "C" void rtc_alarm_isr(void)
+{
+   exti_reset_request(EXTI17);
+   rtc_clear_flag(RTC_ALR);
+}
@@ -18,10 +18,14 @@
  */
 #include <stdint.h>
 #include <libopencm3/stm32/usart.h>
+#include <libopencm3/stm32/rcc.h>
 #include <libopencm3/stm32/rtc.h>
 #include <libopencm3/stm32/can.h>
 #include <libopencm3/stm32/iwdg.h>
-#include <libopencm3/stm32/f1/bkp.h>
+#include <libopencm3/cm3/dwt.h>
+#include <libopencm3/stm32/flash.h>
+#include <libopencm3/stm32/desig.h>
+#include <libopencm3/stm32/crc.h>
 #include "stm32_can.h"
 #include "canmap.h"
 #include "cansdo.h"
@@ -44,98 +48,119 @@
 #include "bmsio.h"
 #include "selftest.h"
 #include "vx1.h"
+#include "cantrace.h"
+#include "eventlog.h"
+#include "stackmonitor.h"
+#include "lowpower.h"
+#include "executor.h"
+#include "diagnostics.h"
+#include "fasttrip.h"
+#include "protection.h"
+#include "temp_meas.h"
+#include "telemetry.h"
+#include "cellreport.h"
+#include "counters.h"
+#include "imagecrc.h"
+#include "clock.h"
 
 #define PRINT_JSON 0
+//Longest a scheduler interrupt may run, the period of the fastest task
+#define ISR_BUDGET_US 5000
+
+#if TERMINAL_DEBUG
+extern "C" const TERM_CMD termCmds[];
+#endif // TERMINAL_DEBUG
 
 static Stm32Scheduler* scheduler;
 static CanMap* canMapExternal;
 static CanMap* canMapInternal;
 static BmsFsm* bmsFsm;
+static CanSdo* canSdo;
+#if TERMINAL_DEBUG
+static Terminal* terminal;
+#endif // TERMINAL_DEBUG
 HwRev hwRev;
+static uint32_t isrCyclesMax = 0;
+static uint32_t sdoPendingSince = 0;
+static bool sdoWaiting = false;
 
-static void CalculateCurrentLimits()
+static uint32_t MsClock();
+
+/** \brief Runs the thermal model and returns the temperature that high temperature derating acts on */
+static float GetDeratingTemperature()
 {
-   float chargeCurrentLimit = BmsAlgo::GetChargeCurrent(Param::GetFloat(Param::umax));
-   chargeCurrentLimit *= BmsAlgo::LowTemperatureDerating(Param::GetFloat(Param::tempmin));
-   chargeCurrentLimit *= BmsAlgo::HighTemperatureDerating(Param::GetFloat(Param::tempmax), 50);
-   Param::SetFloat(Param::chargelim, chargeCurrentLimit);
+   float tempmax = Param::GetFloat(Param::tempmax);
+   float idc = Param::GetFloat(Param::idc);
 
-   float dischargeCurrentLimit = Param::GetFloat(Param::dischargemax);
-   dischargeCurrentLimit *= BmsAlgo::LimitMinimumCellVoltage(Param::GetFloat(Param::umin), Param::GetFloat(Param::ucellmin));
-   dischargeCurrentLimit *= BmsAlgo::HighTemperatureDerating(Param::GetFloat(Param::tempmax), 53);
-   Param::SetFloat(Param::dischargelim, dischargeCurrentLimit);
-/*
-   if (Param::GetFloat(Param::umax) < (Param::GetFloat(Param::ucellmax) - 50))
-      DigIo::nextena_out.Set();
-   else if (Param::GetFloat(Param::umax) >= Param::GetFloat(Param::ucellmax))
-      DigIo::nextena_out.Clear();*/
+   Param::SetFloat(Param::rcellest, BmsAlgo::EstimateResistance(Param::GetFloat(Param::uavg), idc));
+   Param::SetFloat(Param::tempcore, BmsAlgo::UpdateCoreTemperature(idc, tempmax));
+   float predicted = BmsAlgo::PredictCoreTemperature(idc, tempmax);
+   Param::SetFloat(Param::temppred, predicted);
+
+   return Param::GetBool(Param::thermmodel) ? predicted : tempmax;
 }
 
-static void CalculateSocSoh(BmsFsm::bmsstate stt, BmsFsm::bmsstate laststt)
+/** \brief Samples the CAN error counters and counts bus off events and receive FIFO overruns */
+static void UpdateCanCounters()
 {
-   static float estimatedSoc = 0, estimatedSocAtValidSoh = -1, asDiffAfterEstimate = 0, soh = 0;
-   float asDiff = Param::GetFloat(Param::chargein) - Param::GetFloat(Param::chargeout);
+   static bool wasBusOff = false;
+   uint32_t esr = CAN_ESR(CAN1);
+   bool busOff = (esr & CAN_ESR_BOFF) != 0;
 
-   if (estimatedSoc == 0)
-   {
-      estimatedSoc = Param::GetFloat(Param::soc);
-      estimatedSocAtValidSoh = estimatedSoc;
-   }
+   Counters::Set(Counters::CNT_CAN_TX_ERRORS, (esr & CAN_ESR_TEC_MASK) >> 16);
+   Counters::Set(Counters::CNT_CAN_RX_ERRORS, (esr & CAN_ESR_REC_MASK) >> 24);
 
-   /* if we change over from IDLE to RUN we have to stop all estimation processes
-      because there is now current through the battery again, skewing open voltage readings.
-      So the estimations do not get any better at this point and we store the results */
-   if (laststt == BmsFsm::IDLE && stt == BmsFsm::RUN)
-   {
-      /* Remember the Ampere Seconds at the point of the last estimation
-         in order to be prepared for the next estimation */
-      asDiffAfterEstimate = asDiff;
+   if (busOff && !wasBusOff)
+      Counters::Increment(Counters::CNT_CAN_BUSOFF);
+   wasBusOff = busOff;
 
-      /* If the SoC difference was large enough we have a valid SoH */
-      if (soh > 0)
-      {
-         float lastSoh = (float)BKP_DR2 / 100.0f;
-         //Don't just overwrite the existing SoH but average it to the existing SoH with a slow IIR filter
-         soh = IIRFILTERF(lastSoh, soh, 10);
-         //Store in NVRAM
-         BKP_DR2 = (uint16_t)(soh * 100);
-         Param::SetFloat(Param::soh, soh);
-         Param::SetFloat(Param::sohpreset, soh);
-         /* Remember SoC at the point of this estimation
-            in order to be prepared for the next estimation */
-         estimatedSocAtValidSoh = estimatedSoc;
-         BmsAlgo::SetNominalCapacity(Param::GetFloat(Param::nomcap) * soh / 100.0f);
-      }
-   }
-
-   /* IDLE state means we haven't seen any current for some (configurable) time
-      so cell voltage is approaching the true open circuit voltage */
-   if (stt == BmsFsm::IDLE && Param::GetFloat(Param::idc) < 0.8f)
+   //A full FIFO drops the next frame. The flag is cleared by writing 1
+   if (CAN_RF0R(CAN1) & CAN_RF0R_FOVR0)
    {
-      estimatedSoc = BmsAlgo::EstimateSocFromVoltage(Param::GetFloat(Param::umin));
-      Param::SetFloat(Param::soc, estimatedSoc);
-      //Store estimated SoC in NVRAM
-      BKP_DR1 = (uint16_t)(estimatedSoc * 100);
-
-      soh = BmsAlgo::CalculateSoH(estimatedSocAtValidSoh, estimatedSoc, asDiff - asDiffAfterEstimate);
-
-      if (estimatedSocAtValidSoh < 0)
-         estimatedSocAtValidSoh = estimatedSoc;
+      Counters::Increment(Counters::CNT_CAN_RX_OVERRUN);
+      CAN_RF0R(CAN1) = CAN_RF0R_FOVR0;
    }
-   else
+   if (CAN_RF1R(CAN1) & CAN_RF1R_FOVR1)
    {
-      float soc = BmsAlgo::CalculateSocFromIntegration(estimatedSoc, asDiff - asDiffAfterEstimate);
-      Param::SetFloat(Param::soc, soc);
-      BKP_DR1 = (uint16_t)(soc * 100);
+      Counters::Increment(Counters::CNT_CAN_RX_OVERRUN);
+      CAN_RF1R(CAN1) = CAN_RF1R_FOVR1;
    }
 }
 
+static void CalculateCurrentLimits()
+{
+   float deratingTemp = GetDeratingTemperature();
+   float chargeCurrentLimit = BmsAlgo::GetChargeCurrent(Param::GetFloat(Param::umax));
+   chargeCurrentLimit *= BmsAlgo::GetDerating(BmsAlgo::DRT_CHARGE_LOWTEMP, Param::GetFloat(Param::tempmin));
+   chargeCurrentLimit *= BmsAlgo::GetDerating(BmsAlgo::DRT_CHARGE_HIGHTEMP, deratingTemp);
+   chargeCurrentLimit *= Protection::GetDerating(Protection::CHARGE);
+   Param::SetFloat(Param::chargelim, chargeCurrentLimit);
+
+   float dischargeCurrentLimit = Param::GetFloat(Param::dischargemax);
+   float uminAboveLimit = Param::GetFloat(Param::umin) - Param::GetFloat(Param::ucellmin);
+   dischargeCurrentLimit *= BmsAlgo::GetDerating(BmsAlgo::DRT_DISCHARGE_LOWVOLT, uminAboveLimit);
+   dischargeCurrentLimit *= BmsAlgo::GetDerating(BmsAlgo::DRT_DISCHARGE_HIGHTEMP, deratingTemp);
+   dischargeCurrentLimit *= Protection::GetDerating(Protection::DISCHARGE);
+   Param::SetFloat(Param::dischargelim, dischargeCurrentLimit);
+/*
+   if (Param::GetFloat(Param::umax) < (Param::GetFloat(Param::ucellmax) - 50))
+      DigIo::nextena_out.Set();
+   else if (Param::GetFloat(Param::umax) >= Param::GetFloat(Param::ucellmax))
+      DigIo::nextena_out.Clear();*/
+}
+
 static void Ms100Task(void)
 {
    static uint8_t ledDivider = 0;
    iwdg_reset();
    float cpuLoad = scheduler->GetCpuLoad();
    Param::SetFloat(Param::cpuload, cpuLoad / 10);
+   Param::SetInt(Param::stackfree, StackMonitor::GetFree());
+   Param::SetInt(Param::sleeppct, LowPower::GetSleepPercent());
+   Param::SetInt(Param::tlmdrop, Telemetry::GetDropped());
+   //Longest time the scheduler ISR blocked lower priority interrupts like CAN RX
+   Param::SetInt(Param::isrmax, isrCyclesMax / (rcc_ahb_frequency / 1000000));
+   UpdateCanCounters();
 
    // Check and initialize boot display if needed
    if (bmsFsm != nullptr) {
@@ -164,15 +189,21 @@ static void Ms100Task(void)
 
    BmsFsm::bmsstate laststt = (BmsFsm::bmsstate)Param::GetInt(Param::opmode);
    BmsFsm::bmsstate stt = bmsFsm->Run(laststt);
+
+   if (stt != laststt)
+      EventLog::Record(EventLog::EVT_STATE, laststt, stt);
+
    BmsIO::ReadTemperatures();
 
    if (bmsFsm->IsFirst())
    {
       CalculateCurrentLimits();
-      CalculateSocSoh(stt, laststt);
+      BmsIO::CalculateSocSoh(stt, laststt);
    }
 
    Param::SetInt(Param::opmode, stt);
+   //Erasing a page stalls the current measurement and the fast trip for about 20 ms
+   EventLog::SetEraseAllowed(stt != BmsFsm::RUN);
    //4 bit circular counter for alive indication
    Param::SetInt(Param::counter, (Param::GetInt(Param::counter) + 1) & 0xF);
    Param::SetInt(Param::uptime, rtc_get_counter_val());
@@ -186,12 +217,14 @@ static void RunSelfTest()
    static int test = 0;
    if (SelfTest::GetLastResult() == SelfTest::TestFailed) return; //do not call anymore tests
    SelfTest::TestResult result = SelfTest::RunTest(test);
+   Param::SetInt(Param::selftesttime, SelfTest::GetTotalCycles() * 25); //we are called every 25 ms
 
    if (result == SelfTest::TestFailed)
    {
       ErrorMessage::Post((ERROR_MESSAGE_NUM)(test + 1));
       Param::SetInt(Param::lasterr, test + 1);
       Param::SetInt(Param::errinfo, SelfTest::GetErrorChannel());
+      EventLog::Record(EventLog::EVT_ERROR, test + 1, SelfTest::GetErrorChannel());
    }
 }
 
@@ -201,14 +234,84 @@ static void ReadCellVoltages(void)
    int opmode = Param::GetInt(Param::opmode);
    int testchan = Param::GetInt(Param::testchan);
 
+   BmsIO::SampleTemperatures();
+
    if (opmode == BmsFsm::SELFTEST)
       RunSelfTest();
    else if (testchan >= 0)
       BmsIO::TestReadCellVoltage(testchan, (FlyingAdcBms::BalanceCommand)Param::GetInt(Param::testbalance));
-   else if (Param::GetBool(Param::enable) && (opmode == BmsFsm::RUN || opmode == BmsFsm::IDLE))
-      BmsIO::ReadCellVoltages();
+   else if (Param::GetBool(Param::enable) && (opmode == BmsFsm::RUN || opmode == BmsFsm::IDLE) &&
+            (LowPower::IsScanDue() || Diagnostics::IsActive()))
+   {
+      static bool wasSweepStart = false;
+      static uint32_t sweepStart = 0;
+
+      //The background checks take a slot between two sweeps now and then
+      if (!Diagnostics::Run(BmsIO::IsSweepStart()))
+         BmsIO::ReadCellVoltages();
+
+      //Balancing keeps channel 0 for several slots, a sweep ends when it is reached again
+      if (BmsIO::IsSweepStart() && !wasSweepStart)
+      {
+         uint32_t now = MsClock();
+
+         //The first sweep has no start time
+         if (sweepStart != 0)
+         {
+            Counters::Set(Counters::CNT_SWEEP_MS, now - sweepStart);
+            Counters::Max(Counters::CNT_SWEEP_MS_MAX, now - sweepStart);
+         }
+         Counters::Increment(Counters::CNT_SWEEPS);
+         sweepStart = now;
+      }
+      wasSweepStart = BmsIO::IsSweepStart();
+   }
    else
       FlyingAdcBms::MuxOff();
+
+   //Each module sends on its own id, the index is known once the chain is enumerated
+   Telemetry::SetModule(bmsFsm->GetIndex());
+   Telemetry::Run();
+}
+
+/** \brief Recalculate the NTC lookup table from the beta or the R-T curve parameters */
+static void CalculateTemperatureTable()
+{
+   if (Param::GetInt(Param::tempcurve) == TEMPCURVE_TABLE)
+   {
+      float resistance[11];
+
+      for (int i = 0; i < 11; i++)
+         resistance[i] = Param::GetFloat((Param::PARAM_NUM)(Param::ntcm30 + i));
+
+      TempMeas::CalculateCurveTable(resistance, 11, -30, 10);
+   }
+   else
+   {
+      TempMeas::CalculateBetaTable(Param::GetInt(Param::tempres), Param::GetInt(Param::tempbeta));
+   }
+}
+
+/** \brief Loads the derating curves from parameters
+ * Each curve has 3 points, stored as pairs of x and factor in % in consecutive parameters
+ * A curve whose x values don't increase is not taken, the previous one stays active
+ */
+static void LoadDeratingCurves()
+{
+   const Param::PARAM_NUM firstPoint[BmsAlgo::DRT_LAST] = { Param::tchglo1, Param::tchghi1, Param::tdchhi1, Param::udchlo1 };
+
+   for (int c = 0; c < BmsAlgo::DRT_LAST; c++)
+   {
+      float x[3], factor[3];
+
+      for (int i = 0; i < 3; i++)
+      {
+         x[i] = Param::GetFloat((Param::PARAM_NUM)(firstPoint[c] + 2 * i));
+         factor[i] = Param::GetFloat((Param::PARAM_NUM)(firstPoint[c] + 2 * i + 1)) / 100;
+      }
+
+      BmsAlgo::SetDeratingCurve((BmsAlgo::Derating)c, x, factor, 3);
+   }
 }
 
 /** This function is called when the user changes a parameter */
@@ -219,11 +322,21 @@ void Param::Change(Param::PARAM_NUM paramNum)
    case Param::sohpreset:
       Param::SetFloat(Param::soh, Param::GetFloat(Param::sohpreset));
       break;
+   case Param::tempres:
+   case Param::tempbeta:
+   case Param::tempcurve:
+      CalculateTemperatureTable();
+      break;
    case Param::VX1mode:
       // Handle VX1 mode parameter change
       VX1::HandleParamChange(paramNum);
       break;
    default:
+      //At boot, or when a point of the R-T curve changed
+      if (paramNum == Param::PARAM_LAST || (paramNum >= Param::ntcm30 && paramNum <= Param::ntc70))
+         CalculateTemperatureTable();
+
+      BmsIO::ConfigureTempMux(Param::GetInt(Param::tempmuxch));
       BmsAlgo::SetNominalCapacity(Param::GetFloat(Param::nomcap) * Param::GetFloat(Param::soh) / 100.0f);
       SelfTest::SetNumChannels(Param::GetInt(Param::numchan));
 
@@ -235,34 +348,167 @@ void Param::Change(Param::PARAM_NUM paramNum)
       BmsAlgo::SetCCCVCurve(0, Param::GetFloat(Param::icc1), Param::GetInt(Param::ucv1));
       BmsAlgo::SetCCCVCurve(1, Param::GetFloat(Param::icc2), Param::GetInt(Param::ucv2));
       BmsAlgo::SetCCCVCurve(2, Param::GetFloat(Param::icc3), Param::GetInt(Param::ucellmax));
+      LoadDeratingCurves();
+      BmsAlgo::SetThermalModel(Param::GetFloat(Param::rcell), Param::GetFloat(Param::rthcell),
+                               Param::GetFloat(Param::tauthcell), Param::GetFloat(Param::thorizon));
+      Telemetry::Configure(Param::GetInt(Param::tlmchan), Param::GetInt(Param::tlmrate), Param::GetInt(Param::tlmcanid));
       break;
    }
 }
 
-static void LoadNVRAM()
+/** \brief Flash page of the event log, below the parameter, CAN map and pin definition blocks */
+static uint32_t EventLogAddress()
+{
+   return FLASH_BASE + desig_get_flash_size() * 1024 - EVENTLOG_BLKNUM * FLASH_PAGE_SIZE;
+}
+
+static void EraseEventLog()
 {
-   float soc = (float)BKP_DR1 / 100.0f;
+   flash_unlock();
+   flash_erase_page(EventLogAddress());
+   flash_lock();
+}
 
-   if (soc >= 0 && soc <= 100)
-      Param::SetFloat(Param::soc, soc);
+static void ProgramEventLog(int slot, const EventLog::Entry& e)
+{
+   uint32_t addr = EventLogAddress() + slot * sizeof(EventLog::Entry);
+   const uint32_t* words = (const uint32_t*)&e;
 
-   if (BKP_DR2 != 0)
-      Param::SetFloat(Param::soh, (float)BKP_DR2 / 100.0f);
-   else
-      Param::SetFixed(Param::soh, Param::Get(Param::sohpreset));
+   flash_unlock();
+   flash_program_word(addr, words[0]);
+   flash_program_word(addr + 4, words[1]);
+   flash_lock();
+}
+
+/** \brief Page CRCs for delta updates, the CRC unit is clocked in clock_setup() */
+static uint32_t HardwareCrc(const uint32_t* data, uint32_t words)
+{
+   crc_reset();
+   return crc_calculate_block((uint32_t*)data, words);
+}
+
+/** \brief Milliseconds since power up for CAN trace time stamps and trip latency
+ * The RTC counts seconds, the prescaler divider counts down 40 kHz LSI ticks
+ */
+static uint32_t MsClock()
+{
+   uint32_t seconds, divider;
+
+   do
+   {
+      seconds = rtc_get_counter_val();
+      divider = ((RTC_DIVH & 0xF) << 16) | RTC_DIVL;
+   } while (seconds != rtc_get_counter_val());
+
+   return seconds * 1000 + (39999 - divider) / 40;
 }
 
 //Whichever timer(s) you use for the scheduler, you have to
 //implement their ISRs here and call into the respective scheduler
 extern "C" void tim2_isr(void)
 {
+   uint32_t start = dwt_read_cycle_counter();
+
    scheduler->Run();
+
+   uint32_t cycles = dwt_read_cycle_counter() - start;
+   isrCyclesMax = MAX(isrCyclesMax, cycles);
+
+   if (cycles > ISR_BUDGET_US * (rcc_ahb_frequency / 1000000))
+      Counters::Increment(Counters::CNT_ISR_OVERRUNS);
+}
+
+/** \brief Passes the parameter dump on to the SDO printer and lets other
+ * main loop work run after each line, i.e. after each parameter
+ */
+class YieldingPrinter: public IPutChar
+{
+public:
+   YieldingPrinter(IPutChar* p) : printer(p) {}
+
+   void PutChar(char c) override
+   {
+      printer->PutChar(c);
+
+      if (c == '\n')
+         Executor::Yield();
+   }
+
+private:
+   IPutChar* printer;
+};
+
+static bool ProcessSdoJob()
+{
+   CanSdo::SdoFrame* sdoFrame = canSdo->GetPendingUserspaceSdo();
+
+   if (0 != sdoFrame)
+   {
+      if (!CanTrace::ProcessSdo(sdoFrame) && !EventLog::ProcessSdo(sdoFrame) && !CellReport::ProcessSdo(sdoFrame) &&
+          !Counters::ProcessSdo(sdoFrame) && !ImageCrc::ProcessSdo(sdoFrame))
+         SdoCommands::ProcessStandardCommands(sdoFrame);
+      canSdo->SendSdoReply(sdoFrame);
+
+      uint32_t latency = (dwt_read_cycle_counter() - sdoPendingSince) / (rcc_ahb_frequency / 1000000);
+      Counters::Increment(Counters::CNT_SDO_REQUESTS);
+      Counters::Set(Counters::CNT_SDO_LATENCY_US, latency);
+      Counters::Max(Counters::CNT_SDO_LATENCY_MAX, latency);
+      sdoWaiting = false;
+   }
+   return true;
+}
+
+static bool FlushEventLogJob()
+{
+   EventLog::Flush();
+   return true;
+}
+
+static bool PrintJsonJob()
+{
+   char arg = 0;
+   YieldingPrinter printer(canSdo);
+
+   TerminalCommands::PrintParamsJson(&printer, &arg);
+   return true;
+}
+
+#if TERMINAL_DEBUG
+static bool TerminalJob()
+{
+   terminal->Run();
+   return true;
+}
+#endif // TERMINAL_DEBUG
+
+/** \brief Turns pending requests into work items for the main loop */
+static void PollEvents()
+{
+   if (canSdo->GetPendingUserspaceSdo() != 0)
+   {
+      //The latency counts from here, the request arrived at most one main loop pass earlier
+      if (!sdoWaiting)
+         sdoPendingSince = dwt_read_cycle_counter();
+      sdoWaiting = true;
+      Executor::Post(ProcessSdoJob);
+   }
+   if (canSdo->GetPrintRequest() == PRINT_JSON)
+      Executor::Post(PrintJsonJob);
+   if (EventLog::NeedsFlush())
+      Executor::Post(FlushEventLogJob);
+   #if TERMINAL_DEBUG
+   //The terminal has no pending flag, so it is polled. Debug builds never sleep
+   Executor::Post(TerminalJob);
+   #endif // TERMINAL_DEBUG
 }
 
 extern "C" int main(void)
 {
    clock_setup(); //Must always come first
+   StackMonitor::Paint(); //Before any interrupt can use the stack
+   dwt_enable_cycle_counter();
    rtc_setup();
+   Clock::SetSource(MsClock);
    hwRev = detect_hw();
    ANA_IN_CONFIGURE(ANA_IN_LIST);
    DIG_IO_CONFIGURE(DIG_IO_LIST);
@@ -283,21 +529,37 @@ extern "C" int main(void)
    scheduler = &s;
    //Initialize CAN1 with baud rate based on VX1 mode
    VX1::Initialize();
-   Stm32Can c(CAN1, VX1::GetCanBaudRate());
+   TracedCan<Stm32Can> c(CAN1, VX1::GetCanBaudRate());
    CanMap cmi(&c, false);
    CanMap cme(&c);
    canMapInternal = &cmi;
    canMapExternal = &cme;
    CanSdo sdo(&c, &cme);
+   canSdo = &sdo;
 
    BmsFsm fsm(&cmi, &sdo);
    //c.AddCallback(&fsm);
    bmsFsm = &fsm;
    BmsIO::SetBmsFsm(&fsm);
+   CellReport::SetBmsFsm(&fsm);
+   CellReport::SetSdo(&sdo);
+   Telemetry::SetCan(&c);
+   EventLog::SetStorage((const EventLog::Entry*)EventLogAddress(), FLASH_PAGE_SIZE / sizeof(EventLog::Entry),
+                        EraseEventLog, ProgramEventLog);
+   EventLog::Record(EventLog::EVT_BOOT, 0, hwRev);
+   ImageCrc::SetImage((const uint32_t*)APP_FLASH_START, APP_FLASH_SIZE / FLASH_PAGE_SIZE, FLASH_PAGE_SIZE, HardwareCrc);
+   CanTrace::Attach(&c);
+   CellReport::Attach(&c);
 
    TerminalCommands::SetCanMap(canMapExternal);
    SdoCommands::SetCanMap(canMapExternal);
 
+   #if TERMINAL_DEBUG
+   //PB10/11 are only sampled by detect_hw(), afterwards USART3 can have them
+   Terminal t(USART3, termCmds);
+   terminal = &t;
+   #endif // TERMINAL_DEBUG
+
    s.AddTask(BmsIO::MeasureCurrent, 5);
    s.AddTask(ReadCellVoltages, 25);
    s.AddTask(Ms100Task, 100);
@@ -306,28 +568,18 @@ extern "C" int main(void)
    Param::SetInt(Param::version, 4);
    Param::Change(Param::PARAM_LAST); //Call callback once for general parameter propagation
 
-   LoadNVRAM();
+   BmsIO::LoadNVRAM();
    
    // Boot welcome screen will be displayed from Ms100Task
    // VX1::DisplayBootWelcomeScreen(&c, &s);
 
+   Executor::SetEventPoll(PollEvents);
+
    while(1)
    {
-      char c = 0;
-      CanSdo::SdoFrame* sdoFrame = sdo.GetPendingUserspaceSdo();
-
-      if (sdo.GetPrintRequest() == PRINT_JSON)
-      {
-         TerminalCommands::PrintParamsJson(&sdo, &c);
-      }
-      if (0 != sdoFrame)
-      {
-         SdoCommands::ProcessStandardCommands(sdoFrame);
-         sdo.SendSdoReply(sdoFrame);
-      }
-      
-      // Small delay for normal processing
-      for (volatile int i = 0; i < 100; i++);
+      //Sleep until the next interrupt when there is no work, e.g. scheduler or CAN reception
+      if (!Executor::RunNext())
+         LowPower::Sleep(&fsm);
    }
 
    return 0;
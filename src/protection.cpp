@@ -0,0 +1,175 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "protection.h"
+#include "clock.h"
+#include "my_math.h"
+#include "eventlog.h"
+
+#define BOTH (CHARGE | DISCHARGE)
+
+/* One rule per signal, in the order of Protection::Signal. Currents are in
+ * percent of their rating, dischargemax for discharge and icc1 for charge.
+ */
+const Protection::Rule Protection::rules[NUM_SIGNALS] = {
+   //thresholds                                                          high   hyst  qualify limits     error
+   { { Param::ucellwarnhi, Param::ucellalarmhi, Param::ucellfaulthi }, true,  20,   2000,   CHARGE,    ERR_CELL_OVERVOLTAGE },
+   { { Param::ucellwarnlo, Param::ucellalarmlo, Param::ucellfaultlo }, false, 20,   2000,   DISCHARGE, ERR_CELL_UNDERVOLTAGE },
+   { { Param::udeltawarn, Param::udeltaalarm, Param::udeltafault },    true,  10,   5000,   0,         ERR_CELL_DELTA },
+   { { Param::tempwarnhi, Param::tempalarmhi, Param::tempfaulthi },    true,  2,    5000,   BOTH,      ERR_OVERTEMP },
+   { { Param::tempwarnlo, Param::tempalarmlo, Param::tempfaultlo },    false, 2,    5000,   CHARGE,    ERR_UNDERTEMP },
+   { { Param::iwarn, Param::ialarm, Param::ifault },                   true,  5,    1000,   CHARGE,    ERR_OVERCURRENT },
+   { { Param::iwarn, Param::ialarm, Param::ifault },                   true,  5,    1000,   DISCHARGE, ERR_OVERCURRENT },
+};
+
+uint8_t Protection::level[NUM_SIGNALS];
+uint8_t Protection::pending[NUM_SIGNALS];
+uint32_t Protection::pendingSince[NUM_SIGNALS];
+
+/** \brief Update the level of every signal, called once per sweep on the main module */
+void Protection::Evaluate()
+{
+   uint32_t now = Clock::GetMs();
+
+   for (int s = 0; s < NUM_SIGNALS; s++)
+   {
+      const Rule& rule = rules[s];
+      float value = GetValue((Signal)s);
+      int target = LEVEL_OK;
+
+      //Levels we are already in are only left when the value is back by the hysteresis
+      for (int lvl = LEVEL_FAULT; lvl > LEVEL_OK; lvl--)
+      {
+         if (IsBeyond(rule, value, lvl, lvl <= level[s] ? rule.hysteresis : 0))
+         {
+            target = lvl;
+            break;
+         }
+      }
+
+      if (target == level[s])
+      {
+         pending[s] = target;
+         continue;
+      }
+
+      if (target != pending[s])
+      {
+         pending[s] = target;
+         pendingSince[s] = now;
+      }
+
+      if ((now - pendingSince[s]) >= rule.qualifyMs)
+      {
+         if (target == LEVEL_FAULT)
+         {
+            ErrorMessage::Post(rule.error);
+            Param::SetInt(Param::lasterr, rule.error);
+            Param::SetInt(Param::errinfo, value);
+            EventLog::Record(EventLog::EVT_ERROR, rule.error, value);
+         }
+         EventLog::Record(EventLog::EVT_PROTECTION, s, target);
+         level[s] = target;
+      }
+   }
+
+   int worst = 0;
+
+   for (int s = 1; s < NUM_SIGNALS; s++)
+   {
+      if (level[s] > level[worst]) worst = s;
+   }
+
+   Param::SetInt(Param::protlevel, level[worst]);
+   Param::SetInt(Param::protsignal, worst);
+}
+
+/** \brief Back to LEVEL_OK for all signals */
+void Protection::Reset()
+{
+   for (int s = 0; s < NUM_SIGNALS; s++)
+   {
+      level[s] = LEVEL_OK;
+      pending[s] = LEVEL_OK;
+      pendingSince[s] = 0;
+   }
+}
+
+Protection::Level Protection::GetWorstLevel()
+{
+   int worst = LEVEL_OK;
+
+   for (int s = 0; s < NUM_SIGNALS; s++)
+      worst = MAX(worst, level[s]);
+
+   return (Level)worst;
+}
+
+/** \brief Level a value would have right away, without time qualifier and hysteresis */
+Protection::Level Protection::Classify(Signal s, float value)
+{
+   for (int lvl = LEVEL_FAULT; lvl > LEVEL_OK; lvl--)
+   {
+      if (IsBeyond(rules[s], value, lvl, 0))
+         return (Level)lvl;
+   }
+   return LEVEL_OK;
+}
+
+/** \brief Factor for the current limit of the given direction
+ * An alarm halves the limit, a fault sets it to 0
+ */
+float Protection::GetDerating(Direction d)
+{
+   float factor = 1;
+
+   for (int s = 0; s < NUM_SIGNALS; s++)
+   {
+      if ((rules[s].limits & d) == 0) continue;
+
+      if (level[s] == LEVEL_FAULT)
+         return 0;
+      if (level[s] == LEVEL_ALARM)
+         factor = 0.5f;
+   }
+   return factor;
+}
+
+float Protection::GetValue(Signal s)
+{
+   float idc = Param::GetFloat(Param::idc);
+
+   switch (s)
+   {
+   case SIG_UCELLHIGH: return Param::GetFloat(Param::umax);
+   case SIG_UCELLLOW: return Param::GetFloat(Param::umin);
+   case SIG_UDELTA: return Param::GetFloat(Param::udelta);
+   case SIG_TEMPHIGH: return Param::GetFloat(Param::tempmax);
+   case SIG_TEMPLOW: return Param::GetFloat(Param::tempmin);
+   case SIG_ICHARGE: return idc > 0 ? 100 * idc / Param::GetFloat(Param::icc1) : 0;
+   case SIG_IDISCHARGE: return idc < 0 ? 100 * -idc / Param::GetFloat(Param::dischargemax) : 0;
+   default: return 0;
+   }
+}
+
+bool Protection::IsBeyond(const Rule& rule, float value, int lvl, float hysteresis)
+{
+   float threshold = Param::GetFloat(rule.threshold[lvl - 1]);
+
+   return rule.high ? value > (threshold - hysteresis) : value < (threshold + hysteresis);
+}
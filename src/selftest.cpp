@@ -20,13 +20,21 @@
 #include "flyingadcbms.h"
 #include "my_math.h"
 
+/* The tests are pipelined: each one starts the ADC conversion for the next
+ * test before it reports success, so the next test finds its first result
+ * ready one 25 ms cycle later. The cell connection test reads channel N and
+ * switches the mux to the next channel in the same cycle.
+ */
 SelfTest::TestFunction SelfTest::testFunctions[] = {
    RunTestMuxOff, RunTestBalancer, TestCellConnection, TestCellConnection, NoTest
 };
 
 int SelfTest::cycleCounter = 0;
+int SelfTest::totalCycles = 0;
 int SelfTest::numChannels = 16;
 int SelfTest::errChannel = 0;
+bool SelfTest::overVoltage = false;
+bool SelfTest::polarityCheckComplete = false;
 SelfTest::TestResult SelfTest::lastResult = SelfTest::TestOngoing;
 
 /** \brief Runs a given self test
@@ -51,9 +59,23 @@ SelfTest::TestResult SelfTest::RunTest(int& testStep)
       //nothing to do, must be handled upstream
    }
 
+   if (lastResult != TestsDone && lastResult != TestFailed)
+      totalCycles++;
+
    return lastResult;
 }
 
+/** \brief Start over with the first test */
+void SelfTest::Reset()
+{
+   cycleCounter = 0;
+   totalCycles = 0;
+   errChannel = 0;
+   overVoltage = false;
+   polarityCheckComplete = false;
+   lastResult = TestOngoing;
+}
+
 /** \brief Turn off mux and read ADC result. It must be close to 0
  *
  * \return TestResult
@@ -70,8 +92,13 @@ SelfTest::TestResult SelfTest::RunTestMuxOff()
       int adc = FlyingAdcBms::GetResult();
       adc = ABS(adc);
 
-      if (adc < 5) //We expect no voltage on the ADC
+      if (adc < 5) { //We expect no voltage on the ADC
+         //Start the first balancer conversion right away
+         FlyingAdcBms::MuxOff();
+         FlyingAdcBms::SetBalancing(FlyingAdcBms::BAL_CHARGE);
+         FlyingAdcBms::StartAdc();
          return TestSuccess;
+      }
       else {
          errChannel = adc;
          return TestFailed;
@@ -81,32 +108,28 @@ SelfTest::TestResult SelfTest::RunTestMuxOff()
 }
 
 /** \brief Test if balancer circuit works
+ * The first conversion was started by RunTestMuxOff(). Each direction is
+ * read two cycles after switching on the H-bridge to give it time to saturate.
  *
  * \return TestResult
  *
  */
 SelfTest::TestResult SelfTest::RunTestBalancer()
 {
-   if (cycleCounter == 0) {
-      FlyingAdcBms::MuxOff();
-      FlyingAdcBms::SetBalancing(FlyingAdcBms::BAL_CHARGE);
-      FlyingAdcBms::StartAdc();
-   }
-   else if (cycleCounter == 2) {
+   if (cycleCounter == 1) {
       int adc = FlyingAdcBms::GetResult();
 
       if (adc < 8190) { //We expect the ADC to saturate
          errChannel = adc;
          return TestFailed;
       }
-   }
-   else if (cycleCounter == 3) {
+
       FlyingAdcBms::SelectChannel(1); //this leads to negative voltage
       FlyingAdcBms::MuxOff(); //but we turn off the mux right away
       FlyingAdcBms::SetBalancing(FlyingAdcBms::BAL_CHARGE);
       FlyingAdcBms::StartAdc();
    }
-   else if (cycleCounter == 5) {
+   else if (cycleCounter == 3) {
       int adc = FlyingAdcBms::GetResult();
       FlyingAdcBms::SetBalancing(FlyingAdcBms::BAL_OFF);
 
@@ -114,45 +137,49 @@ SelfTest::TestResult SelfTest::RunTestBalancer()
          errChannel = adc;
          return TestFailed;
       }
-      else
-         return TestSuccess;
+
+      //First conversion of the cell connection test
+      FlyingAdcBms::SelectChannel(ChannelAt(0));
+      FlyingAdcBms::StartAdc();
+      return TestSuccess;
    }
    return TestOngoing;
 }
 
+/** \brief Check polarity and over voltage of all channels, one channel per cycle */
 SelfTest::TestResult SelfTest::TestCellConnection()
 {
-   static bool overVoltage = false;
-   static bool polarityCheckComplete = false;
-   int channel = cycleCounter / 2;
-
    if (overVoltage) return TestFailed; //make this look like a separate test
    if (polarityCheckComplete) return TestSuccess;
 
-   if (cycleCounter & 1) //on odd cycles measure, on even cycles switch mux
-   {
-      int adc = FlyingAdcBms::GetResult();
-      FlyingAdcBms::MuxOff();
+   int channel = ChannelAt(cycleCounter);
+   int adc = FlyingAdcBms::GetResult();
+   bool last = cycleCounter == (numChannels - 1);
 
-      if (adc < -1000) {
-         errChannel = channel;
-         return TestFailed;
-      }
-      if (adc > 7500) {
-         overVoltage = true;
-         errChannel = channel;
-         return TestSuccess; //report polarity check as good, but over voltage check as failed on the next call
-      }
-      if (channel == (numChannels - 1)) {
-         polarityCheckComplete = true;
-         return TestSuccess;
-      }
-   }
+   //Switch on the next channel before evaluating, the mux settles while we wait for the next cycle
+   if (last)
+      FlyingAdcBms::MuxOff();
    else
    {
-      FlyingAdcBms::SelectChannel(channel);
+      FlyingAdcBms::SelectChannel(ChannelAt(cycleCounter + 1));
       FlyingAdcBms::StartAdc();
    }
+
+   if (adc < -1000) {
+      FlyingAdcBms::MuxOff();
+      errChannel = channel;
+      return TestFailed;
+   }
+   if (adc > 7500) {
+      FlyingAdcBms::MuxOff();
+      overVoltage = true;
+      errChannel = channel;
+      return TestSuccess; //report polarity check as good, but over voltage check as failed on the next call
+   }
+   if (last) {
+      polarityCheckComplete = true;
+      return TestSuccess;
+   }
    return TestOngoing;
 }
 
@@ -165,3 +192,18 @@ SelfTest::TestResult SelfTest::NoTest()
 {
    return TestsDone;
 }
+
+/** \brief Channel measured at the given position of the sweep
+ * Like the regular scan in BmsIO all even channels come first, then the odd
+ * ones downwards. This way the polarity at the ADC input only flips once.
+ */
+int SelfTest::ChannelAt(int position)
+{
+   int numEven = (numChannels + 1) / 2;
+
+   if (position < numEven)
+      return position * 2;
+
+   int highestOdd = (numChannels & 1) ? numChannels - 2 : numChannels - 1;
+   return highestOdd - 2 * (position - numEven);
+}
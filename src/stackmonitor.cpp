@@ -0,0 +1,64 @@
+/*
+ * This file is part of the FlyingADCBMS project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "stackmonitor.h"
+
+#define STACK_PATTERN 0xA5C3A5C3
+//Words just below the stack pointer of Paint() that are left alone
+#define PAINT_MARGIN  16
+
+//Provided by the libopencm3 linker script
+extern "C" uint32_t end;
+extern "C" uint32_t _stack;
+
+uint32_t* StackMonitor::lowestUsed = &_stack;
+
+/** \brief Fill the free stack with a pattern. Call early in main() before interrupts are enabled */
+void StackMonitor::Paint()
+{
+   uint32_t* sp;
+
+   __asm__ volatile("mov %0, sp" : "=r"(sp));
+
+   for (uint32_t* p = &end; p < sp - PAINT_MARGIN; p++)
+      *p = STACK_PATTERN;
+
+   lowestUsed = sp - PAINT_MARGIN;
+}
+
+/** \brief Bytes of stack that have never been used since Paint()
+ * Scans upward from the end of .bss to the last known mark, so the
+ * scan gets shorter as the stack grows.
+ */
+uint32_t StackMonitor::GetFree()
+{
+   uint32_t* p = &end;
+
+   while (p < lowestUsed && *p == STACK_PATTERN)
+      p++;
+
+   lowestUsed = p;
+   return (p - &end) * sizeof(uint32_t);
+}
+
+/** \brief Deepest stack usage since Paint() in bytes */
+uint32_t StackMonitor::GetUsed()
+{
+   uint32_t free = GetFree();
+   return (&_stack - &end) * sizeof(uint32_t) - free;
+}
@@ -0,0 +1,195 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "telemetry.h"
+#include "clock.h"
+#include "params.h"
+
+uint8_t Telemetry::buffers[2][TELEMETRY_BUFFER_SIZE];
+uint8_t Telemetry::fillLength[2];
+uint8_t Telemetry::fillIndex;
+uint8_t Telemetry::sendPos;
+bool Telemetry::sending;
+uint8_t Telemetry::sequence;
+uint8_t Telemetry::channels;
+uint16_t Telemetry::decimation = 1;
+uint16_t Telemetry::runs;
+uint32_t Telemetry::canId;
+uint8_t Telemetry::newChannels;
+uint16_t Telemetry::newDecimation = 1;
+uint32_t Telemetry::newCanId;
+volatile bool Telemetry::configChanged;
+uint32_t Telemetry::dropped;
+uint8_t Telemetry::module;
+CanHardware* Telemetry::can;
+
+/** \brief Select what is logged and how often
+ * \param chan OR'ed Channels, 0 turns logging off
+ * \param intervalMs time between two records, rounded down to a multiple of RUN_INTERVAL_MS
+ * \param id CAN id of the first module, the others send on the following ids
+ */
+void Telemetry::Configure(uint8_t chan, int intervalMs, uint32_t id)
+{
+   //Run() must not pick up a half written set
+   __atomic_store_n(&configChanged, false, __ATOMIC_RELEASE);
+   newChannels = chan & TLM_ALL;
+   newDecimation = intervalMs > RUN_INTERVAL_MS ? intervalMs / RUN_INTERVAL_MS : 1;
+   newCanId = id;
+   __atomic_store_n(&configChanged, true, __ATOMIC_RELEASE);
+}
+
+/** \brief Call every RUN_INTERVAL_MS */
+void Telemetry::Run()
+{
+   if (__atomic_load_n(&configChanged, __ATOMIC_ACQUIRE))
+      ApplyConfig();
+
+   if (0 == channels || 0 == can) return;
+
+   if (++runs >= decimation)
+   {
+      runs = 0;
+      AddRecord();
+   }
+
+   //Hand over the filled buffer once the previous one is out
+   if (!sending && fillLength[fillIndex] > 0)
+   {
+      fillIndex ^= 1;
+      fillLength[fillIndex] = 0;
+      sendPos = 0;
+      sending = true;
+   }
+
+   if (sending)
+      SendFrames();
+}
+
+void Telemetry::ApplyConfig()
+{
+   configChanged = false;
+
+   //Records of the old channel set would not decode with the new mask
+   if (newChannels != channels || newCanId != canId)
+   {
+      fillLength[0] = fillLength[1] = 0;
+      sending = false;
+      runs = 0;
+   }
+
+   channels = newChannels;
+   decimation = newDecimation;
+   canId = newCanId;
+}
+
+void Telemetry::AddRecord()
+{
+   int numCells = Param::GetInt(Param::numchan);
+   int length = 6;
+
+   if (channels & TLM_CELLS) length += 1 + 2 * numCells;
+   if (channels & TLM_CURRENT) length += 2;
+   if (channels & TLM_TEMPS) length += 4;
+   if (channels & TLM_BALANCE) length += 4;
+   if (channels & TLM_SOC) length += 8;
+
+   if (fillLength[fillIndex] + length > TELEMETRY_BUFFER_SIZE)
+   {
+      dropped++;
+      return;
+   }
+
+   uint8_t* p = &buffers[fillIndex][fillLength[fillIndex]];
+
+   Put(p, length, 1);
+   Put(p, channels, 1);
+   Put(p, Clock::GetMs(), 4);
+
+   if (channels & TLM_CELLS)
+   {
+      Put(p, numCells, 1);
+
+      for (int i = 0; i < numCells; i++)
+         Put(p, Param::GetInt((Param::PARAM_NUM)(Param::u0 + i)), 2);
+   }
+
+   if (channels & TLM_CURRENT)
+      Put(p, Scale(Param::idc, 10), 2);
+
+   if (channels & TLM_TEMPS)
+   {
+      Put(p, Scale(Param::tempmin0, 10), 2);
+      Put(p, Scale(Param::tempmax0, 10), 2);
+   }
+
+   if (channels & TLM_BALANCE)
+   {
+      uint32_t balance = 0;
+
+      for (int i = 0; i < 16; i++)
+         balance |= (uint32_t)(Param::GetInt((Param::PARAM_NUM)(Param::u0cmd + i)) & 3) << (2 * i);
+
+      Put(p, balance, 4);
+   }
+
+   if (channels & TLM_SOC)
+   {
+      Put(p, Scale(Param::soc, 100), 2);
+      Put(p, Scale(Param::soh, 10), 2);
+      Put(p, Scale(Param::idcavg, 10), 2);
+      Put(p, Scale(Param::tempcore, 10), 2);
+   }
+
+   fillLength[fillIndex] += length;
+}
+
+void Telemetry::SendFrames()
+{
+   const uint8_t* buffer = buffers[fillIndex ^ 1];
+   uint8_t length = fillLength[fillIndex ^ 1];
+
+   for (int f = 0; f < FRAMES_PER_RUN && sending; f++)
+   {
+      uint32_t data[2] = { 0, 0 };
+      uint8_t* bytes = (uint8_t*)data;
+      int n = 0;
+
+      bytes[0] = (sequence & 0x7F) | (sendPos == 0 ? FLAG_FIRST : 0);
+      sequence++;
+
+      for (; n < 7 && sendPos < length; n++, sendPos++)
+         bytes[n + 1] = buffer[sendPos];
+
+      can->Send(canId + module, data, n + 1);
+      sending = sendPos < length;
+   }
+}
+
+/** \brief Store the lower bytes of value little endian and advance p */
+void Telemetry::Put(uint8_t*& p, int32_t value, int bytes)
+{
+   for (int i = 0; i < bytes; i++, value >>= 8)
+      *p++ = value & 0xFF;
+}
+
+/** \brief Read a value as fixed point with the given factor, rounded */
+int32_t Telemetry::Scale(int param, int factor)
+{
+   float value = Param::GetFloat((Param::PARAM_NUM)param) * factor;
+   return value < 0 ? value - 0.5f : value + 0.5f;
+}
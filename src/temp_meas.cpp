@@ -23,16 +23,24 @@
 #include <math.h>
 
 
+#define TABLE_SHIFT     5
+#define TABLE_STEP      (1 << TABLE_SHIFT)
+//The curve is steepest at low digits, 10k NTCs reach -40 °C around digit 20
+#define FINE_SHIFT      1
+#define FINE_STEP       (1 << FINE_SHIFT)
+#define FINE_LIMIT      128
+#define FINE_ENTRIES    (FINE_LIMIT >> FINE_SHIFT)
+#define TABLE_ENTRIES   (FINE_ENTRIES + ((4096 - FINE_LIMIT) >> TABLE_SHIFT) + 1)
+
+int16_t TempMeas::table[TABLE_ENTRIES];
+
 float TempMeas::AdcToTemperature(int digit, int nomRes, int beta)
 {
     /* Convert the resistance to a temperature */
     /* Based on: https://learn.adafruit.com/thermistor/using-a-thermistor */
-   const int seriesResistor = 1200;
    const int nominalTemp = 25;
-   const float maxAdcValue = 4095.0f;
    const float absoluteZero = 273.15f;
-   const float voltageRatio = 5.0f / 3.3f; //Ratio of pull-up voltage and ADC reference voltage
-   float resistance = seriesResistor * (voltageRatio / (digit / maxAdcValue) - 1.0f);
+   float resistance = AdcToResistance(digit);
    float steinhart = logf(resistance / nomRes) / beta;     // log(R/Ro)/B
    steinhart += 1.0f / (nominalTemp + absoluteZero); // + (1/To)
    steinhart = 1.0f / steinhart;
@@ -40,3 +48,105 @@ float TempMeas::AdcToTemperature(int digit, int nomRes, int beta)
 
    return steinhart;
 }
+
+/** \brief Fill the lookup table from the beta equation
+ * \param nomRes NTC resistance at 25 °C
+ * \param beta beta coefficient of the NTC
+ */
+void TempMeas::CalculateBetaTable(int nomRes, int beta)
+{
+   for (int i = 0; i < TABLE_ENTRIES; i++)
+      table[i] = ToTableEntry(AdcToTemperature(EntryToDigit(i), nomRes, beta));
+}
+
+/** \brief Fill the lookup table from an R-T curve for NTCs that don't follow the beta equation
+ *
+ * Between two points 1/T is interpolated over log(R), which is what the beta
+ * equation does with a single segment. Below the first and above the last
+ * point the outer segments are extended.
+ *
+ * \param resistance NTC resistance in Ohm at each point, falling with temperature
+ * \param points number of points, at least 2
+ * \param firstTemp temperature of the first point in °C
+ * \param tempStep temperature difference between the points in °C
+ */
+void TempMeas::CalculateCurveTable(const float resistance[], int points, int firstTemp, int tempStep)
+{
+   const float absoluteZero = 273.15f;
+   int p = 0;
+   float logLow = logf(resistance[0]);
+   float logHigh = logf(resistance[1]);
+
+   for (int i = 0; i < TABLE_ENTRIES; i++)
+   {
+      float logR = logf(AdcToResistance(EntryToDigit(i)));
+
+      //The resistance falls with every entry so the segment only moves up
+      while (p < (points - 2) && logR < logHigh)
+      {
+         p++;
+         logLow = logHigh;
+         logHigh = logf(resistance[p + 1]);
+      }
+
+      float invLow = 1.0f / (firstTemp + p * tempStep + absoluteZero);
+      float invHigh = 1.0f / (firstTemp + (p + 1) * tempStep + absoluteZero);
+      float span = logHigh - logLow;
+      float inv = invLow;
+
+      if (span != 0)
+         inv += (logR - logLow) / span * (invHigh - invLow);
+
+      table[i] = ToTableEntry(1.0f / inv - absoluteZero);
+   }
+}
+
+/** \brief Temperature from the lookup table
+ * \param digit 12 bit ADC reading
+ * \return temperature in °C
+ */
+float TempMeas::Lookup(int digit)
+{
+   if (digit < 0) digit = 0;
+   if (digit > 4095) digit = 4095;
+
+   if (digit < FINE_LIMIT)
+   {
+      int index = digit >> FINE_SHIFT;
+      int frac = digit & (FINE_STEP - 1);
+      int temp = table[index] * (FINE_STEP - frac) + table[index + 1] * frac;
+
+      return temp * (0.1f / FINE_STEP);
+   }
+
+   int index = FINE_ENTRIES + ((digit - FINE_LIMIT) >> TABLE_SHIFT);
+   int frac = (digit - FINE_LIMIT) & (TABLE_STEP - 1);
+   int temp = table[index] * (TABLE_STEP - frac) + table[index + 1] * frac;
+
+   return temp * (0.1f / TABLE_STEP);
+}
+
+/** \brief ADC digit of a table entry, every 2 digits below FINE_LIMIT and every 32 above */
+int TempMeas::EntryToDigit(int i)
+{
+   if (i < FINE_ENTRIES)
+      return i << FINE_SHIFT;
+   return FINE_LIMIT + ((i - FINE_ENTRIES) << TABLE_SHIFT);
+}
+
+float TempMeas::AdcToResistance(int digit)
+{
+   const int seriesResistor = 1200;
+   const float maxAdcValue = 4095.0f;
+   const float voltageRatio = 5.0f / 3.3f; //Ratio of pull-up voltage and ADC reference voltage
+
+   return seriesResistor * (voltageRatio / (digit / maxAdcValue) - 1.0f);
+}
+
+/** \brief Round to 0.1 °C, an open sensor reads as absolute zero like with the beta equation */
+int16_t TempMeas::ToTableEntry(float temp)
+{
+   if (!(temp > -273.1f)) return -2731;
+   if (temp > 3000) return 30000;
+   return temp < 0 ? temp * 10 - 0.5f : temp * 10 + 0.5f;
+}
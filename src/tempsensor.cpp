@@ -0,0 +1,117 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "tempsensor.h"
+#include "temp_meas.h"
+
+//An open NTC pulls the input to 0, a short to the rail. 10 digits is below -45 °C with a 10k NTC
+#define OPEN_DIGITS        10
+#define SHORT_DIGITS       4085
+#define PLAUSIBLE_MIN      -40.0f
+#define PLAUSIBLE_MAX      100.0f
+//Largest change between two 100 ms updates, a pack can't heat up this fast
+#define MAX_STEP           5.0f
+#define FILTER_GAIN        0.125f
+#define FAULT_UPDATES      5
+#define RECOVER_UPDATES    10
+
+TempSensor::TempSensor()
+{
+   Reset();
+}
+
+/** \brief Add an ADC reading to the average of the next update */
+void TempSensor::Sample(int digit)
+{
+   //Leave head room for the sum when Update() is not called for a while
+   if (samples < 255)
+   {
+      sum += digit;
+      samples++;
+   }
+}
+
+/** \brief Process the samples since the last call
+ * \return true when Get() returns a valid temperature
+ */
+bool TempSensor::Update()
+{
+   if (samples == 0) return valid;
+
+   int digit = sum / samples;
+   float temp = TempMeas::Lookup(digit);
+   Status result = Check(digit, temp);
+
+   sum = 0;
+   samples = 0;
+
+   if (result == SNS_OK)
+   {
+      faultCount = 0;
+
+      if (status == SNS_OK)
+      {
+         filtered = valid ? filtered + (temp - filtered) * FILTER_GAIN : temp;
+         valid = true;
+      }
+      else if (++goodCount >= RECOVER_UPDATES)
+      {
+         //The filtered value is stale after a fault, restart from the current reading
+         status = SNS_OK;
+         filtered = temp;
+         valid = true;
+      }
+   }
+   else
+   {
+      goodCount = 0;
+
+      if (status == SNS_OK && ++faultCount >= FAULT_UPDATES)
+      {
+         status = result;
+         valid = false;
+      }
+   }
+
+   return valid;
+}
+
+void TempSensor::Reset()
+{
+   sum = 0;
+   samples = 0;
+   faultCount = 0;
+   goodCount = 0;
+   valid = false;
+   status = SNS_OK;
+   filtered = 0;
+}
+
+TempSensor::Status TempSensor::Check(int digit, float temp) const
+{
+   if (digit < OPEN_DIGITS)
+      return SNS_OPEN;
+   if (digit > SHORT_DIGITS)
+      return SNS_SHORT;
+   if (temp < PLAUSIBLE_MIN || temp > PLAUSIBLE_MAX)
+      return SNS_IMPLAUSIBLE;
+   //The jump is only checked against a running filter, after a fault the new value is taken as is
+   if (valid && status == SNS_OK && (temp - filtered > MAX_STEP || filtered - temp > MAX_STEP))
+      return SNS_RATE;
+   return SNS_OK;
+}
@@ -23,20 +23,31 @@
  */
 #include <libopencm3/cm3/common.h>
 #include <libopencm3/stm32/memorymap.h>
+#include <libopencm3/cm3/dwt.h>
 #include "hwdefs.h"
 #include "terminal.h"
 #include "params.h"
 #include "my_string.h"
 #include "my_fp.h"
+#include "my_math.h"
 #include "printf.h"
 #include "param_save.h"
 #include "errormessage.h"
 #include "terminalcommands.h"
+#include "benchmark.h"
+#include "eventlog.h"
+#include "cellreport.h"
+#include "counters.h"
 
 static void LoadDefaults(Terminal* term, char *arg);
 static void Help(Terminal* term, char *arg);
 static void PrintSerial(Terminal* term, char *arg);
 static void PrintErrors(Terminal* term, char *arg);
+static void RunBenchmark(Terminal* term, char *arg);
+static void PrintEvents(Terminal* term, char *arg);
+static void PrintCells(Terminal* term, char *arg);
+static void PrintPack(Terminal* term, char *arg);
+static void PrintCounters(Terminal* term, char *arg);
 
 extern "C" const TERM_CMD termCmds[] =
 {
@@ -53,6 +64,11 @@ extern "C" const TERM_CMD termCmds[] =
   { "help", Help },
   { "serial", PrintSerial },
   { "errors", PrintErrors },
+  { "bench", RunBenchmark },
+  { "events", PrintEvents },
+  { "cells", PrintCells },
+  { "pack", PrintPack },
+  { "counters", PrintCounters },
   { NULL, NULL }
 };
 
@@ -76,6 +92,175 @@ static void PrintSerial(Terminal* term, char *arg)
    fprintf(term, "%08X:%08X:%08X\r\n", DESIG_UNIQUE_ID2, DESIG_UNIQUE_ID1, DESIG_UNIQUE_ID0);
 }
 
+/** \brief Runs the algorithm benchmarks and prints CPU cycles per call
+ * Only use this on the bench, it stalls the main loop and disturbs the
+ * charge current controllers.
+ */
+static void RunBenchmark(Terminal* term, char *arg)
+{
+   Benchmark::Result results[Benchmark::BENCH_LAST];
+   arg = arg;
+
+   dwt_enable_cycle_counter();
+   Benchmark::Run(results, dwt_read_cycle_counter);
+
+   for (int i = 0; i < Benchmark::BENCH_LAST; i++)
+   {
+      fprintf(term, "%s: %d calls, avg %d, min %d, max %d cycles\r\n", results[i].name, results[i].calls,
+              results[i].total / results[i].calls, results[i].min, results[i].max);
+   }
+}
+
+static int ParseNumber(char*& arg)
+{
+   int n = 0;
+
+   if (0 == arg) return 0;
+
+   while (*arg == ' ') arg++;
+   while (*arg >= '0' && *arg <= '9')
+      n = n * 10 + *arg++ - '0';
+
+   return n;
+}
+
+/** \brief Prints the event log, "events <code> <from ms>" only shows one code
+ * (0 for all) at or after the given time
+ */
+static void PrintEvents(Terminal* term, char *arg)
+{
+   static const char* const names[EventLog::EVT_LAST] = { "", "BOOT", "STATE", "ERROR", "PROTECTION", "TEMPSENSOR" };
+   int code = ParseNumber(arg);
+   uint32_t codeMask = code > 0 ? 1u << code : 0;
+   uint32_t from = ParseNumber(arg);
+   EventLog::Entry e;
+
+   for (int i = EventLog::Find(0, codeMask, from); i >= 0; i = EventLog::Find(i + 1, codeMask, from))
+   {
+      EventLog::GetEntry(i, e);
+      fprintf(term, "%d ms %s module %d channel %d value %d\r\n", e.time, names[e.code], e.source >> 4,
+              e.source & 0xF, e.value);
+   }
+   fprintf(term, "%d events, %d dropped\r\n", EventLog::GetCount(), EventLog::GetDropped());
+}
+
+/** \brief Prints a value with one decimal, the printf has no float support */
+static void PrintTenths(Terminal* term, float value)
+{
+   int tenths = value * 10 + (value < 0 ? -0.5f : 0.5f);
+
+   fprintf(term, "%s%d.%d", tenths < 0 ? "-" : "", ABS(tenths) / 10, ABS(tenths) % 10);
+}
+
+/** \brief Prints the cells of all modules, one line per module. Each voltage in mV is
+ * followed by the balancer state: D discharge, + charge positive, - charge negative.
+ * "cells bin" prints each snapshot as hex instead: number of cells, balancer states
+ * (2 bits per channel, 4 bytes) and the voltages (2 bytes each), little endian
+ */
+static void PrintCells(Terminal* term, char *arg)
+{
+   static const char* const marks[] = { "", "D", "+", "-" };
+   CellReport::Pack pack;
+   CellReport::Module m;
+
+   while (arg != 0 && *arg == ' ') arg++;
+   bool binary = arg != 0 && *arg == 'b';
+
+   CellReport::TakePack(pack);
+
+   for (int i = pack.firstModule; i < pack.firstModule + pack.modules; i++)
+   {
+      if (!CellReport::TakeModule(i, m))
+      {
+         fprintf(term, "m%d no reply\r\n", i);
+         continue;
+      }
+
+      fprintf(term, "m%d", i);
+
+      if (binary)
+      {
+         fprintf(term, " %02X", m.cells);
+
+         for (int b = 0; b < 32; b += 8)
+            fprintf(term, "%02X", (m.balance >> b) & 0xFF);
+         for (int c = 0; c < m.cells; c++)
+            fprintf(term, "%02X%02X", m.voltage[c] & 0xFF, m.voltage[c] >> 8);
+      }
+      else
+      {
+         for (int c = 0; c < m.cells; c++)
+            fprintf(term, " %d%s", m.voltage[c], marks[(m.balance >> (2 * c)) & 3]);
+      }
+      fprintf(term, "\r\n");
+   }
+}
+
+/** \brief Prints the pack totals, the extremes with the module they are in
+ * and the summary of each module
+ */
+static void PrintPack(Terminal* term, char *arg)
+{
+   CellReport::Pack p;
+   arg = arg;
+
+   CellReport::TakePack(p);
+
+   fprintf(term, "opmode %d, protlevel %d, %d modules, %d cells\r\n", p.opmode, p.protlevel, p.modules, p.cells);
+   fprintf(term, "utotal ");
+   PrintTenths(term, p.utotal / 1000);
+   fprintf(term, " V, uavg %d mV, udelta %d mV\r\n", (int)p.uavg, (int)p.udelta);
+
+   if (p.uminModule != 0xFF)
+   {
+      fprintf(term, "umin %d mV in m%d, umax %d mV in m%d\r\n", (int)p.umin, p.firstModule + p.uminModule,
+              (int)p.umax, p.firstModule + p.umaxModule);
+   }
+   if (p.tempminModule != 0xFF)
+   {
+      fprintf(term, "tempmin ");
+      PrintTenths(term, p.tempmin);
+      fprintf(term, " C in m%d, tempmax ", p.firstModule + p.tempminModule);
+      PrintTenths(term, p.tempmax);
+      fprintf(term, " C in m%d\r\n", p.firstModule + p.tempmaxModule);
+   }
+
+   fprintf(term, "idc ");
+   PrintTenths(term, p.idc);
+   fprintf(term, " A, idcavg ");
+   PrintTenths(term, p.idcavg);
+   fprintf(term, " A, power %d W\r\n", (int)p.power);
+   fprintf(term, "soc ");
+   PrintTenths(term, p.soc);
+   fprintf(term, " %s, soh ", "%");
+   PrintTenths(term, p.soh);
+   fprintf(term, " %s, chargelim %d A, dischargelim %d A\r\n", "%", (int)p.chargelim, (int)p.dischargelim);
+
+   for (int i = 0; i < p.modules; i++)
+   {
+      const CellReport::ModuleSummary& s = p.module[i];
+
+      fprintf(term, "m%d umin %d umax %d uavg %d tempmin %d tempmax %d tempflt %d\r\n", p.firstModule + i,
+              (int)s.umin, (int)s.umax, (int)s.uavg, (int)s.tempmin, (int)s.tempmax, s.tempflt);
+   }
+}
+
+/** \brief Prints all counters and gauges, "counters reset" zeroes the counters */
+static void PrintCounters(Terminal* term, char *arg)
+{
+   while (arg != 0 && *arg == ' ') arg++;
+
+   if (arg != 0 && *arg == 'r')
+   {
+      Counters::Reset();
+      fprintf(term, "Counters reset\r\n");
+      return;
+   }
+
+   for (int i = 0; i < Counters::CNT_LAST; i++)
+      fprintf(term, "%s %d\r\n", Counters::GetName((Counters::Id)i), Counters::Get((Counters::Id)i));
+}
+
 static void Help(Terminal* term, char *arg)
 {
    //If you want you could print some instructions here
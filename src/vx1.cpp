@@ -36,6 +36,7 @@
 #include <libopencm3/stm32/f1/bkp.h>
 #include <cmath>   // For fabs
 #include "printf.h"  // Use project's printf implementation
+#include "protection.h"
 // param_prj.h is already included via params.h in vx1.h
 
 // No external references needed
@@ -46,7 +47,13 @@ const VX1::ErrorShortCode VX1::ERROR_SHORT_CODES[] = {
     {ERR_MUXSHORT, "MSH"},         // ERR_MUXSHORT = 1
     {ERR_BALANCER_FAIL, "BAL"},    // ERR_BALANCER_FAIL = 2
     {ERR_CELL_POLARITY, "CPOL"},   // ERR_CELL_POLARITY = 3
-    {ERR_CELL_OVERVOLTAGE, "COV"}  // ERR_CELL_OVERVOLTAGE = 4
+    {ERR_CELL_OVERVOLTAGE, "COV"}, // ERR_CELL_OVERVOLTAGE = 4
+    {ERR_OPENWIRE, "OPW"},         // ERR_OPENWIRE = 5
+    {ERR_CELL_UNDERVOLTAGE, "CUV"},// ERR_CELL_UNDERVOLTAGE = 6
+    {ERR_CELL_DELTA, "CDL"},       // ERR_CELL_DELTA = 7
+    {ERR_OVERTEMP, "OT"},          // ERR_OVERTEMP = 8
+    {ERR_UNDERTEMP, "UT"},         // ERR_UNDERTEMP = 9
+    {ERR_OVERCURRENT, "OC"}        // ERR_OVERCURRENT = 10
 };
 
 // Define static class members
@@ -1744,10 +1751,9 @@ void VX1::TemperatureWarningTask(CanHardware* canHardware, BmsFsm* /*unused*/)
     
     // Get current temperature
     float tempMax = Param::GetFloat(Param::tempmax);
-    float tempWarnPoint = Param::GetFloat(Param::VX1TempWarnHiPoint);
     
-    // If temperature exceeds warning threshold, report it
-    if (tempMax >= tempWarnPoint) {
+    // If the protection engine sees a high temperature, report it
+    if (Protection::GetLevel(Protection::SIG_TEMPHIGH) >= Protection::LEVEL_WARNING) {
         // Only refresh the display if the temperature has changed significantly
         if (!tempWarningActive || fabs(tempMax - currentTempWarning) >= 1.0f) {
             // Update with new temperature value - this handles setting the flag,
@@ -1901,10 +1907,9 @@ void VX1::UDeltaWarningTask(CanHardware* canHardware, BmsFsm* /*unused*/)
     
     // Get current uDelta
     float uDelta = Param::GetFloat(Param::udelta);
-    float uDeltaTresh = Param::GetFloat(Param::VX1uDeltaWarnTresh);
     
-    // If uDelta exceeds warning threshold, report it
-    if (uDelta >= uDeltaTresh) {
+    // If the protection engine sees a high cell voltage delta, report it
+    if (Protection::GetLevel(Protection::SIG_UDELTA) >= Protection::LEVEL_WARNING) {
         // Only refresh the display if the udelta has changed significantly
         if (!uDeltaWarningActive || fabs(uDelta - currentUDeltaWarning) >= 5.0f) {
             // Update with new uDelta value - this handles setting the flag,
@@ -2151,6 +2156,35 @@ void VX1::BmsPgnEmulationTask(CanHardware* canHardware, BmsFsm* bmsFsm)
     }
 }
 
+/**
+ * Temperature level for the BMS PGN encoders
+ * 
+ * The mock temperature replaces the sensors, so it is classified against the
+ * protection thresholds directly instead of using the evaluated level.
+ * 
+ * @param signal SIG_TEMPHIGH or SIG_TEMPLOW
+ * @param temp Temperature the message reports, the mock temperature when set
+ * @return Protection level of the temperature
+ */
+static Protection::Level TemperatureLevel(Protection::Signal signal, float temp)
+{
+    if (Param::GetFloat(Param::VX1mockTemp) != 0)
+        return Protection::Classify(signal, temp);
+    return Protection::GetLevel(signal);
+}
+
+/**
+ * Map a protection level to the 2 bit warning field of PGN 0xFEF4
+ * 
+ * @param level Protection level
+ * @return 00 = Normal, 01 = Warning1 for warnings, 10 = Warning2 for alarms and faults
+ */
+static uint8_t WarningBits(Protection::Level level)
+{
+    if (level == Protection::LEVEL_OK) return 0x0;
+    return level == Protection::LEVEL_WARNING ? 0x1 : 0x2;
+}
+
 /**
  * Send BMS Status & Control PGN (0xFEF2)
  * 
@@ -2211,8 +2245,8 @@ bool VX1::SendBmsPgn0xFEF2(CanHardware* canHardware)
     if (Param::GetInt(Param::opmode) == BmsFsm::RUN)
         flags |= 0x02;
     
-    // Bit 2: BMS Warning Mode (1 if tempmax > VX1TempWarnHiPoint)
-    if (tempmax > Param::GetFloat(Param::VX1TempWarnHiPoint))
+    // Bit 2: BMS Warning Mode (1 if temperature is at warning level or above)
+    if (TemperatureLevel(Protection::SIG_TEMPHIGH, tempmax) >= Protection::LEVEL_WARNING)
         flags |= 0x04;
     
     // Bit 3: BMS Fault Mode (1 if master node in error mode)
@@ -2227,8 +2261,8 @@ bool VX1::SendBmsPgn0xFEF2(CanHardware* canHardware)
     if (Param::GetFloat(Param::uavg) > 4100.0f)
         flags |= 0x20;
     
-    // Bit 6: Request Cooling Fan On (1 if tempmax > VX1TempWarnHiPoint)
-    if (tempmax > Param::GetFloat(Param::VX1TempWarnHiPoint))
+    // Bit 6: Request Cooling Fan On (1 if temperature is at warning level or above)
+    if (TemperatureLevel(Protection::SIG_TEMPHIGH, tempmax) >= Protection::LEVEL_WARNING)
         flags |= 0x40;
     
     // Bit 7: Request Service Lamp On (1 if master node in error mode)
@@ -2325,8 +2359,8 @@ bool VX1::SendBmsPgn0xFEF3(CanHardware* canHardware, uint8_t moduleNumber)
     
     uint8_t thermalSwitch = 0x3; // Default: Normal (0x3)
     
-    // Check if temperature is above warning threshold
-    if (tempmax > Param::GetFloat(Param::VX1TempWarnHiPoint)) {
+    // Check if temperature is at warning level or above
+    if (TemperatureLevel(Protection::SIG_TEMPHIGH, tempmax) >= Protection::LEVEL_WARNING) {
         thermalSwitch = 0x4; // HOT (0x4)
     }
     
@@ -2356,9 +2390,6 @@ bool VX1::SendBmsPgn0xFEF4(CanHardware* canHardware)
     
     // Get parameter values to map to the message
     float utotal = Param::GetFloat(Param::utotal);           // Total voltage in mV
-    float umax = Param::GetFloat(Param::umax);               // Max cell voltage in mV
-    float umin = Param::GetFloat(Param::umin);               // Min cell voltage in mV
-    float udelta = Param::GetFloat(Param::udelta);           // Voltage deviation in mV
     
     // Check if mock temperature should be used (non-zero value)
     float mockTemp = Param::GetFloat(Param::VX1mockTemp);
@@ -2388,23 +2419,13 @@ bool VX1::SendBmsPgn0xFEF4(CanHardware* canHardware)
     if (utotal < (cellCount * 3250)) {
         warningBytes[0] |= 0x04; // Pack Voltage Low (01 in bits 2-3)
     }
-    if (umax > 4190) {
-        warningBytes[0] |= 0x10; // Cell Voltage High (01 in bits 4-5)
-    }
-    if (umin < 3250) {
-        warningBytes[0] |= 0x40; // Cell Voltage Low (01 in bits 6-7)
-    }
+    warningBytes[0] |= WarningBits(Protection::GetLevel(Protection::SIG_UCELLHIGH)) << 4; // Cell Voltage High (bits 4-5)
+    warningBytes[0] |= WarningBits(Protection::GetLevel(Protection::SIG_UCELLLOW)) << 6;  // Cell Voltage Low (bits 6-7)
     
     // Byte 1 warnings
-    if (udelta > Param::GetFloat(Param::VX1uDeltaWarnTresh)) {
-        warningBytes[1] |= 0x01; // Voltage Deviation High (01 in bits 0-1)
-    }
-    if (tempmax > Param::GetFloat(Param::VX1TempWarnHiPoint)) {
-        warningBytes[1] |= 0x04; // Temperature High (01 in bits 2-3)
-    }
-    if (tempmin < Param::GetFloat(Param::VX1TempWarnLoPoint)) {
-        warningBytes[1] |= 0x10; // Temperature Low (01 in bits 4-5)
-    }
+    warningBytes[1] |= WarningBits(Protection::GetLevel(Protection::SIG_UDELTA));        // Voltage Deviation High (bits 0-1)
+    warningBytes[1] |= WarningBits(TemperatureLevel(Protection::SIG_TEMPHIGH, tempmax)) << 2; // Temperature High (bits 2-3)
+    warningBytes[1] |= WarningBits(TemperatureLevel(Protection::SIG_TEMPLOW, tempmin)) << 4;  // Temperature Low (bits 4-5)
     if ((tempmax - tempmin) > 15) {
         warningBytes[1] |= 0x40; // Temperature Deviation High (01 in bits 6-7)
     }
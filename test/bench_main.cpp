@@ -0,0 +1,97 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Host runner for the benchmarks in src/benchmark.cpp. The same sweeps run
+ * on target with the "bench" terminal command (TERMINAL_DEBUG=1 builds).
+ *
+ * Usage: bench_bms [rounds]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include "benchmark.h"
+#include "bmsalgo.h"
+#include "temp_meas.h"
+
+static uint32_t Nanoseconds()
+{
+   return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char* argv[])
+{
+   int rounds = argc > 1 ? atoi(argv[1]) : 20;
+   uint16_t socLookup[] = { 3300, 3400, 3450, 3500, 3560, 3600, 3700, 3800, 4000, 4100, 4200 };
+   Benchmark::Result results[Benchmark::BENCH_LAST];
+   Benchmark::Result best[Benchmark::BENCH_LAST];
+
+   //Same configuration as the parameter defaults
+   for (int i = 0; i < 11; i++)
+      BmsAlgo::SetSocLookupPoint(i * 10, socLookup[i]);
+
+   BmsAlgo::SetNominalCapacity(100);
+   BmsAlgo::SetCCCVCurve(0, 400, 3900);
+   BmsAlgo::SetCCCVCurve(1, 200, 4100);
+   BmsAlgo::SetCCCVCurve(2, 100, 4200);
+   TempMeas::CalculateBetaTable(10000, 3900);
+
+   //Keep the round with the lowest total, it is least disturbed by the OS
+   for (int round = 0; round < rounds; round++)
+   {
+      Benchmark::Run(results, Nanoseconds);
+
+      for (int i = 0; i < Benchmark::BENCH_LAST; i++)
+      {
+         if (round == 0 || results[i].total < best[i].total)
+            best[i] = results[i];
+      }
+   }
+
+   printf("%-28s %7s %10s %8s %8s\n", "function", "calls", "ns/call", "min", "max");
+
+   for (int i = 0; i < Benchmark::BENCH_LAST; i++)
+   {
+      const Benchmark::Result& r = best[i];
+      printf("%-28s %7u %10.1f %8u %8u\n", r.name, r.calls, (double)r.total / r.calls, r.min, r.max);
+   }
+
+   //Interpolation error of the NTC table from -40 °C (digit 20) up
+   float maxError = 0;
+   int maxErrorDigit = 0;
+
+   for (int digit = 20; digit <= 4000; digit++)
+   {
+      float error = fabsf(TempMeas::Lookup(digit) - TempMeas::AdcToTemperature(digit, 10000, 3900));
+
+      if (error > maxError)
+      {
+         maxError = error;
+         maxErrorDigit = digit;
+      }
+   }
+
+   const Benchmark::Result& exact = best[Benchmark::BENCH_ADCTOTEMP];
+   const Benchmark::Result& table = best[Benchmark::BENCH_TEMPLOOKUP];
+   printf("\nTempMeas::Lookup is %.1fx faster than AdcToTemperature, max error %.3f °C at digit %d\n",
+          (double)exact.total / table.total, maxError, maxErrorDigit);
+
+   return 0;
+}
@@ -0,0 +1,409 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Replays a candump log into the CAN facing part of the firmware.
+ *
+ * BmsFsm, CanMap, CanSdo and VX1 run unmodified on a virtual 1 ms clock
+ * with the same 100 ms task as main(). Input frames are handed to the
+ * receive callbacks at their original time offset, either as fast as
+ * possible or paced to wall clock with -r. Everything the firmware sends
+ * is written in candump log format and optionally compared against a
+ * golden trace, frame by frame per CAN ID.
+ *
+ * Logs are in "candump -l" format. A trailing T marks a frame sent by the
+ * BMS, as written by tools/cantrace_dump.py. Those are not replayed but
+ * serve as golden frames if no separate golden log is given.
+ *
+ * Usage: can_replay [-r] [-g golden.log] [-o out.log] [-p name=value]...
+ *                   [-x canid]... [-w ms] [-e ms] [-s] input.log
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <time.h>
+#include <map>
+#include <set>
+#include <vector>
+#include "canhardware.h"
+#include "canmap.h"
+#include "cansdo.h"
+#include "params.h"
+#include "digio.h"
+#include "anain.h"
+#include "bmsfsm.h"
+#include "selftest.h"
+#include "stm32scheduler.h"
+#include "vx1.h"
+#include "sim_pack.h"
+
+#define ENALEVEL_FIRST       3000
+#define ENALEVEL_CHAINED     1200
+#define MAX_REPORTED_DIFFS   20
+
+struct LogFrame
+{
+   uint32_t ms;
+   uint32_t id;
+   uint8_t len;
+   uint8_t data[8];
+   bool tx;
+};
+
+static uint32_t now;
+static std::vector<LogFrame> produced;
+volatile uint32_t* bkpRegs;
+static uint32_t backupRegisters[11];
+
+class ReplayCan: public CanHardware
+{
+public:
+   void SetBaudrate(enum baudrates) {}
+   void Send(uint32_t canId, uint32_t data[2], uint8_t len)
+   {
+      LogFrame f = { now, canId, len, { 0 }, true };
+      memcpy(f.data, data, 8);
+      produced.push_back(f);
+   }
+   void Deliver(const LogFrame& f)
+   {
+      uint32_t data[2];
+      memcpy(data, f.data, 8);
+      HandleRx(f.id, data, f.len);
+   }
+
+protected:
+   virtual void ConfigureFilters() {}
+};
+
+static Stm32Scheduler* scheduler;
+static CanMap* canMapExternal;
+static CanMap* canMapInternal;
+static BmsFsm* bmsFsm;
+
+void Param::Change(Param::PARAM_NUM paramNum)
+{
+   if (paramNum == Param::VX1mode)
+      VX1::HandleParamChange(paramNum);
+   else
+      SelfTest::SetNumChannels(Param::GetInt(Param::numchan));
+}
+
+/** \brief CAN relevant part of Ms100Task() in main.cpp */
+static void Ms100Task()
+{
+   CanHardware* can = canMapExternal->GetHardware();
+
+   VX1::CheckAndInitBootDisplay(can, scheduler, bmsFsm);
+   VX1::ErrorReportingTask(can, bmsFsm);
+   VX1::TemperatureWarningTask(can, bmsFsm);
+   VX1::UDeltaWarningTask(can, bmsFsm);
+   VX1::ClockStatsDisplayTask(can, bmsFsm);
+   VX1::BmsPgnEmulationTask(can, bmsFsm);
+
+   BmsFsm::bmsstate stt = bmsFsm->Run((BmsFsm::bmsstate)Param::GetInt(Param::opmode));
+   Param::SetInt(Param::opmode, stt);
+   Param::SetInt(Param::counter, (Param::GetInt(Param::counter) + 1) & 0xF);
+   Param::SetInt(Param::uptime, now / 1000);
+
+   canMapExternal->SendAll();
+   canMapInternal->SendAll();
+}
+
+/** \brief Self test part of ReadCellVoltages() so that BmsFsm gets past SELFTEST */
+static void SelfTestTask()
+{
+   static int step = 0;
+
+   if (Param::GetInt(Param::opmode) == BmsFsm::SELFTEST && SelfTest::GetLastResult() != SelfTest::TestFailed)
+      SelfTest::RunTest(step);
+}
+
+/** \brief Parse one line of "candump -l" output, e.g. (1.000000) can0 18FEF105#0011223344556677 T */
+static bool ParseLine(const char* line, LogFrame& f, double& ts)
+{
+   char iface[32], frame[64], dir[4] = "";
+
+   if (sscanf(line, " (%lf) %31s %63s %3s", &ts, iface, frame, dir) < 3) return false;
+
+   char* hash = strchr(frame, '#');
+   if (0 == hash) return false;
+   *hash = 0;
+
+   f.ms = 0;
+   f.id = strtoul(frame, 0, 16);
+   f.tx = dir[0] == 'T';
+   f.len = 0;
+   memset(f.data, 0, sizeof(f.data));
+
+   for (const char* p = hash + 1; p[0] && p[1] && f.len < 8; p += 2)
+   {
+      char byte[3] = { p[0], p[1], 0 };
+      f.data[f.len++] = strtoul(byte, 0, 16);
+   }
+   return true;
+}
+
+static void FormatLine(FILE* out, const LogFrame& f)
+{
+   fprintf(out, "(%u.%06u) vcan0 %0*X#", f.ms / 1000, (f.ms % 1000) * 1000, f.id > 0x7FF ? 8 : 3, f.id);
+   for (int i = 0; i < f.len; i++)
+      fprintf(out, "%02X", f.data[i]);
+   fprintf(out, "%s\n", f.tx ? " T" : "");
+}
+
+/** \brief Read a log and convert time stamps to ms since start
+ * \param start time stamp of firmware boot, negative to use the first frame of the log
+ */
+static bool LoadLog(const char* file, std::vector<LogFrame>& rx, std::vector<LogFrame>& tx, double& start)
+{
+   FILE* fp = fopen(file, "r");
+   char line[256];
+   double ts;
+   bool first = true;
+
+   if (0 == fp)
+   {
+      perror(file);
+      return false;
+   }
+
+   while (fgets(line, sizeof(line), fp))
+   {
+      LogFrame f;
+
+      if (!ParseLine(line, f, ts)) continue;
+      if (first)
+      {
+         //The firmware boots at the first input frame. A golden log that starts
+         //earlier than that was written by -o and already counts from boot
+         if (start < 0) start = ts;
+         else if (ts < start) start = 0;
+         first = false;
+      }
+      f.ms = (uint32_t)((ts - start) * 1000 + 0.5);
+      (f.tx ? tx : rx).push_back(f);
+   }
+   fclose(fp);
+   return true;
+}
+
+static void SleepUntil(const struct timespec& start, uint32_t ms)
+{
+   struct timespec t = start;
+   t.tv_sec += ms / 1000;
+   t.tv_nsec += (ms % 1000) * 1000000L;
+   if (t.tv_nsec >= 1000000000L)
+   {
+      t.tv_sec++;
+      t.tv_nsec -= 1000000000L;
+   }
+   clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, 0);
+}
+
+/** \brief Compares per CAN ID, so that interleaving of different IDs does not matter
+ * \return number of differences
+ */
+static int Compare(const std::vector<LogFrame>& golden, const std::set<uint32_t>& excluded, int window)
+{
+   std::map<uint32_t, std::vector<const LogFrame*> > expected, actual;
+   int diffs = 0;
+
+   for (const LogFrame& f: golden)
+      if (!excluded.count(f.id)) expected[f.id].push_back(&f);
+   for (const LogFrame& f: produced)
+      if (!excluded.count(f.id)) actual[f.id].push_back(&f);
+
+   for (auto& a: actual)
+      if (!expected.count(a.first)) expected[a.first];
+
+   for (auto& e: expected)
+   {
+      std::vector<const LogFrame*>& act = actual[e.first];
+      size_t n = e.second.size() < act.size() ? e.second.size() : act.size();
+
+      for (size_t i = 0; i < n; i++)
+      {
+         const LogFrame& g = *e.second[i];
+         const LogFrame& p = *act[i];
+         bool same = g.len == p.len && memcmp(g.data, p.data, g.len) == 0;
+         int dt = (int)p.ms - (int)g.ms;
+
+         if (window >= 0 && (dt > window || dt < -window)) same = false;
+
+         if (!same)
+         {
+            if (diffs < MAX_REPORTED_DIFFS)
+            {
+               printf("%0*X #%zu\n  expected ", e.first > 0x7FF ? 8 : 3, e.first, i);
+               FormatLine(stdout, g);
+               printf("  got      ");
+               FormatLine(stdout, p);
+            }
+            diffs++;
+         }
+      }
+
+      if (e.second.size() != act.size())
+      {
+         printf("%0*X: expected %zu frames, got %zu\n", e.first > 0x7FF ? 8 : 3, e.first, e.second.size(), act.size());
+         diffs++;
+      }
+   }
+
+   return diffs;
+}
+
+int main(int argc, char* argv[])
+{
+   const char* goldenFile = 0;
+   const char* outFile = 0;
+   std::vector<const char*> paramArgs;
+   std::set<uint32_t> excluded;
+   bool realTime = false, subModule = false;
+   int window = -1, extra = 1000;
+   int opt;
+
+   while ((opt = getopt(argc, argv, "rg:o:p:x:w:e:s")) != -1)
+   {
+      switch (opt)
+      {
+      case 'r': realTime = true; break;
+      case 'g': goldenFile = optarg; break;
+      case 'o': outFile = optarg; break;
+      case 'p': paramArgs.push_back(optarg); break;
+      case 'x': excluded.insert(strtoul(optarg, 0, 16)); break;
+      case 'w': window = atoi(optarg); break;
+      case 'e': extra = atoi(optarg); break;
+      case 's': subModule = true; break;
+      default:
+         fprintf(stderr, "Usage: %s [-r] [-g golden.log] [-o out.log] [-p name=value]... [-x canid]... [-w ms] [-e ms] [-s] input.log\n", argv[0]);
+         return 2;
+      }
+   }
+
+   if (optind >= argc)
+   {
+      fprintf(stderr, "No input log given\n");
+      return 2;
+   }
+
+   std::vector<LogFrame> input, golden;
+
+   double logStart = -1;
+
+   if (!LoadLog(argv[optind], input, golden, logStart)) return 2;
+   if (goldenFile != 0)
+   {
+      golden.clear();
+      if (!LoadLog(goldenFile, golden, golden, logStart)) return 2;
+   }
+
+   bkpRegs = backupRegisters;
+   DIG_IO_CONFIGURE(DIG_IO_LIST);
+   Param::LoadDefaults();
+
+   for (const char* arg: paramArgs)
+   {
+      char name[64];
+      const char* eq = strchr(arg, '=');
+      Param::PARAM_NUM idx;
+
+      if (0 == eq || eq - arg >= (int)sizeof(name))
+      {
+         fprintf(stderr, "Expected name=value, got %s\n", arg);
+         return 2;
+      }
+      memcpy(name, arg, eq - arg);
+      name[eq - arg] = 0;
+      idx = Param::NumFromString(name);
+
+      if (idx == Param::PARAM_INVALID)
+      {
+         fprintf(stderr, "Unknown parameter %s\n", name);
+         return 2;
+      }
+      Param::SetFloat(idx, atof(eq + 1));
+   }
+
+   Param::Change(Param::PARAM_LAST);
+   SimPack::Reset(Param::GetInt(Param::numchan));
+   AnaIn::enalevel.Set(subModule ? ENALEVEL_CHAINED : ENALEVEL_FIRST);
+
+   Stm32Scheduler s(0);
+   VX1::Initialize();
+   ReplayCan c;
+   CanMap cmi(&c, false);
+   CanMap cme(&c);
+   CanSdo sdo(&c, &cme);
+   BmsFsm fsm(&cmi, &sdo);
+
+   scheduler = &s;
+   canMapExternal = &cme;
+   canMapInternal = &cmi;
+   bmsFsm = &fsm;
+   s.AddTask(SelfTestTask, 25);
+   s.AddTask(Ms100Task, 100);
+
+   //With a golden trace run until its last frame, otherwise a bit past the input
+   uint32_t end = input.empty() ? 0 : input.back().ms;
+   if (golden.empty())
+      end += extra;
+   else if (golden.back().ms > end)
+      end = golden.back().ms;
+
+   struct timespec start;
+   clock_gettime(CLOCK_MONOTONIC, &start);
+   size_t next = 0;
+
+   for (now = 1; now <= end; now++)
+   {
+      while (next < input.size() && input[next].ms <= now)
+         c.Deliver(input[next++]);
+
+      s.Tick();
+      SimPack::Advance(1);
+
+      if (realTime) SleepUntil(start, now);
+   }
+
+   FILE* out = outFile ? fopen(outFile, "w") : (golden.empty() ? stdout : 0);
+
+   if (outFile && 0 == out)
+   {
+      perror(outFile);
+      return 2;
+   }
+   if (out)
+   {
+      for (const LogFrame& f: produced)
+         FormatLine(out, f);
+      if (out != stdout) fclose(out);
+   }
+
+   if (golden.empty()) return 0;
+
+   int diffs = Compare(golden, excluded, window);
+
+   printf("%zu frames replayed, %zu produced, %zu expected, %d differences\n",
+          input.size(), produced.size(), golden.size(), diffs);
+
+   return diffs > 0;
+}
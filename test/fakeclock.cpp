@@ -0,0 +1,35 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "fakeclock.h"
+#include "clock.h"
+
+uint32_t fakeTime;
+static uint32_t fakeStep;
+
+static uint32_t FakeClock()
+{
+   return fakeTime += fakeStep;
+}
+
+void UseFakeClock(uint32_t step)
+{
+   fakeTime = 0;
+   fakeStep = step;
+   Clock::SetSource(FakeClock);
+}
@@ -0,0 +1,32 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef FAKECLOCK_H
+#define FAKECLOCK_H
+
+#include <stdint.h>
+
+/* Time base of the unit tests. UseFakeClock() installs it as the Clock source
+ * and sets it to 0. Tests move it by changing fakeTime. step is added on every
+ * read, so code that waits for the clock to advance gets there.
+ */
+extern uint32_t fakeTime;
+
+void UseFakeClock(uint32_t step = 0);
+
+#endif // FAKECLOCK_H
@@ -0,0 +1,456 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <libopencm3/stm32/gpio.h>
+#include <math.h>
+#include <random>
+#include "sim_pack.h"
+#include "hwdefs.h"
+
+#define ADC_ADDR        0x68
+#define DIO_ADDR        0x41
+#define ADC_START       0x80
+#define I2C_SCL         GPIO13
+#define I2C_DI          GPIO14
+#define I2C_DO          GPIO15
+#define MUX_ENABLE      GPIO7
+
+#define HBRIDGE_DISCHARGE_VIA_LOWSIDE    0xF
+#define HBRIDGE_UOUTP_TO_GND_UOUTN_TO_5V 0xC
+#define HBRIDGE_UOUTP_TO_5V_UOUTN_TO_GND 0x3
+
+//The board we pretend to be
+HwRev hwRev = HW_22;
+
+//Matches the default of parameter "gain" which is 0.587 mV/digit
+const float SimPack::DIGITS_PER_MV = 1000.0f / 587.0f;
+
+float SimPack::cells[MAX_CELLS];
+int SimPack::numCells = MAX_CELLS;
+float SimPack::noise = 0;
+float SimPack::chargeRate = 2.0f;
+float SimPack::dischargeRate = 1.0f;
+SimPack::Fault SimPack::fault = SimPack::FAULT_NONE;
+int SimPack::openCell = -1;
+float SimPack::floatingInput = 0;
+uint32_t SimPack::now = 0;
+
+uint16_t SimPack::gpiob = 0;
+bool SimPack::scl = true;
+bool SimPack::masterSda = true;
+bool SimPack::slaveSda = true;
+SimPack::I2CState SimPack::i2cState = SimPack::I2C_IDLE;
+uint8_t SimPack::i2cAddress = 0;
+uint8_t SimPack::shiftReg = 0;
+uint8_t SimPack::readByte = 0xFF;
+uint8_t SimPack::bitIndex = 0;
+uint8_t SimPack::byteIndex = 0;
+bool SimPack::masterAck = false;
+uint32_t SimPack::i2cTransactions = 0;
+
+uint8_t SimPack::dioRegs[4];
+uint8_t SimPack::dioPointer = 0;
+uint8_t SimPack::adcConfig = 0;
+int32_t SimPack::adcResult = 0;
+bool SimPack::adcReady = false;
+bool SimPack::adcBusy = false;
+uint32_t SimPack::conversionEnd = 0;
+
+static uint16_t otherPorts[2]; //GPIOA and GPIOC, only stored for reading back
+static std::mt19937 rng;
+//Conversion time in ms for 12, 14, 16 and 18 bit
+static const uint32_t conversionTime[] = { 5, 17, 67, 267 };
+
+/** \brief Puts the pack and all chips into their power-on state
+ *
+ * \param n number of connected cells, inputs above are tied to the top cell
+ * \param cellVoltage initial voltage of every cell in mV
+ *
+ */
+void SimPack::Reset(int n, float cellVoltage)
+{
+   numCells = n;
+
+   for (int i = 0; i < MAX_CELLS; i++)
+      cells[i] = i < n ? cellVoltage : 0;
+
+   noise = 0;
+   fault = FAULT_NONE;
+   openCell = -1;
+   floatingInput = 0;
+   now = 0;
+   rng.seed(1);
+
+   //Bus is idle, SCL and SDA high
+   gpiob = I2C_SCL | I2C_DO;
+   scl = masterSda = slaveSda = true;
+   i2cState = I2C_IDLE;
+   i2cTransactions = 0;
+
+   //PCA9536 reset values: all pins are inputs with the output latch high
+   dioRegs[0] = 0xFF;
+   dioRegs[1] = 0xFF;
+   dioRegs[2] = 0x00;
+   dioRegs[3] = 0xFF;
+   dioPointer = 0;
+
+   adcConfig = 0;
+   adcResult = 0;
+   adcReady = false;
+   adcBusy = false;
+}
+
+void SimPack::SetBalanceRate(float chargeMvPerS, float dischargeMvPerS)
+{
+   chargeRate = chargeMvPerS;
+   dischargeRate = dischargeMvPerS;
+}
+
+/** \brief Breaks the sense lead of a cell
+ *
+ * \param cell cell whose input floats, -1 to repair
+ * \param floatingMv voltage the input floats at until the H-bridge moves it
+ *
+ */
+void SimPack::SetOpenWire(int cell, float floatingMv)
+{
+   openCell = cell;
+   //Odd cells are seen with reversed polarity at the ADC
+   floatingInput = cell & 1 ? -floatingMv : floatingMv;
+}
+
+/** \brief Advances simulated time, finishing conversions and moving balanced cells
+ *
+ * \param ms time step in milliseconds
+ *
+ */
+void SimPack::Advance(uint32_t ms)
+{
+   for (uint32_t i = 0; i < ms; i++)
+   {
+      now++;
+
+      uint8_t hbridge = GetHBridge() & ~dioRegs[3] & 0xF;
+      int evenTap = 2 * (gpiob & 0xF);
+      int oddTap = 2 * ((gpiob >> 4) & 0x7) + 1;
+      float delta = 0;
+
+      if (hbridge == HBRIDGE_UOUTP_TO_5V_UOUTN_TO_GND)
+         delta = oddTap > evenTap ? chargeRate : -chargeRate;
+      else if (hbridge == HBRIDGE_UOUTP_TO_GND_UOUTN_TO_5V)
+         delta = oddTap > evenTap ? -chargeRate : chargeRate;
+      else if (hbridge == HBRIDGE_DISCHARGE_VIA_LOWSIDE)
+         delta = -dischargeRate;
+
+      if ((gpiob & MUX_ENABLE) && openCell >= 0 && GetSelectedCell() == openCell)
+      {
+         //With a broken sense lead the H-bridge only moves the filter capacitor
+         if (hbridge == HBRIDGE_UOUTP_TO_5V_UOUTN_TO_GND) floatingInput = 1e6;
+         else if (hbridge == HBRIDGE_UOUTP_TO_GND_UOUTN_TO_5V) floatingInput = -1e6;
+         else if (hbridge == HBRIDGE_DISCHARGE_VIA_LOWSIDE) floatingInput = 0;
+      }
+      else if ((gpiob & MUX_ENABLE) && fault != FAULT_BALANCER && delta != 0)
+      {
+         int low = oddTap < evenTap ? oddTap : evenTap;
+         int high = oddTap < evenTap ? evenTap : oddTap;
+
+         for (int cell = low; cell < high && cell < numCells; cell++)
+            cells[cell] += delta / 1000.0f;
+      }
+
+      if (adcBusy && now >= conversionEnd)
+         LatchConversion();
+   }
+}
+
+int SimPack::GetSelectedCell()
+{
+   if ((gpiob & MUX_ENABLE) == 0) return -1;
+
+   int evenTap = 2 * (gpiob & 0xF);
+   int oddTap = 2 * ((gpiob >> 4) & 0x7) + 1;
+
+   return oddTap < evenTap ? oddTap : evenTap;
+}
+
+int SimPack::GetAdcBits()
+{
+   return 12 + 2 * ((adcConfig >> 2) & 0x3);
+}
+
+void SimPack::GpioWrite(uint32_t port, uint16_t pins, bool level)
+{
+   if (port != GPIOB)
+   {
+      uint16_t& reg = otherPorts[port == GPIOA ? 0 : 1];
+      reg = level ? reg | pins : reg & ~pins;
+      return;
+   }
+
+   bool oldScl = scl;
+   bool oldSda = masterSda && slaveSda;
+
+   gpiob = level ? gpiob | pins : gpiob & ~pins;
+   scl = (gpiob & I2C_SCL) != 0;
+   masterSda = (gpiob & I2C_DO) != 0;
+
+   if (scl && oldScl)
+      UpdateSda(oldSda);
+   else if (scl && !oldScl)
+      I2CClockRise();
+   else if (!scl && oldScl)
+      I2CClockFall();
+}
+
+void SimPack::GpioToggle(uint32_t port, uint16_t pins)
+{
+   uint16_t current = port == GPIOB ? gpiob : otherPorts[port == GPIOA ? 0 : 1];
+
+   GpioWrite(port, pins & ~current, true);
+   GpioWrite(port, pins & current, false);
+}
+
+uint16_t SimPack::GpioRead(uint32_t port, uint16_t pins)
+{
+   if (port != GPIOB)
+      return otherPorts[port == GPIOA ? 0 : 1] & pins;
+
+   uint16_t value = gpiob & ~I2C_DI;
+
+   if (masterSda && slaveSda)
+      value |= I2C_DI;
+
+   return value & pins;
+}
+
+/** \brief Voltage seen by the ADC in mV, referred to the front end input */
+float SimPack::AdcInput()
+{
+   uint8_t hbridge = GetHBridge() & ~dioRegs[3] & 0xF;
+
+   if (gpiob & MUX_ENABLE)
+   {
+      int evenTap = 2 * (gpiob & 0xF);
+      int oddTap = 2 * ((gpiob >> 4) & 0x7) + 1;
+      float oddVoltage = 0, evenVoltage = 0;
+
+      for (int cell = 0; cell < oddTap && cell < numCells; cell++)
+         oddVoltage += cells[cell];
+      for (int cell = 0; cell < evenTap && cell < numCells; cell++)
+         evenVoltage += cells[cell];
+
+      std::normal_distribution<float> dist(0, noise > 0 ? noise : 1);
+      float voltage = oddVoltage - evenVoltage + (noise > 0 ? dist(rng) : 0);
+
+      //An open sense lead holds whatever the input was charged to last
+      return GetSelectedCell() == openCell ? floatingInput : voltage;
+   }
+
+   //With the mux off the H-bridge is the only thing driving the ADC input
+   if (fault != FAULT_BALANCER)
+   {
+      if (hbridge == HBRIDGE_UOUTP_TO_5V_UOUTN_TO_GND) return 1e6;
+      if (hbridge == HBRIDGE_UOUTP_TO_GND_UOUTN_TO_5V) return -1e6;
+   }
+
+   //A shorted mux switch leaks the first cell onto the input
+   return fault == FAULT_MUXSHORT ? cells[0] : 0;
+}
+
+void SimPack::LatchConversion()
+{
+   int bits = GetAdcBits();
+   float digits = ldexpf(AdcInput() * DIGITS_PER_MV, bits - 14);
+   int32_t max = (1 << (bits - 1)) - 1;
+   int32_t min = -(1 << (bits - 1));
+
+   if (digits > max) adcResult = max;
+   else if (digits < min) adcResult = min;
+   else adcResult = lroundf(digits);
+
+   adcReady = true;
+   adcBusy = false;
+}
+
+void SimPack::UpdateSda(bool oldSda)
+{
+   bool sda = masterSda && slaveSda;
+
+   if (oldSda && !sda) //SDA falling while SCL high -> START
+      I2CStart();
+   else if (!oldSda && sda) //SDA rising while SCL high -> STOP
+   {
+      i2cState = I2C_IDLE;
+      slaveSda = true;
+   }
+}
+
+void SimPack::I2CStart()
+{
+   i2cState = I2C_ADDRESS;
+   bitIndex = 0;
+   byteIndex = 0;
+   shiftReg = 0;
+   slaveSda = true;
+   i2cTransactions++;
+}
+
+void SimPack::I2CClockRise()
+{
+   if (i2cState == I2C_IDLE || i2cState == I2C_IGNORE) return;
+
+   if (bitIndex < 8)
+   {
+      shiftReg = (shiftReg << 1) | (masterSda && slaveSda);
+      bitIndex++;
+   }
+   else //acknowledge clock
+   {
+      masterAck = !(masterSda && slaveSda);
+      bitIndex = 9;
+   }
+}
+
+void SimPack::I2CClockFall()
+{
+   if (i2cState == I2C_IDLE || i2cState == I2C_IGNORE) return;
+
+   if (bitIndex == 8)
+   {
+      if (i2cState == I2C_ADDRESS)
+      {
+         i2cAddress = shiftReg >> 1;
+
+         if (i2cAddress != ADC_ADDR && i2cAddress != DIO_ADDR)
+         {
+            i2cState = I2C_IGNORE;
+            return;
+         }
+         i2cState = (shiftReg & 1) ? I2C_READ : I2C_WRITE;
+         slaveSda = false; //ACK our address
+      }
+      else if (i2cState == I2C_WRITE)
+      {
+         I2CWriteByte(shiftReg);
+         slaveSda = false; //ACK data
+      }
+      else
+      {
+         slaveSda = true; //release for master ACK
+      }
+   }
+   else if (bitIndex == 9)
+   {
+      bitIndex = 0;
+      shiftReg = 0;
+      slaveSda = true;
+
+      if (i2cState == I2C_READ)
+      {
+         if (masterAck)
+         {
+            readByte = I2CReadByte();
+            slaveSda = (readByte & 0x80) != 0;
+         }
+         else
+         {
+            i2cState = I2C_IGNORE; //NACK ends the read
+         }
+      }
+   }
+   else if (i2cState == I2C_READ)
+   {
+      slaveSda = ((readByte >> (7 - bitIndex)) & 1) != 0;
+   }
+}
+
+void SimPack::I2CWriteByte(uint8_t byte)
+{
+   if (i2cAddress == DIO_ADDR)
+   {
+      if (byteIndex == 0)
+         dioPointer = byte & 0x3;
+      else
+         dioRegs[dioPointer] = byte;
+   }
+   else
+   {
+      adcConfig = byte;
+
+      if (byte & ADC_START)
+      {
+         conversionEnd = now + conversionTime[(byte >> 2) & 0x3];
+         adcBusy = true;
+      }
+   }
+   byteIndex++;
+}
+
+uint8_t SimPack::I2CReadByte()
+{
+   uint8_t byte;
+
+   if (i2cAddress == DIO_ADDR)
+   {
+      //Input register reflects the output latch on output pins
+      byte = dioPointer == 0 ? (dioRegs[1] & ~dioRegs[3]) | (0xFF & dioRegs[3]) : dioRegs[dioPointer];
+   }
+   else
+   {
+      int dataBytes = GetAdcBits() == 18 ? 3 : 2;
+
+      if (byteIndex < dataBytes)
+      {
+         //Data is sign extended and sent MSB first
+         byte = (adcResult >> (8 * (dataBytes - 1 - byteIndex))) & 0xFF;
+      }
+      else
+      {
+         //Config byte, bit 7 is /RDY
+         byte = (adcConfig & 0x7F) | (adcReady ? 0 : 0x80);
+         adcReady = false;
+      }
+   }
+
+   byteIndex++;
+   return byte;
+}
+
+extern "C" void gpio_set(uint32_t gpioport, uint16_t gpios)
+{
+   SimPack::GpioWrite(gpioport, gpios, true);
+}
+
+extern "C" void gpio_clear(uint32_t gpioport, uint16_t gpios)
+{
+   SimPack::GpioWrite(gpioport, gpios, false);
+}
+
+extern "C" void gpio_toggle(uint32_t gpioport, uint16_t gpios)
+{
+   SimPack::GpioToggle(gpioport, gpios);
+}
+
+extern "C" uint16_t gpio_get(uint32_t gpioport, uint16_t gpios)
+{
+   return SimPack::GpioRead(gpioport, gpios);
+}
+
+extern "C" void gpio_set_mode(uint32_t gpioport, uint8_t mode, uint8_t cnf, uint16_t gpios)
+{
+}
@@ -0,0 +1,97 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SIM_PACK_H
+#define SIM_PACK_H
+
+#include <stdint.h>
+
+/** \brief Virtual battery module for running the acquisition code on the host
+ *
+ * The model sits behind the libopencm3 GPIO functions. It decodes the bit banged
+ * I2C bus of FlyingAdcBms into transactions to the ADC (MCP3421 at 0x68) and the
+ * DIO expander driving the H-bridge (0x41) and follows the mux word on GPIOB.
+ * Time only advances when Advance() is called, so tests run as fast as the host
+ * allows while still seeing the real conversion times.
+ */
+class SimPack
+{
+   public:
+      enum Fault { FAULT_NONE, FAULT_MUXSHORT, FAULT_BALANCER };
+
+      static const int MAX_CELLS = 16;
+
+      static void Reset(int numCells = MAX_CELLS, float cellVoltage = 3600);
+      static void SetCellVoltage(int cell, float mv) { cells[cell] = mv; }
+      static float GetCellVoltage(int cell) { return cells[cell]; }
+      static void SetNoise(float mvRms) { noise = mvRms; }
+      static void SetBalanceRate(float chargeMvPerS, float dischargeMvPerS);
+      static void SetFault(Fault f) { fault = f; }
+      static void SetOpenWire(int cell, float floatingMv = 3600);
+      static void Advance(uint32_t ms);
+      static uint32_t GetTime() { return now; }
+      static int GetSelectedCell();
+      static uint8_t GetHBridge() { return dioRegs[1]; }
+      static int GetAdcBits();
+      static uint32_t GetI2CTransactions() { return i2cTransactions; }
+
+      //Called by the GPIO stubs
+      static void GpioWrite(uint32_t port, uint16_t pins, bool level);
+      static void GpioToggle(uint32_t port, uint16_t pins);
+      static uint16_t GpioRead(uint32_t port, uint16_t pins);
+
+      //Digits per mV of the analog front end at 14 bit resolution
+      static const float DIGITS_PER_MV;
+
+   private:
+      enum I2CState { I2C_IDLE, I2C_ADDRESS, I2C_WRITE, I2C_READ, I2C_IGNORE };
+
+      static float AdcInput();
+      static void LatchConversion();
+      static void I2CStart();
+      static void I2CClockRise();
+      static void I2CClockFall();
+      static void I2CWriteByte(uint8_t byte);
+      static uint8_t I2CReadByte();
+      static void UpdateSda(bool oldSda);
+
+      static float cells[MAX_CELLS];
+      static int numCells;
+      static float noise;
+      static float chargeRate, dischargeRate;
+      static Fault fault;
+      static int openCell;
+      static float floatingInput;
+      static uint32_t now;
+
+      static uint16_t gpiob;
+      static bool scl, masterSda, slaveSda;
+      static I2CState i2cState;
+      static uint8_t i2cAddress, shiftReg, readByte, bitIndex, byteIndex;
+      static bool masterAck;
+      static uint32_t i2cTransactions;
+
+      static uint8_t dioRegs[4];
+      static uint8_t dioPointer;
+      static uint8_t adcConfig;
+      static int32_t adcResult;
+      static bool adcReady, adcBusy;
+      static uint32_t conversionEnd;
+};
+
+#endif // SIM_PACK_H
@@ -0,0 +1,436 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Long term SoC/SoH estimator simulation.
+ *
+ * A ground truth cell (coulomb exact SoC, OCV curve, ohmic and RC
+ * polarization voltage, calendar and cycle fade) is driven by a synthetic
+ * commuter profile or a CSV file and fed through the unmodified
+ * BmsIO::MeasureCurrent(), BmsFsm RUN/IDLE handling, BmsIO::CalculateSocSoh()
+ * and BmsAlgo with a simulated clock.
+ *
+ * Every time the module wakes up it runs in a fresh forked process, so all
+ * function statics start over like after a real power up while the backup
+ * registers and the cell live in shared memory. While the module is off the
+ * cell is fast forwarded without running firmware code.
+ *
+ * Usage: sim_socsoh [-d days] [-n nominal Ah] [-C actual Ah] [-g gain error %] [-o offset A]
+ *                   [-a calendar fade %/year] [-y cycle fade %/EFC] [-q charge below %]
+ *                   [-i charge current A] [-p profile.csv] [-r report interval days] [-m max rms error %]
+ *
+ * A profile CSV has lines "seconds,current A,temperature °C" with charge current
+ * positive and is repeated after the last timestamp.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <vector>
+#include <libopencm3/stm32/f1/bkp.h>
+#include "params.h"
+#include "digio.h"
+#include "anain.h"
+#include "bmsfsm.h"
+#include "bmsio.h"
+#include "bmsalgo.h"
+#include "my_math.h"
+#include "clock.h"
+#include "stub_canhardware.h"
+
+#define STEP            0.005   //MeasureCurrent() period
+#define MAX_DAYS        3650
+#define R0_MOHM         0.8f    //ohmic cell resistance at 25 °C
+#define RP_MOHM         0.6f    //polarization resistance
+#define TAU_S           1800.0  //polarization time constant
+#define SECONDS_PER_DAY 86400
+
+struct Truth
+{
+   double t;
+   double soc; //0..1
+   double capacityAs;
+   double initialCapacityAs;
+   double vp;
+   double throughputAs;
+   bool charging;
+   int lastChargeCheckDay;
+};
+
+struct DayStats
+{
+   double sumSq;
+   double maxErr;
+   long n;
+   float fwSoh;
+   float trueSoh;
+   int boots;
+};
+
+struct Shared
+{
+   uint32_t bkp[11];
+   Truth truth;
+   DayStats days[MAX_DAYS];
+};
+
+volatile uint32_t* bkpRegs;
+
+static int numDays = 90;
+static float nominalAh = 100;
+static float actualAh = 95;
+static float gainError = 1;
+static float offsetError = 0.3f;
+static float calendarFade = 2;
+static float cycleFade = 0.02f;
+static float chargeBelow = 50;
+static float chargeCurrent = 32;
+static int reportInterval = 30;
+static float maxRmsError = 0;
+static std::vector<float> profileTime, profileCurrent, profileTemp;
+static const uint16_t ocv[] = { 3300, 3400, 3450, 3500, 3560, 3600, 3700, 3800, 4000, 4100, 4200 };
+
+void Param::Change(Param::PARAM_NUM)
+{
+   BmsAlgo::SetNominalCapacity(Param::GetFloat(Param::nomcap) * Param::GetFloat(Param::soh) / 100.0f);
+
+   for (int i = 0; i < 11; i++)
+      BmsAlgo::SetSocLookupPoint(i * 10, Param::GetInt((Param::PARAM_NUM)(Param::ucell0soc + i)));
+}
+
+static float OpenCircuitVoltage(double soc)
+{
+   float x = soc * 10;
+
+   if (x <= 0) return ocv[0];
+   if (x >= 10) return ocv[10];
+
+   int i = (int)x;
+   return ocv[i] + (x - i) * (ocv[i + 1] - ocv[i]);
+}
+
+static float CellVoltage(const Truth& tr, float current, float temp)
+{
+   float r0 = R0_MOHM * expf(0.035f * (25 - temp));
+   return OpenCircuitVoltage(tr.soc) + current * r0 + tr.vp;
+}
+
+static void StepTruth(Truth& tr, float current, double dt)
+{
+   static const double decayStep = exp(-STEP / TAU_S);
+   double decay = dt == STEP ? decayStep : exp(-dt / TAU_S);
+   double vpTarget = current * RP_MOHM;
+
+   tr.soc += current * dt / tr.capacityAs;
+   tr.throughputAs += fabs(current) * dt;
+   tr.vp = vpTarget + (tr.vp - vpTarget) * decay;
+   tr.t += dt;
+
+   double efc = tr.throughputAs / (2 * tr.initialCapacityAs);
+   double fade = calendarFade / 100 * tr.t / (365.0 * SECONDS_PER_DAY) + cycleFade / 100 * efc;
+   tr.capacityAs = tr.initialCapacityAs * (1 - fade);
+}
+
+/** \brief Pack current at the current simulation time, charge positive */
+static float Current(Truth& tr, float& temp)
+{
+   int day = tr.t / SECONDS_PER_DAY;
+   double tod = tr.t - day * (double)SECONDS_PER_DAY;
+
+   if (!profileTime.empty())
+   {
+      double pt = fmod(tr.t, profileTime.back());
+      size_t i = 0;
+
+      while (i + 1 < profileTime.size() && profileTime[i + 1] <= pt) i++;
+
+      temp = profileTemp[i];
+      return profileCurrent[i];
+   }
+
+   temp = 12 + 10 * sin(2 * M_PI * (day - 100) / 365.0);
+
+   //40 minutes commute each way with some regen
+   double driveStart[] = { 7.5 * 3600, 17.5 * 3600 };
+
+   for (double start: driveStart)
+   {
+      if (tod >= start && tod < start + 2400)
+      {
+         double s = tod - start;
+         temp += 3;
+         return -(30 + 25 * sin(0.021 * s) + 20 * sin(0.13 * s));
+      }
+   }
+
+   //Plug in at night when below threshold, charge to 90 %
+   if (tod >= 22 * 3600 && tr.lastChargeCheckDay != day)
+   {
+      tr.lastChargeCheckDay = day;
+      tr.charging = tr.soc * 100 < chargeBelow;
+   }
+
+   if (tr.charging && tr.soc >= 0.9)
+      tr.charging = false;
+
+   return tr.charging ? chargeCurrent : 0;
+}
+
+static void RecordStats(Shared* sh)
+{
+   Truth& tr = sh->truth;
+   int day = tr.t / SECONDS_PER_DAY;
+
+   if (day >= MAX_DAYS) return;
+
+   DayStats& d = sh->days[day];
+   double err = Param::GetFloat(Param::soc) - tr.soc * 100;
+
+   d.sumSq += err * err;
+   d.maxErr = fabs(err) > d.maxErr ? fabs(err) : d.maxErr;
+   d.n++;
+   d.fwSoh = Param::GetFloat(Param::soh);
+   d.trueSoh = 100 * tr.capacityAs / (nominalAh * 3600);
+}
+
+/** \brief One power cycle of the module, returns when it switches itself off */
+static const Truth* clockTruth;
+
+/** \brief The RTC keeps counting while the module is off, so the firmware sees the simulation time */
+static uint32_t SimClock()
+{
+   return (uint32_t)fmod(clockTruth->t * 1000, 4294967296.0);
+}
+
+static void RunFirmware(Shared* sh, double endTime)
+{
+   Truth& tr = sh->truth;
+   int idcgain = 10, idcofs = 2048;
+   uint32_t step = 0, zeroSteps = 0;
+
+   bkpRegs = sh->bkp;
+   clockTruth = &tr;
+   Clock::SetSource(SimClock);
+   DIG_IO_CONFIGURE(DIG_IO_LIST);
+   DigIo::selfena_out.Set();
+   Param::LoadDefaults();
+   Param::SetInt(Param::idcmode, IDC_SINGLE);
+   Param::SetInt(Param::idcgain, idcgain);
+   Param::SetInt(Param::idcofs, idcofs);
+   Param::SetFloat(Param::nomcap, nominalAh);
+   Param::Change(Param::PARAM_LAST);
+   BmsIO::LoadNVRAM();
+
+   CanStub can;
+   CanMap canMap(&can, false);
+   CanSdo sdo(&can, &canMap);
+   BmsFsm fsm(&canMap, &sdo);
+
+   Param::SetInt(Param::opmode, BmsFsm::RUN); //Start up and self test are of no interest here
+   sh->days[(int)(tr.t / SECONDS_PER_DAY) % MAX_DAYS].boots++;
+
+   while (tr.t < endTime)
+   {
+      float temp, current = 0;
+
+      for (int i = 0; i < 20; i++, step++)
+      {
+         current = Current(tr, temp);
+
+         //Once the current is gone for good MeasureCurrent() doesn't change anything
+         //anymore, so skip ahead to the next 100 ms task
+         if (current == 0 && zeroSteps >= 400)
+         {
+            StepTruth(tr, 0, STEP * (20 - i));
+            step += 20 - i;
+            break;
+         }
+
+         float measured = current * (1 + gainError / 100) + offsetError;
+         int raw = lroundf(measured * idcgain) + idcofs;
+
+         StepTruth(tr, current, STEP);
+         AnaIn::curpos.Set(MAX(0, MIN(4095, raw)));
+         zeroSteps = current != 0 ? 0 : zeroSteps + 1;
+         BmsIO::MeasureCurrent();
+      }
+
+      //Ms100Task
+      float u = CellVoltage(tr, current, temp);
+      AnaIn::enalevel.Set(current != 0 ? 3000 : 0);
+      Param::SetFloat(Param::umin, u);
+      Param::SetFloat(Param::umax, u);
+      Param::SetFloat(Param::uavg, u);
+      Param::SetFloat(Param::tempmin, temp);
+      Param::SetFloat(Param::tempmax, temp);
+
+      BmsFsm::bmsstate laststt = (BmsFsm::bmsstate)Param::GetInt(Param::opmode);
+      BmsFsm::bmsstate stt = fsm.Run(laststt);
+      BmsIO::CalculateSocSoh(stt, laststt);
+      Param::SetInt(Param::opmode, stt);
+
+      if ((step % 12000) == 0)
+         RecordStats(sh);
+
+      if (!DigIo::selfena_out.Get())
+         break; //sleep timeout
+   }
+}
+
+static bool LoadProfile(const char* file)
+{
+   FILE* f = fopen(file, "r");
+   float t, i, temp;
+
+   if (!f) return false;
+
+   while (fscanf(f, "%f,%f,%f", &t, &i, &temp) == 3)
+   {
+      profileTime.push_back(t);
+      profileCurrent.push_back(i);
+      profileTemp.push_back(temp);
+   }
+   fclose(f);
+   return profileTime.size() > 1;
+}
+
+static void Report(Shared* sh)
+{
+   double totalSumSq = 0, totalMax = 0;
+   long totalN = 0;
+
+   printf("  day  soc err rms[%%]  max[%%]  fw soh[%%]  true soh[%%]  boots\n");
+
+   for (int start = 0; start < numDays; start += reportInterval)
+   {
+      double sumSq = 0, maxErr = 0;
+      long n = 0;
+      int boots = 0;
+      float fwSoh = 0, trueSoh = 0;
+
+      for (int day = start; day < start + reportInterval && day < numDays; day++)
+      {
+         const DayStats& d = sh->days[day];
+         sumSq += d.sumSq;
+         maxErr = d.maxErr > maxErr ? d.maxErr : maxErr;
+         n += d.n;
+         boots += d.boots;
+
+         if (d.n > 0)
+         {
+            fwSoh = d.fwSoh;
+            trueSoh = d.trueSoh;
+         }
+      }
+
+      int end = start + reportInterval < numDays ? start + reportInterval : numDays;
+      printf("%5d  %14.2f  %6.2f  %10.1f  %12.1f  %5d\n", end, n > 0 ? sqrt(sumSq / n) : 0, maxErr, fwSoh, trueSoh, boots);
+
+      totalSumSq += sumSq;
+      totalMax = maxErr > totalMax ? maxErr : totalMax;
+      totalN += n;
+   }
+
+   double rms = totalN > 0 ? sqrt(totalSumSq / totalN) : 0;
+   const DayStats& last = sh->days[numDays - 1];
+   printf("Overall SoC error rms %.2f %%, max %.2f %%, final SoH error %.1f %%\n", rms, totalMax, last.fwSoh - last.trueSoh);
+
+   if (maxRmsError > 0 && rms > maxRmsError)
+   {
+      printf("SoC error exceeds %.2f %%\n", maxRmsError);
+      exit(1);
+   }
+}
+
+int main(int argc, char* argv[])
+{
+   int opt;
+
+   while ((opt = getopt(argc, argv, "d:n:C:g:o:a:y:q:i:p:r:m:")) != -1)
+   {
+      switch (opt)
+      {
+      case 'd': numDays = atoi(optarg); break;
+      case 'n': nominalAh = atof(optarg); break;
+      case 'C': actualAh = atof(optarg); break;
+      case 'g': gainError = atof(optarg); break;
+      case 'o': offsetError = atof(optarg); break;
+      case 'a': calendarFade = atof(optarg); break;
+      case 'y': cycleFade = atof(optarg); break;
+      case 'q': chargeBelow = atof(optarg); break;
+      case 'i': chargeCurrent = atof(optarg); break;
+      case 'r': reportInterval = atoi(optarg); break;
+      case 'm': maxRmsError = atof(optarg); break;
+      case 'p':
+         if (!LoadProfile(optarg))
+         {
+            fprintf(stderr, "Could not read profile %s\n", optarg);
+            return 2;
+         }
+         break;
+      default:
+         fprintf(stderr, "Usage: %s [-d days] [-n nominal Ah] [-C actual Ah] [-g gain error %%] [-o offset A]\n"
+                         "  [-a calendar fade %%/year] [-y cycle fade %%/EFC] [-q charge below %%] [-i charge current A]\n"
+                         "  [-p profile.csv] [-r report interval days] [-m max rms error %%]\n", argv[0]);
+         return 2;
+      }
+   }
+
+   numDays = MAX(1, MIN(MAX_DAYS, numDays));
+   reportInterval = MAX(1, reportInterval);
+
+   Shared* sh = (Shared*)mmap(0, sizeof(Shared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+   Truth& tr = sh->truth;
+   double endTime = numDays * (double)SECONDS_PER_DAY;
+
+   tr.soc = 0.8;
+   tr.initialCapacityAs = tr.capacityAs = actualAh * 3600;
+   tr.lastChargeCheckDay = -1;
+   sh->bkp[1] = tr.soc * 10000; //module was in use before, knows the SoC
+
+   printf("%d days, %.0f Ah nominal, %.0f Ah actual, current sensor %+.1f %% %+.2f A\n",
+          numDays, nominalAh, actualAh, gainError, offsetError);
+   fflush(stdout);
+
+   while (tr.t < endTime)
+   {
+      float temp;
+
+      //Module is off, nothing but the vehicle pulls current
+      if (Current(tr, temp) == 0)
+      {
+         StepTruth(tr, 0, 1);
+         continue;
+      }
+
+      pid_t pid = fork();
+
+      if (pid == 0)
+      {
+         RunFirmware(sh, endTime);
+         _exit(0);
+      }
+      waitpid(pid, 0, 0);
+   }
+
+   Report(sh);
+   return 0;
+}
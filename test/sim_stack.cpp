@@ -0,0 +1,436 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Start up simulation of a daisy chained stack of modules.
+ *
+ * Every module runs the unmodified BmsFsm, CanMap, CanSdo and SelfTest code
+ * in its own process because all of them keep their state in globals
+ * (Param, SelfTest, SimPack). The parent process is the wiring harness: it
+ * models the enable chain and a virtual CAN bus with arbitration and frame
+ * timing. Everything advances in lock step with a 1 ms tick.
+ *
+ * Usage: sim_stack [-n maxnodes] [-r bitrate] [-b bootdelay ms] [-t timeout s]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <vector>
+#include "canhardware.h"
+#include "canmap.h"
+#include "cansdo.h"
+#include "params.h"
+#include "digio.h"
+#include "anain.h"
+#include "bmsfsm.h"
+#include "selftest.h"
+#include "sim_pack.h"
+
+#define MAX_NODES            16
+#define MAX_FRAMES_PER_TICK  32
+#define TX_BUFFER_SIZE       13 //3 mailboxes plus software send buffer
+#define ENALEVEL_FIRST       3000
+#define ENALEVEL_CHAINED     1200
+
+struct SimFrame
+{
+   uint32_t id;
+   uint32_t data[2];
+   uint8_t len;
+};
+
+//Parent -> node, once per ms
+struct TickIn
+{
+   uint16_t enaLevel;
+   uint8_t numFrames;
+   SimFrame frames[MAX_FRAMES_PER_TICK];
+};
+
+//Node -> parent, once per ms
+struct TickOut
+{
+   uint8_t nextEna;
+   uint8_t state;
+   uint8_t modnum;
+   uint8_t totalcells;
+   uint8_t numFrames;
+   uint8_t dropped;
+   SimFrame frames[MAX_FRAMES_PER_TICK];
+};
+
+struct Result
+{
+   int readyMs;
+   int modnum;
+   int totalcells;
+   int frames;
+   int dropped;
+   float avgLoad;
+   float peakLoad;
+   uint32_t maxQueueUs;
+};
+
+class VirtualCan: public CanHardware
+{
+public:
+   VirtualCan(): numFrames(0), dropped(0) {}
+   void SetBaudrate(enum baudrates) {}
+   void Send(uint32_t canId, uint32_t data[2], uint8_t len)
+   {
+      if (numFrames < MAX_FRAMES_PER_TICK)
+      {
+         SimFrame& f = frames[numFrames++];
+         f.id = canId;
+         f.data[0] = data[0];
+         f.data[1] = data[1];
+         f.len = len;
+      }
+      else
+         dropped++;
+   }
+   void Deliver(const SimFrame& f)
+   {
+      uint32_t data[2] = { f.data[0], f.data[1] };
+      HandleRx(f.id, data, f.len);
+   }
+   void Drain(TickOut& out)
+   {
+      memcpy(out.frames, frames, sizeof(SimFrame) * numFrames);
+      out.numFrames = numFrames;
+      out.dropped = dropped;
+      numFrames = 0;
+      dropped = 0;
+   }
+
+protected:
+   virtual void ConfigureFilters() {}
+
+private:
+   SimFrame frames[MAX_FRAMES_PER_TICK];
+   int numFrames;
+   int dropped;
+};
+
+static int bitrate = 500000;
+static int bootDelay = 100;
+static int timeout = 60;
+
+void Param::Change(Param::PARAM_NUM)
+{
+   SelfTest::SetNumChannels(Param::GetInt(Param::numchan));
+}
+
+static void ReadAll(int fd, void* buf, size_t len)
+{
+   uint8_t* p = (uint8_t*)buf;
+
+   while (len > 0)
+   {
+      ssize_t n = read(fd, p, len);
+      if (n <= 0) _exit(0); //other side is gone
+      p += n;
+      len -= n;
+   }
+}
+
+static void WriteAll(int fd, const void* buf, size_t len)
+{
+   const uint8_t* p = (const uint8_t*)buf;
+
+   while (len > 0)
+   {
+      ssize_t n = write(fd, p, len);
+      if (n <= 0) _exit(1);
+      p += n;
+      len -= n;
+   }
+}
+
+/** \brief Firmware side of one module, mimics the tasks set up in main() */
+static void RunNode(int fd)
+{
+   DIG_IO_CONFIGURE(DIG_IO_LIST);
+   Param::LoadDefaults();
+   Param::Change(Param::PARAM_LAST);
+   SimPack::Reset(Param::GetInt(Param::numchan));
+
+   VirtualCan can;
+   CanMap cmi(&can, false);
+   CanMap cme(&can, false);
+   CanSdo sdo(&can, &cme);
+   BmsFsm fsm(&cmi, &sdo);
+   TickIn in;
+   TickOut out;
+   int selfTestStep = 0;
+
+   for (uint32_t ms = 0; ; ms++)
+   {
+      ReadAll(fd, &in, sizeof(in));
+      AnaIn::enalevel.Set(in.enaLevel);
+
+      for (int i = 0; i < in.numFrames; i++)
+         can.Deliver(in.frames[i]);
+
+      //Only the self test part of ReadCellVoltages() matters for start up
+      if ((ms % 25) == 0 && Param::GetInt(Param::opmode) == BmsFsm::SELFTEST &&
+          SelfTest::GetLastResult() != SelfTest::TestFailed)
+         SelfTest::RunTest(selfTestStep);
+
+      if ((ms % 100) == 0)
+      {
+         BmsFsm::bmsstate stt = fsm.Run((BmsFsm::bmsstate)Param::GetInt(Param::opmode));
+         Param::SetInt(Param::opmode, stt);
+         Param::SetInt(Param::counter, (Param::GetInt(Param::counter) + 1) & 0xF);
+         cmi.SendAll();
+      }
+
+      SimPack::Advance(1);
+
+      out.nextEna = DigIo::nextena_out.Get();
+      out.state = Param::GetInt(Param::opmode);
+      out.modnum = fsm.GetNumberOfModules();
+      out.totalcells = Param::GetInt(Param::totalcells);
+      can.Drain(out);
+      WriteAll(fd, &out, sizeof(out));
+   }
+}
+
+/** \brief Bits on the wire for a standard frame including worst case stuffing and IFS */
+static int FrameBits(int len)
+{
+   int stuffable = 34 + 8 * len;
+   return 47 + 8 * len + (stuffable - 1) / 4;
+}
+
+/** \brief Runs one stack of numNodes modules from power on until all are in RUN */
+static Result SimulateStack(int numNodes)
+{
+   struct Pending { int node; SimFrame f; uint64_t queuedUs; };
+   struct Delivery { int node; SimFrame f; uint64_t doneUs; };
+
+   Result r = { -1, 0, 0, 0, 0, 0, 0, 0 };
+   int fds[MAX_NODES];
+   pid_t pids[MAX_NODES];
+   int poweredAt[MAX_NODES];
+   bool nextEna[MAX_NODES] = { false };
+   int state[MAX_NODES] = { 0 };
+   std::vector<Pending> pending;
+   std::vector<Delivery> deliveries;
+   std::vector<SimFrame> inbox[MAX_NODES];
+   uint64_t busFreeUs = 0, busyUs = 0, windowBusyUs = 0;
+   int endMs = timeout * 1000;
+   int ms;
+
+   fflush(stdout);
+
+   for (int i = 0; i < numNodes; i++)
+   {
+      int sv[2];
+      socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+      pids[i] = fork();
+
+      if (pids[i] == 0)
+      {
+         for (int j = 0; j < i; j++) close(fds[j]);
+         close(sv[0]);
+         RunNode(sv[1]);
+      }
+      close(sv[1]);
+      fds[i] = sv[0];
+      poweredAt[i] = -1;
+   }
+
+   poweredAt[0] = 0; //Switched on by the vehicle
+
+   for (ms = 0; ms < endMs; ms++)
+   {
+      uint64_t tickStart = ms * 1000ULL, tickEnd = tickStart + 1000;
+      bool allRunning = true;
+
+      //Enable chain: each module powers the next via nextena_out
+      for (int i = 1; i < numNodes; i++)
+      {
+         if (poweredAt[i] < 0 && nextEna[i - 1])
+            poweredAt[i] = ms;
+      }
+
+      //Hand frames that finished on the bus to every other running module
+      for (auto it = deliveries.begin(); it != deliveries.end();)
+      {
+         if (it->doneUs > tickStart) { ++it; continue; }
+
+         for (int i = 0; i < numNodes; i++)
+         {
+            if (i != it->node && poweredAt[i] >= 0 && ms >= poweredAt[i] + bootDelay &&
+                inbox[i].size() < MAX_FRAMES_PER_TICK)
+               inbox[i].push_back(it->f);
+         }
+         it = deliveries.erase(it);
+      }
+
+      for (int i = 0; i < numNodes; i++)
+      {
+         if (poweredAt[i] < 0 || ms < poweredAt[i] + bootDelay)
+         {
+            allRunning = false;
+            continue;
+         }
+
+         TickIn in;
+         TickOut out;
+         memset(&in, 0, sizeof(in));
+         in.enaLevel = i == 0 ? ENALEVEL_FIRST : (nextEna[i - 1] ? ENALEVEL_CHAINED : 0);
+         in.numFrames = inbox[i].size();
+         if (in.numFrames > 0)
+            memcpy(in.frames, &inbox[i][0], sizeof(SimFrame) * in.numFrames);
+         inbox[i].clear();
+
+         WriteAll(fds[i], &in, sizeof(in));
+         ReadAll(fds[i], &out, sizeof(out));
+
+         nextEna[i] = out.nextEna;
+         state[i] = out.state;
+         r.dropped += out.dropped;
+
+         for (int f = 0; f < out.numFrames; f++)
+         {
+            int queued = 0;
+            for (const Pending& p: pending)
+               queued += p.node == i;
+
+            if (queued < TX_BUFFER_SIZE)
+               pending.push_back({ i, out.frames[f], tickStart });
+            else
+               r.dropped++;
+         }
+
+         if (i == 0)
+         {
+            r.modnum = out.modnum;
+            r.totalcells = out.totalcells;
+         }
+         allRunning &= state[i] == BmsFsm::RUN;
+      }
+
+      //Arbitration: whenever the bus goes idle the lowest pending ID wins
+      while (!pending.empty())
+      {
+         uint64_t now = busFreeUs > tickStart ? busFreeUs : tickStart;
+         int winner = -1;
+
+         if (now >= tickEnd) break;
+
+         for (int p = 0; p < (int)pending.size(); p++)
+         {
+            if (pending[p].queuedUs <= now && (winner < 0 || pending[p].f.id < pending[winner].f.id))
+               winner = p;
+         }
+         if (winner < 0) break;
+
+         uint64_t duration = (FrameBits(pending[winner].f.len) * 1000000ULL) / bitrate;
+         uint32_t waitUs = now - pending[winner].queuedUs;
+
+         r.maxQueueUs = waitUs > r.maxQueueUs ? waitUs : r.maxQueueUs;
+         busFreeUs = now + duration;
+         busyUs += duration;
+         windowBusyUs += duration;
+         r.frames++;
+         deliveries.push_back({ pending[winner].node, pending[winner].f, busFreeUs });
+         pending.erase(pending.begin() + winner);
+      }
+
+      if ((ms % 100) == 99)
+      {
+         float load = windowBusyUs / 1000.0f;
+         r.peakLoad = load > r.peakLoad ? load : r.peakLoad;
+         windowBusyUs = 0;
+      }
+
+      if (allRunning)
+      {
+         r.readyMs = ms;
+         break;
+      }
+   }
+
+   r.avgLoad = ms > 0 ? busyUs / (ms * 10.0f) : 0;
+
+   for (int i = 0; i < numNodes; i++)
+   {
+      close(fds[i]);
+      waitpid(pids[i], 0, 0);
+   }
+
+   return r;
+}
+
+int main(int argc, char* argv[])
+{
+   int maxNodes = MAX_NODES;
+   int failures = 0;
+   int opt;
+
+   while ((opt = getopt(argc, argv, "n:r:b:t:")) != -1)
+   {
+      switch (opt)
+      {
+      case 'n': maxNodes = atoi(optarg); break;
+      case 'r': bitrate = atoi(optarg); break;
+      case 'b': bootDelay = atoi(optarg); break;
+      case 't': timeout = atoi(optarg); break;
+      default:
+         fprintf(stderr, "Usage: %s [-n maxnodes] [-r bitrate] [-b bootdelay ms] [-t timeout s]\n", argv[0]);
+         return 2;
+      }
+   }
+
+   if (maxNodes < 1 || maxNodes > MAX_NODES) maxNodes = MAX_NODES;
+
+   Param::LoadDefaults();
+   int cellsPerModule = Param::GetInt(Param::numchan);
+
+   printf("Stack start up at %d bit/s, %d ms boot delay, %d cells per module\n", bitrate, bootDelay, cellsPerModule);
+   printf("nodes  ready[ms]  modnum  cells  frames  dropped  load avg/peak[%%]  max queue[us]  result\n");
+
+   for (int n = 1; n <= maxNodes; n++)
+   {
+      Result r = SimulateStack(n);
+      const char* verdict = "ok";
+
+      if (r.readyMs < 0)
+         verdict = "TIMEOUT";
+      else if (r.modnum != n || r.totalcells != n * cellsPerModule)
+         verdict = "ENUMERATION";
+      else if (r.dropped > 0)
+         verdict = "DROPPED";
+
+      if (verdict[0] != 'o' && n <= MAX_SUB_MODULES)
+         failures++;
+
+      printf("%5d  %9d  %6d  %5d  %6d  %7d  %6.1f/%5.1f      %13u  %s%s\n", n, r.readyMs, r.modnum, r.totalcells,
+             r.frames, r.dropped, r.avgLoad, r.peakLoad, r.maxQueueUs, verdict,
+             n > MAX_SUB_MODULES ? " (above MAX_SUB_MODULES)" : "");
+   }
+
+   return failures > 0;
+}
@@ -24,22 +24,33 @@
 #include <stdint.h>
 #include <string.h>
 #include <array>
+#include <vector>
 
 class CanStub: public CanHardware
 {
+public:
+   struct Frame
+   {
+      uint32_t                canId;
+      std::array<uint8_t, 8>  data;
+      uint8_t                 len;
+   };
+
+   using CanHardware::Send;
    void SetBaudrate(enum baudrates baudrate) {}
    void Send(uint32_t canId, uint32_t data[2], uint8_t len)
    {
       m_canId = canId;
       memcpy(&m_data[0], &data[0], sizeof(m_data));
       m_len = len;
+      m_frames.push_back({ canId, m_data, len });
    }
    virtual void ConfigureFilters() {}
 
-public:
    std::array<uint8_t, 8>  m_data;
    uint8_t                 m_len;
    uint32_t                m_canId;
+   std::vector<Frame>      m_frames; //All sent frames, tests clear it as needed
 };
 
 extern CanCallback* vcuCan;
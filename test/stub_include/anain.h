@@ -0,0 +1,46 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef ANAIN_H_INCLUDED
+#define ANAIN_H_INCLUDED
+
+/* Host replacement for libopeninv's anain.h. Instead of sampling the
+ * STM32 ADC via DMA every input simply returns a value set by the test
+ */
+#include <stdint.h>
+#include "anain_prj.h"
+
+#define ANA_IN_CONFIGURE(l)
+
+class AnaIn
+{
+public:
+   #define ANA_IN_ENTRY(name, port, pin) static AnaIn name;
+   ANA_IN_LIST
+   #undef ANA_IN_ENTRY
+
+   static void Start() {}
+   void Configure(uint32_t, uint8_t) {}
+   uint16_t Get() { return value; }
+   void Set(uint16_t v) { value = v; }
+
+private:
+   uint16_t value;
+};
+
+#endif // ANAIN_H_INCLUDED
@@ -0,0 +1,28 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CORTEX_STUB_H_INCLUDED
+#define CORTEX_STUB_H_INCLUDED
+
+/* Host replacement for the interrupt masking, the tests have no interrupts */
+#include <stdint.h>
+
+static inline void cm_disable_interrupts(void) {}
+static inline void cm_enable_interrupts(void) {}
+
+#endif // CORTEX_STUB_H_INCLUDED
@@ -0,0 +1,40 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef BKP_STUB_H_INCLUDED
+#define BKP_STUB_H_INCLUDED
+
+/* Host replacement for the battery backed registers. They live wherever
+ * the test points bkpRegs to, e.g. memory shared across a simulated reboot
+ */
+#include <stdint.h>
+
+extern volatile uint32_t* bkpRegs;
+
+#define BKP_DR1  bkpRegs[1]
+#define BKP_DR2  bkpRegs[2]
+#define BKP_DR3  bkpRegs[3]
+#define BKP_DR4  bkpRegs[4]
+#define BKP_DR5  bkpRegs[5]
+#define BKP_DR6  bkpRegs[6]
+#define BKP_DR7  bkpRegs[7]
+#define BKP_DR8  bkpRegs[8]
+#define BKP_DR9  bkpRegs[9]
+#define BKP_DR10 bkpRegs[10]
+
+#endif // BKP_STUB_H_INCLUDED
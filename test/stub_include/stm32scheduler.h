@@ -0,0 +1,64 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef STM32SCHEDULER_H
+#define STM32SCHEDULER_H
+
+#include <stdint.h>
+
+/* Host replacement for the timer driven scheduler. Tasks are run from
+ * Tick() which the simulation calls once per millisecond.
+ */
+class Stm32Scheduler
+{
+public:
+   enum { MAX_TASKS = 8 };
+
+   Stm32Scheduler(uint32_t) : nextTask(0), now(0) {}
+
+   void AddTask(void (*function)(void), uint16_t period)
+   {
+      if (nextTask < MAX_TASKS)
+      {
+         functions[nextTask] = function;
+         periods[nextTask] = period;
+         nextTask++;
+      }
+   }
+
+   void Tick()
+   {
+      now++;
+
+      for (int i = 0; i < nextTask; i++)
+      {
+         if ((now % periods[i]) == 0)
+            functions[i]();
+      }
+   }
+
+   int GetCpuLoad() { return 0; }
+
+private:
+   void (*functions[MAX_TASKS])(void);
+   uint16_t periods[MAX_TASKS];
+   int nextTask;
+   uint32_t now;
+};
+
+#endif // STM32SCHEDULER_H
@@ -41,6 +41,8 @@ void BmsAlgoTest::TestCaseSetup()
    BmsAlgo::SetCCCVCurve(0, 400, 3900);
    BmsAlgo::SetCCCVCurve(1, 200, 4100);
    BmsAlgo::SetCCCVCurve(2, 100, 4200);
+
+   BmsAlgo::ResetThermalModel();
 }
 
 static void TestEstimateSocFromVoltage()
@@ -102,53 +104,118 @@ static void TestGetChargeCurrent2()
    ASSERT(current == 0); //333A because 3850 + 333 * 015 == 3900
 }
 
-static void TestLimitMinimumCellVoltage()
+static void TestLowVoltageDerating()
 {
-   float factor = BmsAlgo::LimitMinimumCellVoltage(3300, 3300);
+   float factor = BmsAlgo::GetDerating(BmsAlgo::DRT_DISCHARGE_LOWVOLT, 3300 - 3300);
    ASSERT(factor == 0);
-   factor = BmsAlgo::LimitMinimumCellVoltage(3200, 3300);
+   factor = BmsAlgo::GetDerating(BmsAlgo::DRT_DISCHARGE_LOWVOLT, 3200 - 3300);
    ASSERT(factor == 0);
-   factor = BmsAlgo::LimitMinimumCellVoltage(3350, 3300);
+   factor = BmsAlgo::GetDerating(BmsAlgo::DRT_DISCHARGE_LOWVOLT, 3350 - 3300);
    ASSERT(factor == 1);
-   factor = BmsAlgo::LimitMinimumCellVoltage(3325, 3300);
+   factor = BmsAlgo::GetDerating(BmsAlgo::DRT_DISCHARGE_LOWVOLT, 3325 - 3300);
    ASSERT(factor == 0.5);
-   factor = BmsAlgo::LimitMinimumCellVoltage(4200, 3300);
+   factor = BmsAlgo::GetDerating(BmsAlgo::DRT_DISCHARGE_LOWVOLT, 4200 - 3300);
    ASSERT(factor == 1);
 }
 
 static void TestLowTemperatureDerating()
 {
-   float factor = BmsAlgo::LowTemperatureDerating(-20);
+   float factor = BmsAlgo::GetDerating(BmsAlgo::DRT_CHARGE_LOWTEMP, -20);
    ASSERT(factor == 0);
-   factor = BmsAlgo::LowTemperatureDerating(-100);
+   factor = BmsAlgo::GetDerating(BmsAlgo::DRT_CHARGE_LOWTEMP, -100);
    ASSERT(factor == 0);
-   factor = BmsAlgo::LowTemperatureDerating(-10);
+   factor = BmsAlgo::GetDerating(BmsAlgo::DRT_CHARGE_LOWTEMP, -10);
    ASSERT(ABS(factor - 0.15) < 0.01); //Account for rounding errors
-   factor = BmsAlgo::LowTemperatureDerating(0);
+   factor = BmsAlgo::GetDerating(BmsAlgo::DRT_CHARGE_LOWTEMP, 0);
    ASSERT(ABS(factor - 0.3) < 0.01); //Account for rounding errors
-   factor = BmsAlgo::LowTemperatureDerating(10);
+   factor = BmsAlgo::GetDerating(BmsAlgo::DRT_CHARGE_LOWTEMP, 10);
    ASSERT(ABS(factor - 0.58) < 0.01); //Account for rounding errors
-   factor = BmsAlgo::LowTemperatureDerating(25);
+   factor = BmsAlgo::GetDerating(BmsAlgo::DRT_CHARGE_LOWTEMP, 25);
    ASSERT(factor == 1); //Account for rounding errors
-   factor = BmsAlgo::LowTemperatureDerating(100);
+   factor = BmsAlgo::GetDerating(BmsAlgo::DRT_CHARGE_LOWTEMP, 100);
    ASSERT(factor == 1); //Account for rounding errors
 }
 
 static void TestHighTemperatureDerating()
 {
-   float factor = BmsAlgo::HighTemperatureDerating(0, 50);
+   float factor = BmsAlgo::GetDerating(BmsAlgo::DRT_CHARGE_HIGHTEMP, 0);
    ASSERT(factor == 1);
-   factor = BmsAlgo::HighTemperatureDerating(43.3, 50);
+   factor = BmsAlgo::GetDerating(BmsAlgo::DRT_CHARGE_HIGHTEMP, 43.3);
    ASSERT(factor == 1);
-   factor = BmsAlgo::HighTemperatureDerating(46.6667, 50);
+   factor = BmsAlgo::GetDerating(BmsAlgo::DRT_CHARGE_HIGHTEMP, 46.6667);
    ASSERT(ABS(factor - 0.5) < 0.01); //Account for rounding errors
-   factor = BmsAlgo::HighTemperatureDerating(50, 50);
+   factor = BmsAlgo::GetDerating(BmsAlgo::DRT_CHARGE_HIGHTEMP, 50);
    ASSERT(factor == 0);
-   factor = BmsAlgo::HighTemperatureDerating(80, 50);
+   factor = BmsAlgo::GetDerating(BmsAlgo::DRT_CHARGE_HIGHTEMP, 80);
    ASSERT(factor == 0);
 }
 
+static void TestCoreTemperatureSteadyState()
+{
+   //100 A through 2 mOhm is 20 W, at 1.5 K/W the core settles 30 K above the sensor
+   BmsAlgo::SetThermalModel(2, 1.5, 100, 0);
+   float core = 0;
+
+   for (int i = 0; i < 10000; i++)
+      core = BmsAlgo::UpdateCoreTemperature(100, 25);
+
+   ASSERT(ABS(core - 55) < 0.1);
+   ASSERT(ABS(BmsAlgo::PredictCoreTemperature(100, 25) - core) < 0.01);
+   //Without current it cools down towards the sensor
+   for (int i = 0; i < 10000; i++)
+      core = BmsAlgo::UpdateCoreTemperature(0, 25);
+
+   ASSERT(ABS(core - 25) < 0.1);
+}
+
+static void TestCoreTemperaturePrediction()
+{
+   BmsAlgo::SetThermalModel(2, 1.5, 100, 100);
+   //One time constant ahead the core has covered 63 % of its 30 K rise
+   float predicted = BmsAlgo::PredictCoreTemperature(-100, 25);
+   ASSERT(ABS(predicted - 43.96) < 0.1);
+   ASSERT(BmsAlgo::GetDerating(BmsAlgo::DRT_CHARGE_HIGHTEMP, predicted) < 1);
+   ASSERT(BmsAlgo::GetDerating(BmsAlgo::DRT_CHARGE_HIGHTEMP, 25) == 1);
+
+   float core = 0;
+   for (int i = 0; i < 1000; i++)
+      core = BmsAlgo::UpdateCoreTemperature(-100, 25);
+
+   ASSERT(ABS(core - predicted) < 0.1);
+}
+
+static void TestEstimateResistance()
+{
+   BmsAlgo::SetThermalModel(0, 1.5, 100, 0);
+   ASSERT(BmsAlgo::EstimateResistance(3600, 0) == 0);
+   //Current goes back before the voltage settled, no estimate
+   BmsAlgo::EstimateResistance(3750, 50);
+   BmsAlgo::EstimateResistance(3600, 0);
+   for (int i = 0; i < 20; i++)
+      ASSERT(BmsAlgo::EstimateResistance(3600, 0) == 0);
+
+   //3 mOhm: the voltage rises by 150 mV at 50 A charge
+   for (int i = 0; i < 10; i++)
+      ASSERT(BmsAlgo::EstimateResistance(3750, 50) == 0);
+   ASSERT(ABS(BmsAlgo::EstimateResistance(3750, 50) - 3) < 0.01);
+
+   //A step to discharge measures the same resistance
+   for (int i = 0; i < 11; i++)
+      BmsAlgo::EstimateResistance(3450, -50);
+   ASSERT(ABS(BmsAlgo::EstimateResistance(3450, -50) - 3) < 0.01);
+   //Voltage falling while the current rises gives a negative resistance, it is dropped
+   for (int i = 0; i < 11; i++)
+      BmsAlgo::EstimateResistance(3300, 0);
+   ASSERT(ABS(BmsAlgo::EstimateResistance(3300, 0) - 3) < 0.01);
+
+   //The estimate is used when rcell is 0
+   for (int i = 0; i < 10000; i++)
+      BmsAlgo::UpdateCoreTemperature(100, 25);
+   ASSERT(ABS(BmsAlgo::UpdateCoreTemperature(100, 25) - 70) < 0.1);
+}
+
 //This line registers the test
 REGISTER_TEST(BmsAlgoTest, TestEstimateSocFromVoltage, TestCalculateSocFromIntegration,
               TestCalculateSoH, TestGetChargeCurrent1, TestGetChargeCurrent2,
-              TestLimitMinimumCellVoltage, TestLowTemperatureDerating, TestHighTemperatureDerating);
+              TestLowVoltageDerating, TestLowTemperatureDerating, TestHighTemperatureDerating,
+              TestCoreTemperatureSteadyState, TestCoreTemperaturePrediction, TestEstimateResistance);
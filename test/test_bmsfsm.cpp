@@ -0,0 +1,95 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.h"
+#include "fakeclock.h"
+#include "bmsfsm.h"
+#include "anain.h"
+#include "digio.h"
+#include "params.h"
+#include "stub_canhardware.h"
+
+class BmsFsmTest: public UnitTest
+{
+   public:
+      BmsFsmTest(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+      virtual void TestSetup();
+      virtual void TestCaseSetup();
+};
+
+static CanStub can;
+static CanMap canMap(&can, false);
+static CanSdo sdo(&can, &canMap);
+
+void BmsFsmTest::TestSetup()
+{
+   DIG_IO_CONFIGURE(DIG_IO_LIST);
+}
+
+void BmsFsmTest::TestCaseSetup()
+{
+   UseFakeClock();
+   AnaIn::enalevel.Set(0);
+   Param::SetFloat(Param::idcavg, 0);
+   Param::SetInt(Param::idlewait, 0);
+   Param::SetFloat(Param::sleeptimeout, 2);
+   DigIo::selfena_out.Set();
+}
+
+/** \brief Drive RUN into IDLE with no current flowing */
+static void EnterIdle(BmsFsm& fsm)
+{
+   BmsFsm::bmsstate stt = BmsFsm::RUN;
+
+   for (int i = 0; i < 10 && stt == BmsFsm::RUN; i++)
+      stt = fsm.Run(stt);
+
+   ASSERT(stt == BmsFsm::IDLE);
+}
+
+static void TestSleepTimeoutIsClockTime()
+{
+   static BmsFsm fsm(&canMap, &sdo);
+
+   EnterIdle(fsm);
+
+   //In low power mode the FSM only runs during the 1 s scan out of every 10 s
+   for (uint32_t t = 0; t < 7190; t += 10)
+   {
+      fakeTime = t * 1000;
+      ASSERT(fsm.Run(BmsFsm::IDLE) == BmsFsm::IDLE);
+   }
+   ASSERT(DigIo::selfena_out.Get());
+
+   fakeTime = 7201 * 1000;
+   fsm.Run(BmsFsm::IDLE);
+   ASSERT(!DigIo::selfena_out.Get());
+}
+
+static void TestEnabledStaysOn()
+{
+   static BmsFsm fsm(&canMap, &sdo);
+
+   EnterIdle(fsm);
+   AnaIn::enalevel.Set(3000);
+   fakeTime = 3 * 3600 * 1000;
+   fsm.Run(BmsFsm::IDLE);
+   ASSERT(DigIo::selfena_out.Get());
+}
+
+REGISTER_TEST(BmsFsmTest, TestSleepTimeoutIsClockTime, TestEnabledStaysOn);
@@ -0,0 +1,146 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.h"
+#include "fakeclock.h"
+#include "cantrace.h"
+#include "stub_canhardware.h"
+
+class CanTraceTest: public UnitTest
+{
+   public:
+      CanTraceTest(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+      virtual void TestCaseSetup();
+};
+
+void CanTraceTest::TestCaseSetup()
+{
+   UseFakeClock();
+   CanTrace::SetMode(CanTrace::RING);
+}
+
+static void RecordFrames(int count)
+{
+   for (int i = 0; i < count; i++)
+   {
+      uint32_t data[2] = { (uint32_t)i, ~(uint32_t)i };
+      fakeTime = i * 10;
+      CanTrace::Record(0x100 + i, data, 8, i & 1);
+   }
+}
+
+static void TestRecordsTxAndRx()
+{
+   RecordFrames(2);
+
+   ASSERT(CanTrace::GetCount() == 2);
+   ASSERT(CanTrace::GetEntry(0)->id == 0x100);
+   ASSERT(CanTrace::GetEntry(1)->id == (0x101 | CanTrace::FLAG_TX));
+   ASSERT(CanTrace::GetEntry(1)->time == (10u | (8u << 28)));
+   ASSERT(CanTrace::GetEntry(2) == 0);
+}
+
+static void TestRingKeepsNewest()
+{
+   RecordFrames(CANTRACE_ENTRIES + 5);
+
+   ASSERT(CanTrace::GetCount() == CANTRACE_ENTRIES);
+   ASSERT(CanTrace::GetEntry(0)->data[0] == 5u);
+   ASSERT(CanTrace::GetEntry(CANTRACE_ENTRIES - 1)->data[0] == CANTRACE_ENTRIES + 4u);
+}
+
+static void TestOneShotKeepsOldest()
+{
+   CanTrace::SetMode(CanTrace::ONESHOT);
+   RecordFrames(CANTRACE_ENTRIES + 5);
+
+   ASSERT(CanTrace::GetMode() == CanTrace::STOPPED);
+   ASSERT(CanTrace::GetCount() == CANTRACE_ENTRIES);
+   ASSERT(CanTrace::GetEntry(0)->data[0] == 0);
+}
+
+static void TestRxCallback()
+{
+   CanStub can;
+   uint32_t data[2] = { 0x11223344, 0x55667788 };
+
+   CanTrace::Attach(&can);
+   vcuCan->HandleRx(0x7dd, data, 4);
+
+   ASSERT(CanTrace::GetCount() == 1);
+   ASSERT(CanTrace::GetEntry(0)->id == 0x7dd);
+   ASSERT(CanTrace::GetEntry(0)->data[1] == 0x55667788);
+}
+
+static void TestTracedCanRecordsSend()
+{
+   TracedCan<CanStub> can;
+   uint32_t data[2] = { 1, 2 };
+
+   can.Send(0x18FEF340, data, 8);
+
+   ASSERT(can.m_canId == 0x18FEF340);
+   ASSERT(CanTrace::GetEntry(0)->id == (0x18FEF340 | CanTrace::FLAG_TX));
+}
+
+static uint32_t SdoRead(uint8_t subIndex, uint8_t& cmd)
+{
+   CanSdo::SdoFrame frame = { SDO_READ, SDO_INDEX_CANTRACE, subIndex, 0 };
+   CanTrace::ProcessSdo(&frame);
+   cmd = frame.cmd;
+   return frame.data;
+}
+
+static void TestSdoReadout()
+{
+   uint8_t cmd;
+   RecordFrames(3);
+
+   ASSERT(SdoRead(SDO_CANTRACE_COUNT, cmd) == 3 && cmd == SDO_READ_REPLY);
+
+   for (int i = 0; i < 3; i++)
+   {
+      ASSERT(SdoRead(SDO_CANTRACE_TIME, cmd) == ((uint32_t)i * 10 | (8 << 28)));
+      ASSERT((SdoRead(SDO_CANTRACE_ID, cmd) & ~CanTrace::FLAG_TX) == 0x100u + i);
+      ASSERT(SdoRead(SDO_CANTRACE_DATA0, cmd) == (uint32_t)i);
+      ASSERT(SdoRead(SDO_CANTRACE_DATA1, cmd) == ~(uint32_t)i);
+   }
+
+   SdoRead(SDO_CANTRACE_TIME, cmd);
+   ASSERT(cmd == SDO_ABORT);
+}
+
+static void TestSdoStartStop()
+{
+   CanSdo::SdoFrame frame = { SDO_WRITE, SDO_INDEX_CANTRACE, SDO_CANTRACE_MODE, CanTrace::STOPPED };
+
+   ASSERT(CanTrace::ProcessSdo(&frame));
+   ASSERT(frame.cmd == SDO_WRITE_REPLY);
+   RecordFrames(1);
+   ASSERT(CanTrace::GetCount() == 0);
+
+   frame = { SDO_WRITE, SDO_INDEX_CANTRACE, SDO_CANTRACE_MODE, 7 };
+   CanTrace::ProcessSdo(&frame);
+   ASSERT(frame.cmd == SDO_ABORT);
+
+   frame = { SDO_READ, 0x2000, 0, 0 };
+   ASSERT(!CanTrace::ProcessSdo(&frame));
+}
+
+REGISTER_TEST(CanTraceTest, TestRecordsTxAndRx, TestRingKeepsNewest, TestOneShotKeepsOldest, TestRxCallback,
+              TestTracedCanRecordsSend, TestSdoReadout, TestSdoStartStop);
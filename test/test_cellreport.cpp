@@ -0,0 +1,211 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.h"
+#include "fakeclock.h"
+#include "cellreport.h"
+#include "bmsio.h"
+#include "anain.h"
+#include "params.h"
+#include "stub_canhardware.h"
+#include "executor.h"
+
+class CellReportTest: public UnitTest
+{
+   public:
+      CellReportTest(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+      virtual void TestCaseSetup();
+};
+
+static CanStub can;
+static CanMap canMap(&can, false);
+static CanSdo sdo(&can, &canMap);
+void CellReportTest::TestCaseSetup()
+{
+   can.m_frames.clear();
+   CellReport::SetSdo(&sdo);
+   Executor::SetEventPoll(0);
+   Param::SetInt(Param::opmode, BmsFsm::RUN);
+   //Every look at the clock takes 10 ms, so waiting for a reply times out quickly
+   UseFakeClock(10);
+   Param::SetInt(Param::numchan, 4);
+
+   for (int i = 0; i < 16; i++)
+   {
+      Param::SetInt((Param::PARAM_NUM)(Param::u0 + i), 3300 + i);
+      Param::SetInt((Param::PARAM_NUM)(Param::u0cmd + i), 0);
+   }
+}
+
+/** \brief One module that is first in the chain, i.e. the main module */
+static void SetupMainModule()
+{
+   //The state machine registers with the CAN hardware, so it must outlive the test
+   static BmsFsm fsm(&canMap, &sdo);
+
+   AnaIn::enalevel.Set(4000);
+   CellReport::SetBmsFsm(&fsm);
+}
+
+static uint32_t SdoRead(uint8_t subIndex)
+{
+   CanSdo::SdoFrame frame = { SDO_READ, SDO_INDEX_CELLS, subIndex, 0 };
+
+   ASSERT(CellReport::ProcessSdo(&frame));
+   ASSERT(frame.cmd == SDO_READ_REPLY);
+   return frame.data;
+}
+
+static void TestTakeLocal()
+{
+   CellReport::Module m;
+
+   Param::SetInt(Param::u2cmd, 1);
+   CellReport::TakeLocal(m);
+
+   ASSERT(m.cells == 4);
+   ASSERT(m.voltage[0] == 3300);
+   ASSERT(m.voltage[3] == 3303);
+   //Unused channels are cleared
+   ASSERT(m.voltage[4] == 0);
+   ASSERT(m.balance == (1u << 4));
+}
+
+static void TestSdoServesSnapshot()
+{
+   ASSERT(SdoRead(SDO_CELLS_COUNT) == 4);
+   //Later changes don't show up until the next snapshot
+   Param::SetInt(Param::u0, 3400);
+   Param::SetInt(Param::u3cmd, 3);
+   ASSERT(SdoRead(SDO_CELLS_VOLTAGE) == (3300u | (3301u << 16)));
+   ASSERT(SdoRead(SDO_CELLS_VOLTAGE + 1) == (3302u | (3303u << 16)));
+   ASSERT(SdoRead(SDO_CELLS_BALANCE) == 0);
+
+   ASSERT(SdoRead(SDO_CELLS_COUNT) == 4);
+   ASSERT((SdoRead(SDO_CELLS_VOLTAGE) & 0xFFFF) == 3400);
+   ASSERT(SdoRead(SDO_CELLS_BALANCE) == (3u << 6));
+}
+
+static void TestSdoRejects()
+{
+   CanSdo::SdoFrame frame = { SDO_WRITE, SDO_INDEX_CELLS, SDO_CELLS_COUNT, 1 };
+
+   ASSERT(CellReport::ProcessSdo(&frame));
+   ASSERT(frame.cmd == SDO_ABORT);
+
+   frame = { SDO_READ, SDO_INDEX_CELLS, SDO_CELLS_VOLTAGE + 8, 0 };
+   ASSERT(CellReport::ProcessSdo(&frame));
+   ASSERT(frame.cmd == SDO_ABORT && frame.data == SDO_ERR_INVIDX);
+
+   frame = { SDO_READ, SDO_INDEX_CELLS + 1, 0, 0 };
+   ASSERT(!CellReport::ProcessSdo(&frame));
+}
+
+static void TestPackExtremes()
+{
+   SetupMainModule();
+   CellReport::Pack p;
+
+   Param::SetFloat(Param::umin0, 3290);
+   Param::SetFloat(Param::umax0, 3310);
+   Param::SetFloat(Param::tempmin0, 21);
+   Param::SetFloat(Param::tempmax0, 24);
+   Param::SetFloat(Param::utotal, 13200);
+   CellReport::TakePack(p);
+
+   ASSERT(p.firstModule == 0 && p.modules == 1);
+   ASSERT(p.utotal == 13200);
+   ASSERT(p.module[0].umin == 3290 && p.module[0].tempmax == 24);
+   ASSERT(p.uminModule == 0 && p.umaxModule == 0);
+   ASSERT(p.tempminModule == 0 && p.tempmaxModule == 0);
+
+   //A module without a working temperature sensor has no temperature extremes
+   Param::SetFloat(Param::tempmin0, NO_TEMP);
+   Param::SetFloat(Param::tempmax0, NO_TEMP);
+   CellReport::TakePack(p);
+   ASSERT(p.tempminModule == 0xFF && p.tempmaxModule == 0xFF);
+}
+
+static void TestLocalAndRemoteModules()
+{
+   SetupMainModule();
+   CellReport::Module m;
+
+   //The main module is number 0 and takes its own cells without CAN
+   ASSERT(CellReport::TakeModule(0, m));
+   ASSERT(m.cells == 4);
+   can.m_frames.clear();
+
+   //Module 1 is asked via SDO and doesn't answer here
+   ASSERT(!CellReport::TakeModule(1, m));
+   ASSERT(can.m_frames.size() == 1);
+   ASSERT(can.m_frames[0].canId == 0x600u + Param::GetInt(Param::sdobase) + 1);
+}
+
+static size_t answered;
+
+/** \brief Plays a remote module with 4 cells. Every request first gets a reply to
+ * the wrong sub index and one from another node, then the right one
+ */
+static void AnswerRemote()
+{
+   if (answered == can.m_frames.size()) return;
+
+   answered = can.m_frames.size();
+   const CanStub::Frame& req = can.m_frames.back();
+   uint8_t sub = req.data[3];
+   uint32_t node = req.canId - 0x600;
+   uint32_t values[] = { 4, 3u << 2, 3300u | (3301u << 16), 3302u | (3303u << 16) };
+   uint32_t reply[2] = { SDO_READ_REPLY | (SDO_INDEX_CELLS << 8) | ((uint32_t)(sub + 1) << 24), 1234 };
+
+   CellReport::HandleReply(0x580 + node, reply);
+   reply[0] = SDO_READ_REPLY | (SDO_INDEX_CELLS << 8) | ((uint32_t)sub << 24);
+   CellReport::HandleReply(0x580 + node + 1, reply);
+   reply[1] = sub < 4 ? values[sub] : 0;
+   CellReport::HandleReply(0x580 + node, reply);
+}
+
+static void TestRemoteRepliesMatched()
+{
+   SetupMainModule();
+   CellReport::Module m;
+
+   answered = 0;
+   Executor::SetEventPoll(AnswerRemote);
+   ASSERT(CellReport::TakeModule(1, m));
+   ASSERT(m.cells == 4);
+   ASSERT(m.balance == (3u << 2));
+   ASSERT(m.voltage[0] == 3300 && m.voltage[3] == 3303 && m.voltage[4] == 0);
+   //Count, balance and two voltage pairs
+   ASSERT(can.m_frames.size() == 4);
+}
+
+static void TestRemoteRefusedWhileEnumerating()
+{
+   SetupMainModule();
+   CellReport::Module m;
+
+   Param::SetInt(Param::opmode, BmsFsm::RECV_INFO);
+   ASSERT(!CellReport::TakeModule(1, m));
+   ASSERT(can.m_frames.empty());
+   //The own cells don't need the bus
+   ASSERT(CellReport::TakeModule(0, m));
+}
+
+REGISTER_TEST(CellReportTest, TestTakeLocal, TestSdoServesSnapshot, TestSdoRejects, TestPackExtremes,
+              TestLocalAndRemoteModules, TestRemoteRepliesMatched, TestRemoteRefusedWhileEnumerating);
@@ -0,0 +1,104 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <string.h>
+#include "test.h"
+#include "counters.h"
+
+class CountersTest: public UnitTest
+{
+   public:
+      CountersTest(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+      virtual void TestCaseSetup();
+};
+
+void CountersTest::TestCaseSetup()
+{
+   Counters::Reset();
+   Counters::Set(Counters::CNT_SWEEP_MS, 0);
+   Counters::Set(Counters::CNT_SWEEP_MS_MAX, 0);
+}
+
+static CanSdo::SdoFrame Sdo(uint8_t cmd, uint8_t subIndex, uint32_t data = 0)
+{
+   CanSdo::SdoFrame frame = { cmd, SDO_INDEX_COUNTERS, subIndex, data };
+
+   ASSERT(Counters::ProcessSdo(&frame));
+   return frame;
+}
+
+static void TestIncrement()
+{
+   Counters::Increment(Counters::CNT_I2C_XFER);
+   Counters::Increment(Counters::CNT_I2C_XFER);
+   ASSERT(Counters::Get(Counters::CNT_I2C_XFER) == 2);
+   ASSERT(Counters::Get(Counters::CNT_I2C_COLLISION) == 0);
+}
+
+static void TestGaugeMax()
+{
+   Counters::Max(Counters::CNT_SWEEP_MS_MAX, 400);
+   Counters::Max(Counters::CNT_SWEEP_MS_MAX, 300);
+   ASSERT(Counters::Get(Counters::CNT_SWEEP_MS_MAX) == 400);
+   Counters::Max(Counters::CNT_SWEEP_MS_MAX, 450);
+   ASSERT(Counters::Get(Counters::CNT_SWEEP_MS_MAX) == 450);
+}
+
+static void TestResetKeepsGauges()
+{
+   Counters::Increment(Counters::CNT_SWEEPS);
+   Counters::Set(Counters::CNT_SWEEP_MS, 400);
+   Counters::Reset();
+   ASSERT(Counters::Get(Counters::CNT_SWEEPS) == 0);
+   ASSERT(Counters::Get(Counters::CNT_SWEEP_MS) == 400);
+}
+
+static void TestNames()
+{
+   ASSERT(strcmp(Counters::GetName(Counters::CNT_CAN_TX), "cantx") == 0);
+   ASSERT(strcmp(Counters::GetName(Counters::CNT_JOB_DROPS), "jobdrop") == 0);
+   ASSERT(Counters::GetKind(Counters::CNT_SWEEP_MS) == Counters::GAUGE);
+   ASSERT(Counters::GetKind(Counters::CNT_SWEEPS) == Counters::COUNTER);
+}
+
+static void TestSdoBlock()
+{
+   Counters::Increment(Counters::CNT_CAN_RX);
+   Counters::Set(Counters::CNT_SDO_LATENCY_US, 120);
+
+   ASSERT(Sdo(SDO_READ, SDO_COUNTERS_NUM).data == Counters::CNT_LAST);
+   ASSERT(Sdo(SDO_READ, SDO_COUNTERS_FIRST + Counters::CNT_CAN_RX).data == 1);
+   ASSERT(Sdo(SDO_READ, SDO_COUNTERS_FIRST + Counters::CNT_SDO_LATENCY_US).data == 120);
+
+   CanSdo::SdoFrame reply = Sdo(SDO_WRITE, SDO_COUNTERS_NUM, 1);
+   ASSERT(reply.cmd == SDO_WRITE_REPLY);
+   ASSERT(Counters::Get(Counters::CNT_CAN_RX) == 0);
+   ASSERT(Counters::Get(Counters::CNT_SDO_LATENCY_US) == 120);
+}
+
+static void TestSdoRejects()
+{
+   ASSERT(Sdo(SDO_READ, SDO_COUNTERS_FIRST + Counters::CNT_LAST).cmd == SDO_ABORT);
+   ASSERT(Sdo(SDO_WRITE, SDO_COUNTERS_FIRST, 5).cmd == SDO_ABORT);
+
+   CanSdo::SdoFrame frame = { SDO_READ, SDO_INDEX_COUNTERS + 1, 0, 0 };
+   ASSERT(!Counters::ProcessSdo(&frame));
+}
+
+REGISTER_TEST(CountersTest, TestIncrement, TestGaugeMax, TestResetKeepsGauges, TestNames, TestSdoBlock,
+              TestSdoRejects);
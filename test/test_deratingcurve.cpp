@@ -0,0 +1,85 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <math.h>
+#include "test.h"
+#include "deratingcurve.h"
+
+class DeratingCurveTest: public UnitTest
+{
+   public:
+      DeratingCurveTest(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+};
+
+static void TestEmptyCurve()
+{
+   DeratingCurve curve;
+   ASSERT(curve.Get(-100) == 1);
+   ASSERT(curve.Get(100) == 1);
+}
+
+static void TestInterpolation()
+{
+   const float x[] = { -10, 0, 10, 40 };
+   const float y[] = { 0, 0.2f, 1, 0.4f };
+   DeratingCurve curve(x, y, 4);
+
+   ASSERT(fabsf(curve.Get(-5) - 0.1f) < 0.001f);
+   ASSERT(fabsf(curve.Get(5) - 0.6f) < 0.001f);
+   ASSERT(fabsf(curve.Get(25) - 0.7f) < 0.001f);
+   //Exactly on the points
+   ASSERT(curve.Get(0) == 0.2f);
+   ASSERT(curve.Get(10) == 1);
+}
+
+static void TestFlatOutside()
+{
+   const float x[] = { 0, 50 };
+   const float y[] = { 0, 1 };
+   DeratingCurve curve(x, y, 2);
+
+   ASSERT(curve.Get(-1000) == 0);
+   ASSERT(curve.Get(1000) == 1);
+}
+
+static void TestSinglePoint()
+{
+   const float x[] = { 20 };
+   const float y[] = { 0.5f };
+   DeratingCurve curve(x, y, 1);
+
+   ASSERT(curve.Get(0) == 0.5f);
+   ASSERT(curve.Get(40) == 0.5f);
+}
+
+static void TestInvalidKeepsCurve()
+{
+   const float x[] = { 0, 50 };
+   const float y[] = { 0, 1 };
+   const float badX[] = { 0, 30, 30 };
+   const float badY[] = { 1, 1, 1 };
+   DeratingCurve curve(x, y, 2);
+
+   ASSERT(!curve.Load(badX, badY, 3));
+   ASSERT(!curve.Load(x, y, 0));
+   ASSERT(!curve.Load(x, y, DeratingCurve::MAX_POINTS + 1));
+   ASSERT(fabsf(curve.Get(25) - 0.5f) < 0.001f);
+}
+
+REGISTER_TEST(DeratingCurveTest, TestEmptyCurve, TestInterpolation, TestFlatOutside, TestSinglePoint,
+              TestInvalidKeepsCurve);
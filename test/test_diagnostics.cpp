@@ -0,0 +1,172 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <math.h>
+#include "test.h"
+#include "sim_pack.h"
+#include "flyingadcbms.h"
+#include "diagnostics.h"
+#include "bmsfsm.h"
+#include "params.h"
+
+class DiagnosticsTest: public UnitTest
+{
+   public:
+      DiagnosticsTest(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+      virtual void TestCaseSetup();
+};
+
+void DiagnosticsTest::TestCaseSetup()
+{
+   SimPack::Reset();
+   FlyingAdcBms::Init();
+   Diagnostics::Reset();
+   Param::SetInt(Param::diagint, 1);
+   Param::SetInt(Param::opmode, BmsFsm::RUN);
+   Param::SetInt(Param::lasterr, 0);
+   Param::SetInt(Param::errinfo, 0);
+   Param::SetInt(Param::numchan, 16);
+
+   for (int i = 0; i < 16; i++)
+      Param::SetFloat((Param::PARAM_NUM)(Param::u0 + i), 3600);
+}
+
+/** \brief Calls Diagnostics::Run() like the scan task until a round has finished
+ * \return number of slots the round took
+ */
+static int RunRound()
+{
+   int slots = 0;
+
+   for (int i = 0; i < 200; i++)
+   {
+      bool used = Diagnostics::Run(true);
+      SimPack::Advance(25);
+
+      if (used)
+         slots++;
+      else if (slots > 0)
+         break;
+   }
+   return slots;
+}
+
+/** \brief Like a sweep of BmsIO::ReadCellVoltages() */
+static void ScanCells()
+{
+   for (int i = 0; i < 16; i++)
+   {
+      FlyingAdcBms::SelectChannel(i);
+      FlyingAdcBms::StartAdc();
+      SimPack::Advance(25);
+      float udc = FlyingAdcBms::GetResult() * (Param::GetFloat(Param::gain) / 1000.0f);
+      Param::SetFloat((Param::PARAM_NUM)(Param::u0 + i), udc);
+   }
+}
+
+static void TestRoundBetweenSweeps()
+{
+   for (int i = 0; i < 50; i++)
+      ASSERT(!Diagnostics::Run(false)); //never in the middle of a sweep
+
+   for (int i = 0; i < 5; i++)
+      ASSERT(Diagnostics::Run(i == 0)); //three checks take five slots
+
+   ASSERT(!Diagnostics::IsActive());
+   ASSERT(!Diagnostics::Run(true)); //next round only after diagint
+
+   //The scan finds the conversion of channel 0 running
+   SimPack::Advance(25);
+   ASSERT(SimPack::GetSelectedCell() == 0);
+   ASSERT(FlyingAdcBms::GetResult() == lroundf(3600 * SimPack::DIGITS_PER_MV));
+   ASSERT(Param::GetInt(Param::lasterr) == 0);
+}
+
+static void TestMuxShortReported()
+{
+   ASSERT(RunRound() == 5);
+   SimPack::SetFault(SimPack::FAULT_MUXSHORT);
+   RunRound();
+   ASSERT(Param::GetInt(Param::lasterr) == 0); //one failed round is not enough
+
+   RunRound();
+   ASSERT(Param::GetInt(Param::lasterr) == ERR_MUXSHORT);
+   ASSERT(Param::GetInt(Param::errinfo) > 5);
+}
+
+static void TestBalancerFailReported()
+{
+   SimPack::SetFault(SimPack::FAULT_BALANCER);
+   RunRound();
+   RunRound();
+
+   ASSERT(Param::GetInt(Param::lasterr) == ERR_BALANCER_FAIL);
+   ASSERT(Param::GetInt(Param::errinfo) == 0);
+}
+
+static void TestHealthyPackNoOpenWire()
+{
+   for (int round = 0; round < 40; round++)
+   {
+      RunRound();
+      ScanCells();
+   }
+
+   ASSERT(Param::GetInt(Param::lasterr) == 0);
+}
+
+static void TestOpenWireReported()
+{
+   SimPack::SetOpenWire(3);
+
+   for (int round = 0; round < 6; round++)
+   {
+      RunRound();
+      ScanCells(); //the scan now sees the input where the pulse left it
+   }
+
+   ASSERT(Param::GetInt(Param::lasterr) == ERR_OPENWIRE);
+   ASSERT(Param::GetInt(Param::errinfo) == 3);
+}
+
+static void TestOpenWireOddChannel()
+{
+   SimPack::SetOpenWire(11, 3550); //floats close to its neighbours
+
+   for (int round = 0; round < 16 && Param::GetInt(Param::lasterr) == 0; round++)
+   {
+      RunRound();
+      ScanCells();
+   }
+
+   ASSERT(Param::GetInt(Param::lasterr) == ERR_OPENWIRE);
+   ASSERT(Param::GetInt(Param::errinfo) == 11);
+}
+
+static void TestDisabledAndIdle()
+{
+   Param::SetInt(Param::diagint, 0);
+   ASSERT(RunRound() == 0);
+
+   Param::SetInt(Param::diagint, 1);
+   Param::SetInt(Param::opmode, BmsFsm::IDLE);
+   ASSERT(RunRound() == 0);
+}
+
+REGISTER_TEST(DiagnosticsTest, TestRoundBetweenSweeps, TestMuxShortReported, TestBalancerFailReported,
+              TestHealthyPackNoOpenWire, TestOpenWireReported, TestOpenWireOddChannel, TestDisabledAndIdle);
@@ -0,0 +1,253 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <string.h>
+#include "test.h"
+#include "fakeclock.h"
+#include "eventlog.h"
+
+class EventLogTest: public UnitTest
+{
+   public:
+      EventLogTest(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+      virtual void TestCaseSetup();
+};
+
+#define PAGE_ENTRIES 128
+
+//Stands in for the flash page, erased flash reads as all ones
+static EventLog::Entry page[PAGE_ENTRIES];
+static int erases;
+static void ErasePage()
+{
+   memset(page, 0xFF, sizeof(page));
+   erases++;
+}
+
+static void ProgramPage(int slot, const EventLog::Entry& e)
+{
+   page[slot] = e;
+}
+
+void EventLogTest::TestCaseSetup()
+{
+   UseFakeClock();
+   EventLog::SetModule(0);
+   EventLog::SetEraseAllowed(true);
+   EventLog::SetStorage(page, PAGE_ENTRIES, ErasePage, ProgramPage);
+   EventLog::Clear();
+   ErasePage();
+   erases = 0;
+}
+
+static void RecordEvents(int count)
+{
+   for (int i = 0; i < count; i++)
+   {
+      fakeTime = i * 100;
+      EventLog::Record(EventLog::EVT_STATE, i & 0xF, i);
+   }
+}
+
+static void TestRecordInRam()
+{
+   EventLog::Entry e;
+
+   fakeTime = 1234;
+   EventLog::SetModule(3);
+   ASSERT(EventLog::Record(EventLog::EVT_ERROR, 5, -700));
+   ASSERT(EventLog::GetCount() == 1);
+   ASSERT(EventLog::GetEntry(0, e));
+   ASSERT(e.time == 1234 && e.code == EventLog::EVT_ERROR && e.source == 0x35 && e.value == -700);
+   ASSERT(!EventLog::GetEntry(1, e));
+   //Nothing written yet
+   ASSERT(page[0].code == 0xFF);
+}
+
+static void TestFlushToStorage()
+{
+   EventLog::Entry e;
+
+   RecordEvents(5);
+   EventLog::Flush();
+   ASSERT(EventLog::GetCount() == 5);
+   ASSERT(page[4].code == EventLog::EVT_STATE && page[4].value == 4);
+   ASSERT(page[5].code == 0xFF);
+
+   //Indexes don't change when events move from RAM to storage
+   EventLog::Record(EventLog::EVT_BOOT, 0, 1);
+   ASSERT(EventLog::GetEntry(5, e) && e.code == EventLog::EVT_BOOT);
+   EventLog::Flush();
+   ASSERT(EventLog::GetEntry(5, e) && e.code == EventLog::EVT_BOOT);
+}
+
+static void TestStorageSurvivesReboot()
+{
+   EventLog::Entry e;
+
+   RecordEvents(3);
+   EventLog::Flush();
+   EventLog::SetStorage(page, PAGE_ENTRIES, ErasePage, ProgramPage);
+   ASSERT(EventLog::GetCount() == 3);
+
+   EventLog::Record(EventLog::EVT_BOOT, 0, 0);
+   EventLog::Flush();
+   ASSERT(EventLog::GetEntry(3, e) && e.code == EventLog::EVT_BOOT);
+   ASSERT(erases == 0);
+}
+
+static void TestWrapKeepsNewest()
+{
+   EventLog::Entry e;
+
+   for (int i = 0; i < PAGE_ENTRIES + 1; i++)
+   {
+      EventLog::Record(EventLog::EVT_STATE, 0, i);
+      EventLog::Flush();
+   }
+
+   ASSERT(erases == 1);
+   ASSERT(EventLog::GetCount() == EventLog::KEEP_ON_WRAP + 1);
+   ASSERT(EventLog::GetEntry(0, e) && e.value == PAGE_ENTRIES - EventLog::KEEP_ON_WRAP);
+   ASSERT(EventLog::GetEntry(EventLog::KEEP_ON_WRAP, e) && e.value == PAGE_ENTRIES);
+}
+
+static void TestWrapWaitsForErase()
+{
+   EventLog::Entry e;
+
+   for (int i = 0; i < PAGE_ENTRIES; i++)
+   {
+      EventLog::Record(EventLog::EVT_STATE, 0, i);
+      EventLog::Flush();
+   }
+   EventLog::SetEraseAllowed(false);
+   EventLog::Record(EventLog::EVT_ERROR, 0, 1);
+   ASSERT(!EventLog::NeedsFlush());
+   EventLog::Flush();
+   ASSERT(erases == 0);
+   ASSERT(EventLog::GetEntry(PAGE_ENTRIES, e) && e.code == EventLog::EVT_ERROR);
+
+   EventLog::SetEraseAllowed(true);
+   ASSERT(EventLog::NeedsFlush());
+   EventLog::Flush();
+   ASSERT(erases == 1);
+   ASSERT(EventLog::GetCount() == EventLog::KEEP_ON_WRAP + 1);
+}
+
+static void TestFullRingDrops()
+{
+   EventLog::SetStorage(page, 0, 0, 0);
+   EventLog::Clear();
+
+   RecordEvents(EVENTLOG_RAM_ENTRIES);
+   ASSERT(!EventLog::Record(EventLog::EVT_BOOT, 0, 0));
+   ASSERT(EventLog::GetDropped() == 1);
+   ASSERT(!EventLog::NeedsFlush());
+   ASSERT(EventLog::GetCount() == EVENTLOG_RAM_ENTRIES);
+}
+
+static void TestNeedsFlush()
+{
+   ASSERT(!EventLog::NeedsFlush());
+   RecordEvents(EventLog::FLUSH_BATCH - 1);
+   ASSERT(!EventLog::NeedsFlush());
+   fakeTime += EventLog::FLUSH_DELAY_MS;
+   ASSERT(EventLog::NeedsFlush());
+   EventLog::Flush();
+   ASSERT(!EventLog::NeedsFlush());
+
+   RecordEvents(EventLog::FLUSH_BATCH);
+   ASSERT(EventLog::NeedsFlush());
+   EventLog::Flush();
+
+   //Errors are written right away
+   EventLog::Record(EventLog::EVT_ERROR, 1, 0);
+   ASSERT(EventLog::NeedsFlush());
+}
+
+static void TestFilter()
+{
+   RecordEvents(10);
+   EventLog::Record(EventLog::EVT_ERROR, 2, 0);
+   EventLog::Flush();
+   EventLog::Record(EventLog::EVT_ERROR, 3, 0);
+
+   ASSERT(EventLog::Find(0, 0, 0) == 0);
+   ASSERT(EventLog::Find(0, 0, 550) == 6);
+   ASSERT(EventLog::Find(0, 1 << EventLog::EVT_ERROR, 0) == 10);
+   ASSERT(EventLog::Find(11, 1 << EventLog::EVT_ERROR, 0) == 11);
+   ASSERT(EventLog::Find(12, 1 << EventLog::EVT_ERROR, 0) == -1);
+   ASSERT(EventLog::Find(0, 1 << EventLog::EVT_BOOT, 0) == -1);
+}
+
+static uint32_t Sdo(uint8_t cmd, uint8_t subIndex, uint32_t data, uint8_t& replyCmd)
+{
+   CanSdo::SdoFrame frame = { cmd, SDO_INDEX_EVENTLOG, subIndex, data };
+   EventLog::ProcessSdo(&frame);
+   replyCmd = frame.cmd;
+   return frame.data;
+}
+
+static void TestSdoReadout()
+{
+   uint8_t cmd;
+
+   RecordEvents(4);
+   EventLog::Record(EventLog::EVT_PROTECTION, 2, 3);
+   ASSERT(Sdo(SDO_READ, SDO_EVENTLOG_COUNT, 0, cmd) == 5 && cmd == SDO_READ_REPLY);
+
+   //Only protection events and states from 200 ms on
+   Sdo(SDO_WRITE, SDO_EVENTLOG_CODES, (1 << EventLog::EVT_STATE) | (1 << EventLog::EVT_PROTECTION), cmd);
+   Sdo(SDO_WRITE, SDO_EVENTLOG_FROM, 200, cmd);
+   ASSERT(cmd == SDO_WRITE_REPLY);
+
+   ASSERT(Sdo(SDO_READ, SDO_EVENTLOG_TIME, 0, cmd) == 200);
+   ASSERT(Sdo(SDO_READ, SDO_EVENTLOG_DATA, 0, cmd) == (EventLog::EVT_STATE | (2 << 8) | (2 << 16)));
+   Sdo(SDO_READ, SDO_EVENTLOG_DATA, 0, cmd);
+   ASSERT(Sdo(SDO_READ, SDO_EVENTLOG_DATA, 0, cmd) == (EventLog::EVT_PROTECTION | (2 << 8) | (3 << 16)));
+   Sdo(SDO_READ, SDO_EVENTLOG_DATA, 0, cmd);
+   ASSERT(cmd == SDO_ABORT);
+
+   Sdo(SDO_WRITE, SDO_EVENTLOG_CODES, 0, cmd);
+   Sdo(SDO_WRITE, SDO_EVENTLOG_FROM, 0, cmd);
+   Sdo(SDO_WRITE, SDO_EVENTLOG_CONTROL, 2, cmd);
+   ASSERT(Sdo(SDO_READ, SDO_EVENTLOG_COUNT, 0, cmd) == 0);
+}
+
+static void TestClearWaitsForErase()
+{
+   uint8_t cmd;
+
+   RecordEvents(4);
+   EventLog::Flush();
+   EventLog::SetEraseAllowed(false);
+   Sdo(SDO_WRITE, SDO_EVENTLOG_CONTROL, 2, cmd);
+   ASSERT(cmd == SDO_ABORT);
+   ASSERT(erases == 0);
+   ASSERT(EventLog::GetCount() == 4);
+
+   EventLog::SetEraseAllowed(true);
+   Sdo(SDO_WRITE, SDO_EVENTLOG_CONTROL, 2, cmd);
+   ASSERT(cmd == SDO_WRITE_REPLY);
+   ASSERT(erases == 1);
+   ASSERT(EventLog::GetCount() == 0);
+}
+
+REGISTER_TEST(EventLogTest, TestRecordInRam, TestFlushToStorage, TestStorageSurvivesReboot, TestWrapKeepsNewest, TestWrapWaitsForErase,
+              TestFullRingDrops, TestNeedsFlush, TestFilter, TestSdoReadout, TestClearWaitsForErase);
@@ -0,0 +1,136 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.h"
+#include "executor.h"
+#include "counters.h"
+#include <string>
+
+class ExecutorTest: public UnitTest
+{
+   public:
+      ExecutorTest(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+      virtual void TestCaseSetup();
+};
+
+static int sdoRuns, dumpSteps, polls;
+static bool sdoPending;
+static char order[16];
+static int orderIdx;
+
+static bool SdoJob()
+{
+   sdoRuns++;
+   sdoPending = false;
+   order[orderIdx++] = 's';
+   return true;
+}
+
+static void Poll()
+{
+   polls++;
+   if (sdoPending)
+      Executor::Post(SdoJob);
+}
+
+//A dump of 3 "parameters" that yields after each of them
+static bool DumpJob()
+{
+   for (int i = 0; i < 3; i++)
+   {
+      dumpSteps++;
+      order[orderIdx++] = 'd';
+      Executor::Yield();
+   }
+   return true;
+}
+
+static int resumableCalls;
+
+static bool ResumableJob()
+{
+   resumableCalls++;
+   order[orderIdx++] = 'r';
+   return resumableCalls == 2;
+}
+
+void ExecutorTest::TestCaseSetup()
+{
+   Executor::Clear();
+   Executor::SetEventPoll(Poll);
+   sdoRuns = dumpSteps = polls = resumableCalls = orderIdx = 0;
+   sdoPending = false;
+   for (char& c: order) c = 0;
+}
+
+static void TestIdleWhenNothingPosted()
+{
+   ASSERT(!Executor::RunNext());
+   ASSERT(polls == 1);
+}
+
+static void TestPostIsDeduplicated()
+{
+   ASSERT(Executor::Post(SdoJob));
+   ASSERT(Executor::Post(SdoJob));
+   ASSERT(Executor::RunNext());
+   ASSERT(!Executor::RunNext());
+   ASSERT(sdoRuns == 1);
+}
+
+static void TestUnfinishedJobRunsAgain()
+{
+   Executor::Post(ResumableJob);
+   Executor::Post(SdoJob);
+
+   while (Executor::RunNext());
+
+   ASSERT(resumableCalls == 2);
+   ASSERT(std::string(order) == "rsr");
+}
+
+static void TestSdoServedDuringDump()
+{
+   Executor::Post(DumpJob);
+   sdoPending = true;
+
+   Executor::RunNext();
+
+   //The SDO request was picked up at the first yield, the dump did not run nested
+   ASSERT(dumpSteps == 3 && sdoRuns == 1);
+   ASSERT(std::string(order) == "dsdd");
+   ASSERT(!Executor::IsPending(DumpJob));
+}
+
+template <int N> static bool NopJob() { return true; }
+
+static void TestFullQueueCounted()
+{
+   uint32_t drops = Counters::Get(Counters::CNT_JOB_DROPS);
+   Executor::Job jobs[] = { NopJob<0>, NopJob<1>, NopJob<2>, NopJob<3>, NopJob<4>, NopJob<5>, NopJob<6>, NopJob<7> };
+
+   for (int i = 0; i < 8; i++)
+      ASSERT(Executor::Post(jobs[i]));
+
+   ASSERT(!Executor::Post(NopJob<8>));
+   ASSERT(Counters::Get(Counters::CNT_JOB_DROPS) == drops + 1);
+   Executor::Clear();
+}
+
+REGISTER_TEST(ExecutorTest, TestIdleWhenNothingPosted, TestPostIsDeduplicated, TestUnfinishedJobRunsAgain,
+              TestSdoServedDuringDump, TestFullQueueCounted);
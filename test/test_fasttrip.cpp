@@ -0,0 +1,134 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.h"
+#include "fakeclock.h"
+#include "fasttrip.h"
+#include "params.h"
+#include "digio.h"
+#include "errormessage.h"
+
+class FastTripTest: public UnitTest
+{
+   public:
+      FastTripTest(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+      virtual void TestSetup();
+      virtual void TestCaseSetup();
+};
+
+void FastTripTest::TestSetup()
+{
+   DIG_IO_CONFIGURE(DIG_IO_LIST);
+}
+
+void FastTripTest::TestCaseSetup()
+{
+   UseFakeClock();
+   Param::SetInt(Param::tripmode, TRIP_OPENCHAIN);
+   Param::SetInt(Param::utripmax, 4250);
+   Param::SetInt(Param::utripmin, 2500);
+   Param::SetInt(Param::utriphyst, 50);
+   Param::SetInt(Param::numchan, 4);
+   Param::SetInt(Param::tripreset, 0);
+   Param::SetInt(Param::lasterr, 0);
+   FastTrip::Reset();
+   DigIo::nextena_out.Set();
+}
+
+/** \brief Feed one sweep like BmsIO::ReadCellVoltages() does, 25 ms per cell */
+static void Sweep(float udc)
+{
+   for (int chan = 0; chan < 4; chan++)
+   {
+      FastTrip::CheckCell(chan, udc);
+      FastTrip::ConversionStarted();
+      fakeTime += 25;
+   }
+}
+
+static void TestOverVoltageOpensChain()
+{
+   Sweep(4000);
+   ASSERT(FastTrip::GetState() == FastTrip::TRIP_OK);
+
+   FastTrip::CheckCell(0, 4000);
+   FastTrip::ConversionStarted();
+   fakeTime += 20;
+   FastTrip::CheckCell(1, 4260);
+
+   ASSERT(FastTrip::GetState() == FastTrip::TRIP_OVERVOLTAGE);
+   ASSERT(!DigIo::nextena_out.Get());
+   ASSERT(Param::GetInt(Param::lasterr) == ERR_CELL_OVERVOLTAGE);
+   ASSERT(Param::GetInt(Param::errinfo) == 1);
+   ASSERT(Param::GetInt(Param::tripstt) == FastTrip::TRIP_OVERVOLTAGE);
+   ASSERT(Param::GetInt(Param::triplat) == 20);
+}
+
+static void TestUnderVoltageReportOnly()
+{
+   Param::SetInt(Param::tripmode, TRIP_REPORT);
+   FastTrip::CheckCell(3, 2400);
+
+   ASSERT(FastTrip::GetState() == FastTrip::TRIP_UNDERVOLTAGE);
+   ASSERT(Param::GetInt(Param::lasterr) == ERR_CELL_UNDERVOLTAGE);
+   ASSERT(DigIo::nextena_out.Get());
+}
+
+static void TestTripIsLatched()
+{
+   FastTrip::CheckCell(2, 4300);
+   Sweep(4000);
+   ASSERT(FastTrip::GetState() == FastTrip::TRIP_OVERVOLTAGE); //no reset requested
+
+   Param::SetInt(Param::tripreset, 1);
+   Sweep(4230); //inside the limit but not by the hysteresis
+   ASSERT(FastTrip::GetState() == FastTrip::TRIP_OVERVOLTAGE);
+
+   FastTrip::CheckCell(0, 4000);
+   FastTrip::CheckCell(1, 4000);
+   ASSERT(FastTrip::GetState() == FastTrip::TRIP_OVERVOLTAGE); //not a whole sweep yet
+
+   Sweep(4000);
+   ASSERT(FastTrip::GetState() == FastTrip::TRIP_OK);
+   ASSERT(DigIo::nextena_out.Get());
+   ASSERT(Param::GetInt(Param::tripreset) == 0);
+}
+
+static void TestOff()
+{
+   Param::SetInt(Param::tripmode, TRIP_OFF);
+   Sweep(5000);
+
+   ASSERT(FastTrip::GetState() == FastTrip::TRIP_OK);
+   ASSERT(DigIo::nextena_out.Get());
+}
+
+static void TestOffReleasesLatch()
+{
+   FastTrip::CheckCell(2, 4300);
+   ASSERT(!DigIo::nextena_out.Get());
+
+   Param::SetInt(Param::tripmode, TRIP_OFF);
+   FastTrip::CheckCell(0, 4300);
+
+   ASSERT(FastTrip::GetState() == FastTrip::TRIP_OK);
+   ASSERT(DigIo::nextena_out.Get());
+}
+
+REGISTER_TEST(FastTripTest, TestOverVoltageOpensChain, TestUnderVoltageReportOnly, TestTripIsLatched, TestOff,
+              TestOffReleasesLatch);
@@ -0,0 +1,181 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <math.h>
+#include "test.h"
+#include "sim_pack.h"
+#include "flyingadcbms.h"
+#include "selftest.h"
+#include "digio.h"
+
+class FlyingAdcBmsTest: public UnitTest
+{
+   public:
+      FlyingAdcBmsTest(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+      virtual void TestSetup();
+      virtual void TestCaseSetup();
+};
+
+void FlyingAdcBmsTest::TestSetup()
+{
+   DIG_IO_CONFIGURE(DIG_IO_LIST);
+}
+
+void FlyingAdcBmsTest::TestCaseSetup()
+{
+   SimPack::Reset();
+   FlyingAdcBms::Init();
+   SelfTest::Reset();
+   SelfTest::SetNumChannels(16);
+}
+
+static int ExpectedDigits(float mv)
+{
+   return lroundf(mv * SimPack::DIGITS_PER_MV);
+}
+
+static float Measure(int channel)
+{
+   FlyingAdcBms::SelectChannel(channel);
+   FlyingAdcBms::StartAdc();
+   SimPack::Advance(25); //one ReadCellVoltages() cycle
+   return FlyingAdcBms::GetResult();
+}
+
+static void TestEvenChannel()
+{
+   SimPack::SetCellVoltage(4, 3700);
+   float result = Measure(4);
+   ASSERT(SimPack::GetAdcBits() == 14);
+   ASSERT(result == ExpectedDigits(3700));
+}
+
+static void TestOddChannelPolarity()
+{
+   SimPack::SetCellVoltage(5, 3300);
+   float result = Measure(5);
+   ASSERT(result == ExpectedDigits(3300));
+}
+
+static void TestTopChannel()
+{
+   SimPack::SetCellVoltage(15, 4100);
+   float result = Measure(15);
+   ASSERT(result == ExpectedDigits(4100));
+}
+
+static void TestConversionTime()
+{
+   SimPack::SetCellVoltage(6, 3000);
+   float first = Measure(4);
+
+   FlyingAdcBms::SelectChannel(6);
+   FlyingAdcBms::StartAdc();
+   SimPack::Advance(5); //14 bit conversion takes about 17 ms
+   float stale = FlyingAdcBms::GetResult();
+   ASSERT(stale == first);
+
+   SimPack::Advance(20);
+   float fresh = FlyingAdcBms::GetResult();
+   ASSERT(fresh == ExpectedDigits(3000));
+}
+
+static void TestBalanceCharge()
+{
+   SimPack::SetBalanceRate(2, 1);
+   FlyingAdcBms::SelectChannel(3);
+   FlyingAdcBms::BalanceStatus stt = FlyingAdcBms::SetBalancing(FlyingAdcBms::BAL_CHARGE);
+   SimPack::Advance(1000);
+   FlyingAdcBms::SetBalancing(FlyingAdcBms::BAL_OFF);
+
+   ASSERT(stt == FlyingAdcBms::STT_CHARGENEG);
+   ASSERT(SimPack::GetCellVoltage(3) > 3601.5f && SimPack::GetCellVoltage(3) < 3602.5f);
+   ASSERT(SimPack::GetCellVoltage(2) == 3600 && SimPack::GetCellVoltage(4) == 3600);
+}
+
+static void TestBalanceDischarge()
+{
+   SimPack::SetBalanceRate(2, 1);
+   FlyingAdcBms::SelectChannel(8);
+   FlyingAdcBms::BalanceStatus stt = FlyingAdcBms::SetBalancing(FlyingAdcBms::BAL_DISCHARGE);
+   SimPack::Advance(1000);
+   FlyingAdcBms::MuxOff();
+   SimPack::Advance(1000); //Must not move anything with the mux off
+
+   ASSERT(stt == FlyingAdcBms::STT_DISCHARGE);
+   ASSERT(SimPack::GetCellVoltage(8) > 3598.5f && SimPack::GetCellVoltage(8) < 3599.5f);
+}
+
+static SelfTest::TestResult RunSelfTest(int& step)
+{
+   SelfTest::TestResult result = SelfTest::TestOngoing;
+
+   for (int cycle = 0; cycle < 100 && result != SelfTest::TestsDone && result != SelfTest::TestFailed; cycle++)
+   {
+      result = SelfTest::RunTest(step);
+      SimPack::Advance(25);
+   }
+   return result;
+}
+
+static void TestSelfTestHealthyPack()
+{
+   int step = 0;
+   SelfTest::TestResult result = RunSelfTest(step);
+
+   ASSERT(result == SelfTest::TestsDone);
+   ASSERT(step == 4);
+   //Mux off 2, balancer 4, one cycle per channel and one to report the over voltage check
+   ASSERT(SelfTest::GetTotalCycles() == 2 + 4 + 16 + 1);
+}
+
+static void TestSelfTestReversedCell()
+{
+   int step = 0;
+   SimPack::SetCellVoltage(5, -3600);
+   SelfTest::TestResult result = RunSelfTest(step);
+
+   ASSERT(result == SelfTest::TestFailed);
+   ASSERT(step == 2);
+   ASSERT(SelfTest::GetErrorChannel() == 5);
+}
+
+static void TestSelfTestOverVoltage()
+{
+   int step = 0;
+   SimPack::SetCellVoltage(10, 4600);
+   SelfTest::TestResult result = RunSelfTest(step);
+
+   ASSERT(result == SelfTest::TestFailed);
+   ASSERT(step == 3);
+   ASSERT(SelfTest::GetErrorChannel() == 10);
+}
+
+static void TestSelfTestMuxShort()
+{
+   int step = 0;
+   SimPack::SetFault(SimPack::FAULT_MUXSHORT);
+   SelfTest::TestResult result = RunSelfTest(step);
+
+   ASSERT(result == SelfTest::TestFailed);
+   ASSERT(step == 0);
+}
+
+REGISTER_TEST(FlyingAdcBmsTest, TestEvenChannel, TestOddChannelPolarity, TestTopChannel, TestConversionTime,
+              TestBalanceCharge, TestBalanceDischarge, TestSelfTestHealthyPack, TestSelfTestMuxShort,
+              TestSelfTestReversedCell, TestSelfTestOverVoltage);
@@ -0,0 +1,107 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <string.h>
+#include "test.h"
+#include "imagecrc.h"
+
+class ImageCrcTest: public UnitTest
+{
+   public:
+      ImageCrcTest(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+      virtual void TestCaseSetup();
+};
+
+#define PAGE_SIZE    64
+#define PAGES        4
+#define PAGE_WORDS   (PAGE_SIZE / 4)
+
+static uint32_t flash[PAGES * PAGE_WORDS];
+
+void ImageCrcTest::TestCaseSetup()
+{
+   for (int i = 0; i < PAGES * PAGE_WORDS; i++)
+      flash[i] = i * 0x01010101;
+
+   ImageCrc::SetImage(flash, PAGES, PAGE_SIZE, ImageCrc::Crc32);
+}
+
+static CanSdo::SdoFrame Sdo(uint8_t cmd, uint8_t subIndex, uint32_t data = 0)
+{
+   CanSdo::SdoFrame frame = { cmd, SDO_INDEX_IMAGECRC, subIndex, data };
+
+   ASSERT(ImageCrc::ProcessSdo(&frame));
+   return frame;
+}
+
+static void TestCrc32()
+{
+   //Example of the STM32 CRC application note
+   const uint32_t word = 0x12345678;
+
+   ASSERT(ImageCrc::Crc32(&word, 1) == 0xDF8A8A2B);
+   ASSERT(ImageCrc::Crc32(&word, 0) == 0xFFFFFFFF);
+}
+
+static void TestPageCrc()
+{
+   ASSERT(ImageCrc::GetPageCrc(1) == ImageCrc::Crc32(&flash[PAGE_WORDS], PAGE_WORDS));
+   ASSERT(ImageCrc::GetPageCrc(PAGES) == 0);
+
+   uint32_t before = ImageCrc::GetPageCrc(2);
+   flash[2 * PAGE_WORDS + 5] ^= 1;
+   ASSERT(ImageCrc::GetPageCrc(2) != before);
+}
+
+static void TestImageCrc()
+{
+   ASSERT(ImageCrc::GetImageCrc(PAGE_SIZE + 8) == ImageCrc::Crc32(flash, PAGE_WORDS + 2));
+   //Partial words are rounded up, lengths beyond the area are clipped
+   ASSERT(ImageCrc::GetImageCrc(PAGE_SIZE + 5) == ImageCrc::Crc32(flash, PAGE_WORDS + 2));
+   ASSERT(ImageCrc::GetImageCrc(100000) == ImageCrc::Crc32(flash, PAGES * PAGE_WORDS));
+}
+
+static void TestSdoPageWalk()
+{
+   ASSERT(Sdo(SDO_READ, SDO_IMAGECRC_PAGES).data == PAGES);
+   ASSERT(Sdo(SDO_READ, SDO_IMAGECRC_PAGESIZE).data == PAGE_SIZE);
+   ASSERT(Sdo(SDO_WRITE, SDO_IMAGECRC_SELECT, 2).cmd == SDO_WRITE_REPLY);
+   ASSERT(Sdo(SDO_READ, SDO_IMAGECRC_PAGE).data == ImageCrc::GetPageCrc(2));
+   ASSERT(Sdo(SDO_READ, SDO_IMAGECRC_PAGE).data == ImageCrc::GetPageCrc(3));
+   ASSERT(Sdo(SDO_READ, SDO_IMAGECRC_SELECT).data == PAGES);
+   ASSERT(Sdo(SDO_READ, SDO_IMAGECRC_PAGE).cmd == SDO_ABORT);
+   ASSERT(Sdo(SDO_WRITE, SDO_IMAGECRC_SELECT, PAGES).cmd == SDO_ABORT);
+}
+
+static void TestSdoImage()
+{
+   ASSERT(Sdo(SDO_READ, SDO_IMAGECRC_IMAGE).data == ImageCrc::Crc32(flash, PAGES * PAGE_WORDS));
+   ASSERT(Sdo(SDO_WRITE, SDO_IMAGECRC_IMAGE, 12).cmd == SDO_WRITE_REPLY);
+   ASSERT(Sdo(SDO_READ, SDO_IMAGECRC_IMAGE).data == ImageCrc::Crc32(flash, 3));
+   ASSERT(Sdo(SDO_WRITE, SDO_IMAGECRC_IMAGE, 0).cmd == SDO_ABORT);
+   ASSERT(Sdo(SDO_WRITE, SDO_IMAGECRC_IMAGE, PAGES * PAGE_SIZE + 1).cmd == SDO_ABORT);
+}
+
+static void TestOtherIndex()
+{
+   CanSdo::SdoFrame frame = { SDO_READ, SDO_INDEX_IMAGECRC + 1, 0, 0 };
+
+   ASSERT(!ImageCrc::ProcessSdo(&frame));
+}
+
+REGISTER_TEST(ImageCrcTest, TestCrc32, TestPageCrc, TestImageCrc, TestSdoPageWalk, TestSdoImage, TestOtherIndex);
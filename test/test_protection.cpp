@@ -0,0 +1,157 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.h"
+#include "fakeclock.h"
+#include "protection.h"
+#include "params.h"
+#include "errormessage.h"
+
+class ProtectionTest: public UnitTest
+{
+   public:
+      ProtectionTest(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+      virtual void TestCaseSetup();
+};
+
+void ProtectionTest::TestCaseSetup()
+{
+   Param::LoadDefaults();
+   Param::SetFloat(Param::umax, 3700);
+   Param::SetFloat(Param::umin, 3600);
+   Param::SetFloat(Param::udelta, 100);
+   Param::SetFloat(Param::tempmax, 25);
+   Param::SetFloat(Param::tempmin, 20);
+   Param::SetFloat(Param::idc, 0);
+   Param::SetInt(Param::lasterr, 0);
+   UseFakeClock();
+   Protection::Reset();
+}
+
+/** \brief Evaluate once per 100 ms sweep for the given time */
+static void EvaluateFor(uint32_t ms)
+{
+   for (uint32_t end = fakeTime + ms; fakeTime <= end; fakeTime += 100)
+      Protection::Evaluate();
+}
+
+static void TestNormalPack()
+{
+   EvaluateFor(10000);
+   ASSERT(Protection::GetWorstLevel() == Protection::LEVEL_OK);
+   ASSERT(Param::GetInt(Param::protlevel) == Protection::LEVEL_OK);
+   ASSERT(Protection::GetDerating(Protection::CHARGE) == 1);
+   ASSERT(Protection::GetDerating(Protection::DISCHARGE) == 1);
+}
+
+static void TestLevelNeedsQualifyTime()
+{
+   Param::SetFloat(Param::umax, 4230);
+   EvaluateFor(1900);
+   ASSERT(Protection::GetLevel(Protection::SIG_UCELLHIGH) == Protection::LEVEL_OK);
+   EvaluateFor(100);
+   ASSERT(Protection::GetLevel(Protection::SIG_UCELLHIGH) == Protection::LEVEL_ALARM);
+   ASSERT(Param::GetInt(Param::protsignal) == Protection::SIG_UCELLHIGH);
+}
+
+static void TestShortExcursionIgnored()
+{
+   Param::SetFloat(Param::umax, 4230);
+   EvaluateFor(1500);
+   Param::SetFloat(Param::umax, 4000);
+   EvaluateFor(100);
+   Param::SetFloat(Param::umax, 4230);
+   EvaluateFor(1500);
+   ASSERT(Protection::GetLevel(Protection::SIG_UCELLHIGH) == Protection::LEVEL_OK);
+}
+
+static void TestHysteresis()
+{
+   Param::SetFloat(Param::umax, 4230);
+   EvaluateFor(2000);
+   ASSERT(Protection::GetLevel(Protection::SIG_UCELLHIGH) == Protection::LEVEL_ALARM);
+
+   //Below the alarm threshold but within the 20 mV hysteresis
+   Param::SetFloat(Param::umax, 4210);
+   EvaluateFor(5000);
+   ASSERT(Protection::GetLevel(Protection::SIG_UCELLHIGH) == Protection::LEVEL_ALARM);
+
+   Param::SetFloat(Param::umax, 4195);
+   EvaluateFor(2000);
+   ASSERT(Protection::GetLevel(Protection::SIG_UCELLHIGH) == Protection::LEVEL_WARNING);
+}
+
+static void TestFaultPostsError()
+{
+   Param::SetFloat(Param::umin, 2700);
+   EvaluateFor(2000);
+   ASSERT(Protection::GetLevel(Protection::SIG_UCELLLOW) == Protection::LEVEL_FAULT);
+   ASSERT(Param::GetInt(Param::lasterr) == ERR_CELL_UNDERVOLTAGE);
+   ASSERT(Param::GetInt(Param::errinfo) == 2700);
+   ASSERT(Param::GetInt(Param::protlevel) == Protection::LEVEL_FAULT);
+   ASSERT(Param::GetInt(Param::protsignal) == Protection::SIG_UCELLLOW);
+}
+
+static void TestDerating()
+{
+   Param::SetFloat(Param::tempmax, 62);
+   EvaluateFor(5000);
+   ASSERT(Protection::GetDerating(Protection::CHARGE) == 0.5f);
+   ASSERT(Protection::GetDerating(Protection::DISCHARGE) == 0.5f);
+
+   Param::SetFloat(Param::umax, 4250);
+   EvaluateFor(2000);
+   ASSERT(Protection::GetDerating(Protection::CHARGE) == 0);
+   ASSERT(Protection::GetDerating(Protection::DISCHARGE) == 0.5f);
+}
+
+static void TestCurrentInPercent()
+{
+   //115% of the 200 A discharge rating
+   Param::SetFloat(Param::idc, -230);
+   EvaluateFor(1000);
+   ASSERT(Protection::GetLevel(Protection::SIG_IDISCHARGE) == Protection::LEVEL_ALARM);
+   ASSERT(Protection::GetLevel(Protection::SIG_ICHARGE) == Protection::LEVEL_OK);
+}
+
+static void TestOverCurrentDerating()
+{
+   //115% of the 200 A discharge rating
+   Param::SetFloat(Param::idc, -230);
+   EvaluateFor(1000);
+   ASSERT(Protection::GetDerating(Protection::DISCHARGE) == 0.5f);
+   ASSERT(Protection::GetDerating(Protection::CHARGE) == 1);
+
+   //130% of the 70 A charge rating
+   Param::SetFloat(Param::idc, 91);
+   EvaluateFor(1000);
+   ASSERT(Protection::GetDerating(Protection::CHARGE) == 0);
+   ASSERT(Protection::GetDerating(Protection::DISCHARGE) == 1);
+}
+
+static void TestClassify()
+{
+   ASSERT(Protection::Classify(Protection::SIG_TEMPHIGH, 56) == Protection::LEVEL_WARNING);
+   ASSERT(Protection::Classify(Protection::SIG_TEMPLOW, -5) == Protection::LEVEL_WARNING);
+   ASSERT(Protection::Classify(Protection::SIG_TEMPLOW, -25) == Protection::LEVEL_FAULT);
+   ASSERT(Protection::Classify(Protection::SIG_UDELTA, 100) == Protection::LEVEL_OK);
+   ASSERT(Protection::GetWorstLevel() == Protection::LEVEL_OK);
+}
+
+REGISTER_TEST(ProtectionTest, TestNormalPack, TestLevelNeedsQualifyTime, TestShortExcursionIgnored, TestHysteresis,
+              TestFaultPostsError, TestDerating, TestCurrentInPercent, TestOverCurrentDerating, TestClassify);
@@ -0,0 +1,174 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.h"
+#include "fakeclock.h"
+#include "telemetry.h"
+#include "params.h"
+#include "stub_canhardware.h"
+
+class TelemetryTest: public UnitTest
+{
+   public:
+      TelemetryTest(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+      virtual void TestCaseSetup();
+};
+
+#define TLM_ID 0x7C0
+
+static CanStub can;
+void TelemetryTest::TestCaseSetup()
+{
+   can.m_frames.clear();
+   UseFakeClock();
+   Telemetry::SetCan(&can);
+   Telemetry::SetModule(0);
+   //Switching off resets the buffers
+   Telemetry::Configure(0, 100, TLM_ID);
+   Param::SetInt(Param::numchan, 4);
+
+   for (int i = 0; i < 16; i++)
+   {
+      Param::SetInt((Param::PARAM_NUM)(Param::u0 + i), 3300 + i);
+      Param::SetInt((Param::PARAM_NUM)(Param::u0cmd + i), 0);
+   }
+}
+
+static void Run(int times)
+{
+   for (int i = 0; i < times; i++)
+   {
+      Telemetry::Run();
+      fakeTime += Telemetry::RUN_INTERVAL_MS;
+   }
+}
+
+/** \brief Concatenates the payload of all sent frames like the decoder does */
+static std::vector<uint8_t> Reassemble()
+{
+   std::vector<uint8_t> stream;
+
+   for (size_t i = 0; i < can.m_frames.size(); i++)
+   {
+      const CanStub::Frame& f = can.m_frames[i];
+
+      ASSERT(f.canId == TLM_ID);
+      ASSERT((f.data[0] & 0x7F) == ((can.m_frames[0].data[0] + i) & 0x7F));
+      stream.insert(stream.end(), f.data.begin() + 1, f.data.begin() + f.len);
+   }
+   return stream;
+}
+
+static int Get16(const std::vector<uint8_t>& s, int pos)
+{
+   return (int16_t)(s[pos] | s[pos + 1] << 8);
+}
+
+static void TestOffSendsNothing()
+{
+   Run(10);
+   ASSERT(can.m_frames.empty());
+}
+
+static void TestCellRecord()
+{
+   Telemetry::Configure(Telemetry::TLM_CELLS, 25, TLM_ID);
+   fakeTime = 1000;
+   Run(1);
+
+   //6 byte header + count + 4 cells = 15 bytes in 3 frames
+   ASSERT(can.m_frames.size() == 3);
+   ASSERT(can.m_frames[0].data[0] & Telemetry::FLAG_FIRST);
+   ASSERT(!(can.m_frames[1].data[0] & Telemetry::FLAG_FIRST));
+   ASSERT(can.m_frames[2].len == 2);
+
+   std::vector<uint8_t> s = Reassemble();
+   ASSERT(s.size() == 15);
+   ASSERT(s[0] == 15);
+   ASSERT(s[1] == Telemetry::TLM_CELLS);
+   ASSERT((s[2] | s[3] << 8 | s[4] << 16 | s[5] << 24) == 1000);
+   ASSERT(s[6] == 4);
+   ASSERT(Get16(s, 7) == 3300);
+   ASSERT(Get16(s, 13) == 3303);
+}
+
+static void TestScaledChannels()
+{
+   Param::SetFloat(Param::idc, -12.34);
+   Param::SetFloat(Param::tempmin0, 21.5);
+   Param::SetFloat(Param::tempmax0, 24.25);
+   Param::SetInt(Param::u3cmd, 2);
+   Param::SetInt(Param::u15cmd, 3);
+   Telemetry::Configure(Telemetry::TLM_CURRENT | Telemetry::TLM_TEMPS | Telemetry::TLM_BALANCE, 25, TLM_ID);
+   Run(1);
+
+   std::vector<uint8_t> s = Reassemble();
+   ASSERT(s.size() == 16);
+   ASSERT(Get16(s, 6) == -123);
+   ASSERT(Get16(s, 8) == 215);
+   ASSERT(Get16(s, 10) == 243);
+   uint32_t balance = s[12] | s[13] << 8 | s[14] << 16 | (uint32_t)s[15] << 24;
+   ASSERT(balance == ((2u << 6) | (3u << 30)));
+}
+
+static void TestDecimation()
+{
+   Telemetry::Configure(Telemetry::TLM_CURRENT, 100, TLM_ID);
+   Run(40);
+
+   //10 records of 8 bytes, each sent on its own as soon as it is added
+   ASSERT(can.m_frames.size() == 20);
+   ASSERT(Reassemble().size() == 80);
+}
+
+static void TestOverrunDropsWholeRecords()
+{
+   Telemetry::Configure(Telemetry::TLM_ALL, 25, TLM_ID);
+   Param::SetInt(Param::numchan, 16);
+   uint32_t dropped = Telemetry::GetDropped();
+   Run(200);
+
+   //57 byte records every 25 ms need 9 frames per run, more than the bus share
+   ASSERT(Telemetry::GetDropped() > dropped);
+
+   std::vector<uint8_t> s = Reassemble();
+   size_t pos = 0;
+
+   //The last buffer may still be on its way
+   while (pos + 57 <= s.size())
+   {
+      ASSERT(s[pos] == 57);
+      ASSERT(s[pos + 1] == Telemetry::TLM_ALL);
+      pos += s[pos];
+   }
+   ASSERT(pos > 57 * 50);
+}
+
+static void TestModuleOffset()
+{
+   Telemetry::SetModule(3);
+   Telemetry::Configure(Telemetry::TLM_CURRENT, 25, TLM_ID);
+   Run(4);
+
+   ASSERT(can.m_frames.size() > 0);
+   for (size_t i = 0; i < can.m_frames.size(); i++)
+      ASSERT(can.m_frames[i].canId == TLM_ID + 3);
+}
+
+REGISTER_TEST(TelemetryTest, TestOffSendsNothing, TestCellRecord, TestScaledChannels, TestDecimation,
+              TestOverrunDropsWholeRecords, TestModuleOffset);
@@ -0,0 +1,70 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <math.h>
+#include "test.h"
+#include "temp_meas.h"
+
+class TempMeasTest: public UnitTest
+{
+   public:
+      TempMeasTest(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+};
+
+/** \brief Largest difference between table and beta equation from -40 °C up
+ *
+ * Digits below 10 read as an open sensor so they aren't checked.
+ */
+static float MaxErrorAgainstBeta(int nomRes, int beta)
+{
+   float maxError = 0;
+
+   for (int digit = 10; digit <= 4000; digit++)
+      if (TempMeas::AdcToTemperature(digit, nomRes, beta) >= -40)
+         maxError = fmaxf(maxError, fabsf(TempMeas::Lookup(digit) - TempMeas::AdcToTemperature(digit, nomRes, beta)));
+
+   return maxError;
+}
+
+static void TestBetaTable()
+{
+   TempMeas::CalculateBetaTable(10000, 3900);
+   ASSERT(MaxErrorAgainstBeta(10000, 3900) < 0.2f);
+
+   TempMeas::CalculateBetaTable(47000, 4050);
+   ASSERT(MaxErrorAgainstBeta(47000, 4050) < 0.2f);
+}
+
+static void TestCurveTable()
+{
+   //The default curve parameters are the 10k/3900 beta curve from -30 to 70 °C
+   const float resistance[] = { 192752, 102289, 56961, 33109, 19996, 12500, 8059, 5344, 3635, 2530, 1799 };
+
+   TempMeas::CalculateCurveTable(resistance, 11, -30, 10);
+   ASSERT(MaxErrorAgainstBeta(10000, 3900) < 0.2f);
+}
+
+static void TestOpenSensor()
+{
+   TempMeas::CalculateBetaTable(10000, 3900);
+   ASSERT(TempMeas::Lookup(0) < -273);
+   ASSERT(TempMeas::Lookup(-5) < -273);
+   ASSERT(fabsf(TempMeas::Lookup(5000) - TempMeas::AdcToTemperature(4095, 10000, 3900)) < 0.1f);
+}
+
+REGISTER_TEST(TempMeasTest, TestBetaTable, TestCurveTable, TestOpenSensor);
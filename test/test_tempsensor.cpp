@@ -0,0 +1,135 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <math.h>
+#include "test.h"
+#include "tempsensor.h"
+#include "temp_meas.h"
+
+class TempSensorTest: public UnitTest
+{
+   public:
+      TempSensorTest(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+      virtual void TestSetup();
+      virtual void TestCaseSetup();
+};
+
+//ADC readings of the 10k/3900 NTC
+#define DIGIT_25C    665
+#define DIGIT_40C    1138
+#define DIGIT_OPEN   0
+#define DIGIT_SHORT  4095
+
+static TempSensor sensor;
+
+void TempSensorTest::TestSetup()
+{
+   TempMeas::CalculateBetaTable(10000, 3900);
+}
+
+void TempSensorTest::TestCaseSetup()
+{
+   sensor.Reset();
+}
+
+/** \brief One 100 ms update with four samples like BmsIO does */
+static bool Update(int digit, int updates = 1)
+{
+   bool valid = false;
+
+   for (int i = 0; i < updates; i++)
+   {
+      for (int s = 0; s < 4; s++)
+         sensor.Sample(digit);
+      valid = sensor.Update();
+   }
+   return valid;
+}
+
+static void TestFirstUpdateValid()
+{
+   ASSERT(!sensor.Update());
+   ASSERT(Update(DIGIT_25C));
+   ASSERT(fabsf(sensor.Get() - 25) < 0.2f);
+   ASSERT(sensor.GetStatus() == TempSensor::SNS_OK);
+}
+
+static void TestAveraging()
+{
+   sensor.Sample(DIGIT_25C - 100);
+   sensor.Sample(DIGIT_25C + 100);
+   ASSERT(sensor.Update());
+   ASSERT(fabsf(sensor.Get() - 25) < 0.2f);
+}
+
+static void TestFilter()
+{
+   Update(DIGIT_25C);
+   //A 2 °C step passes the rate check, the filter lags behind
+   Update(712);
+   ASSERT(sensor.Get() > 25 && sensor.Get() < 26);
+   Update(712, 50);
+   ASSERT(fabsf(sensor.Get() - TempMeas::Lookup(712)) < 0.1f);
+}
+
+static void TestOpenSensor()
+{
+   Update(DIGIT_25C);
+   //Short dropouts keep the last value
+   ASSERT(Update(DIGIT_OPEN, 4));
+   ASSERT(fabsf(sensor.Get() - 25) < 0.2f);
+   ASSERT(!Update(DIGIT_OPEN));
+   ASSERT(sensor.GetStatus() == TempSensor::SNS_OPEN);
+}
+
+static void TestShortedSensor()
+{
+   Update(DIGIT_25C);
+   ASSERT(!Update(DIGIT_SHORT, 5));
+   ASSERT(sensor.GetStatus() == TempSensor::SNS_SHORT);
+}
+
+static void TestImplausible()
+{
+   //About 102 °C, not shorted yet but too hot for a battery
+   ASSERT(!Update(3990, 5));
+   ASSERT(sensor.GetStatus() == TempSensor::SNS_IMPLAUSIBLE);
+}
+
+static void TestRateGlitchDropped()
+{
+   Update(DIGIT_25C);
+   ASSERT(Update(DIGIT_40C, 2));
+   ASSERT(fabsf(sensor.Get() - 25) < 0.2f);
+   ASSERT(Update(DIGIT_25C));
+   ASSERT(sensor.GetStatus() == TempSensor::SNS_OK);
+}
+
+static void TestRecovery()
+{
+   Update(DIGIT_25C);
+   Update(DIGIT_OPEN, 5);
+   ASSERT(!Update(DIGIT_40C, 9));
+   ASSERT(Update(DIGIT_40C));
+   ASSERT(sensor.GetStatus() == TempSensor::SNS_OK);
+   //Restarts from the new reading rather than filtering up from 25 °C
+   ASSERT(fabsf(sensor.Get() - 40) < 0.2f);
+}
+
+REGISTER_TEST(TempSensorTest, TestFirstUpdateValid, TestAveraging, TestFilter, TestOpenSensor, TestShortedSensor,
+              TestImplausible, TestRateGlitchDropped, TestRecovery);
@@ -0,0 +1,272 @@
+/*
+ * This file is part of the FlyingAdcBms project.
+ *
+ * Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Golden frame tests for the VX1 encoders. The expected bytes pin down the
+ * current encoding, which was tuned against the dashboard and diagnostic
+ * tool. A change to any of them needs checking on a vehicle.
+ */
+#include "test.h"
+#include "fakeclock.h"
+#include "vx1.h"
+#include "params.h"
+#include "bmsfsm.h"
+#include "protection.h"
+#include "stub_canhardware.h"
+
+typedef std::array<uint8_t, 8> Golden;
+
+#define FEF2_ID     0x0CFEF240
+#define FEF3_ID     0x0CFEF340
+#define FEF4_ID     0x0CFEF440
+#define ODOMETER_ID 0x0CFEED80
+#define CLOCK_ID    0x0CFEECF9
+#define TELLTALE_ID 0x18FECA4C
+
+static uint32_t backupRegisters[11];
+volatile uint32_t* bkpRegs = backupRegisters;
+static CanStub can;
+
+class VX1Test: public UnitTest
+{
+   public:
+      VX1Test(const std::list<VoidFunction>* cases): UnitTest(cases) {}
+      virtual void TestCaseSetup();
+};
+
+void Param::Change(Param::PARAM_NUM)
+{
+}
+
+void VX1Test::TestCaseSetup()
+{
+   Param::LoadDefaults();
+   Param::SetInt(Param::VX1mode, 1);
+   Param::SetInt(Param::VX1enCanMsg, 1);
+   Param::SetInt(Param::VX1chrCellNo, 36);
+   Param::SetInt(Param::tempwarnhi, 55);
+   Param::SetInt(Param::tempwarnlo, 0);
+   Param::SetInt(Param::udeltawarn, 150);
+   Param::SetInt(Param::VX1mockTemp, 0);
+   Param::SetInt(Param::uptime, 0);
+   VX1::Initialize();
+   Protection::Reset();
+   UseFakeClock();
+   can.m_frames.clear();
+}
+
+/** \brief Let the protection levels settle on the current pack state like the main module does */
+static void EvaluateProtection()
+{
+   Protection::Evaluate();
+   fakeTime += 10000;
+   Protection::Evaluate();
+}
+
+static bool FrameIs(uint32_t id, const Golden& golden, int index = 0)
+{
+   return (int)can.m_frames.size() > index && can.m_frames[index].canId == id &&
+          can.m_frames[index].len == 8 && can.m_frames[index].data == golden;
+}
+
+static void SetPackState(float umin, float umax, float tempmin, float tempmax)
+{
+   Param::SetFloat(Param::umin, umin);
+   Param::SetFloat(Param::umax, umax);
+   Param::SetFloat(Param::tempmin, tempmin);
+   Param::SetFloat(Param::tempmax, tempmax);
+}
+
+static void TestFef2Normal()
+{
+   SetPackState(3650, 3750, 18, 24);
+   Param::SetFloat(Param::soc, 55.5);
+   Param::SetFloat(Param::utotal, 133200);
+   Param::SetFloat(Param::uavg, 3700);
+   Param::SetInt(Param::VX1FanDuty, 40);
+   Param::SetInt(Param::opmode, BmsFsm::RUN);
+
+   EvaluateProtection();
+   VX1::SendBmsPgn0xFEF2(&can);
+   ASSERT(FrameIs(FEF2_ID, { 0x2B, 0x02, 0x12, 0x18, 0x85, 0x28, 0x02, 0xFF }));
+}
+
+static void TestFef2MockTempError()
+{
+   SetPackState(3350, 3450, 18, 24);
+   Param::SetInt(Param::VX1mockTemp, -5);
+   Param::SetFloat(Param::soc, 0);
+   Param::SetFloat(Param::utotal, 122400);
+   Param::SetFloat(Param::uavg, 3400);
+   Param::SetInt(Param::VX1FanDuty, 0);
+   Param::SetInt(Param::opmode, BmsFsm::ERROR);
+
+   EvaluateProtection();
+   VX1::SendBmsPgn0xFEF2(&can);
+   ASSERT(FrameIs(FEF2_ID, { 0x00, 0x00, 0xFB, 0xFB, 0x7A, 0x00, 0x98, 0xFF }));
+}
+
+static void TestFef2HotFull()
+{
+   SetPackState(4100, 4180, 30, 60);
+   Param::SetFloat(Param::soc, 100);
+   Param::SetFloat(Param::utotal, 149400);
+   Param::SetFloat(Param::uavg, 4150);
+   Param::SetInt(Param::VX1FanDuty, 100);
+   Param::SetInt(Param::opmode, BmsFsm::IDLE);
+
+   EvaluateProtection();
+   VX1::SendBmsPgn0xFEF2(&can);
+   ASSERT(FrameIs(FEF2_ID, { 0xE8, 0x03, 0x1E, 0x3C, 0x95, 0x64, 0x65, 0xFF }));
+}
+
+static void TestFef3VoltageScaling()
+{
+   SetPackState(3841, 3873, 18, 24);
+
+   EvaluateProtection();
+   VX1::SendBmsPgn0xFEF3(&can, 1);
+   //umax * 0.667 = 2583, umin * 0.667 = 2561, cell numbers fixed at 1
+   ASSERT(FrameIs(FEF3_ID, { 0x12, 0x18, 0x00, 0x17, 0x1A, 0x01, 0x1A, 0x13 }));
+}
+
+static void TestFef3ClampAndHot()
+{
+   SetPackState(2500, 7000, -10, 60);
+
+   EvaluateProtection();
+   VX1::SendBmsPgn0xFEF3(&can, 20);
+   //High voltage clamped to 12 bit, module number to 4 bit, thermal switch HOT
+   ASSERT(FrameIs(FEF3_ID, { 0xF6, 0x3C, 0x00, 0xFF, 0x1F, 0x83, 0x16, 0xF4 }));
+}
+
+static void TestFef3MockTemp()
+{
+   SetPackState(3500, 3600, -10, 60);
+   Param::SetInt(Param::VX1mockTemp, 24);
+
+   EvaluateProtection();
+   VX1::SendBmsPgn0xFEF3(&can, 0);
+   ASSERT(FrameIs(FEF3_ID, { 0x18, 0x18, 0x00, 0x61, 0x19, 0x1E, 0x19, 0x03 }));
+}
+
+static void SetFef4State(float utotal, float udelta, float soc, float idc)
+{
+   Param::SetFloat(Param::utotal, utotal);
+   Param::SetFloat(Param::udelta, udelta);
+   Param::SetFloat(Param::soc, soc);
+   Param::SetFloat(Param::idc, idc);
+   Param::SetFloat(Param::chargelim, 50);
+   Param::SetFloat(Param::dischargelim, 100);
+}
+
+/** \brief Byte 3 bits 4-5 carry the running counter, it is tested separately */
+static Golden Fef4WithoutCounter()
+{
+   Golden data = can.m_frames.empty() ? Golden() : can.m_frames[0].data;
+   data[3] &= ~0x30;
+   return data;
+}
+
+static void TestFef4Normal()
+{
+   SetPackState(3650, 3750, 18, 24);
+   SetFef4State(133200, 100, 50, -20);
+   Param::SetInt(Param::opmode, BmsFsm::RUN);
+
+   EvaluateProtection();
+   VX1::SendBmsPgn0xFEF4(&can);
+   ASSERT(can.m_frames.size() == 1 && can.m_frames[0].canId == FEF4_ID);
+   ASSERT(Fef4WithoutCounter() == Golden({ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }));
+}
+
+static void TestFef4HighWarnings()
+{
+   SetPackState(3200, 4200, -5, 60);
+   SetFef4State(153000, 300, 101, 120);
+   Param::SetInt(Param::opmode, BmsFsm::ERROR);
+
+   EvaluateProtection();
+   VX1::SendBmsPgn0xFEF4(&can);
+   ASSERT(Fef4WithoutCounter() == Golden({ 0x51, 0x55, 0x41, 0x04, 0x01, 0x00, 0x00, 0x00 }));
+}
+
+static void TestFef4LowWarnings()
+{
+   SetPackState(3000, 3100, 18, 24);
+   SetFef4State(108000, 0, -1, -150);
+   Param::SetInt(Param::opmode, BmsFsm::RUN);
+
+   EvaluateProtection();
+   VX1::SendBmsPgn0xFEF4(&can);
+   ASSERT(Fef4WithoutCounter() == Golden({ 0x44, 0x00, 0x14, 0x01, 0x00, 0x00, 0x00, 0x00 }));
+}
+
+static void TestFef4RunningCounter()
+{
+   SetPackState(3650, 3750, 18, 24);
+   SetFef4State(133200, 100, 50, -20);
+
+   for (int i = 0; i < 5; i++)
+      VX1::SendBmsPgn0xFEF4(&can);
+
+   ASSERT(can.m_frames.size() == 5);
+   for (int i = 1; i < 5; i++)
+   {
+      int previous = (can.m_frames[i - 1].data[3] >> 4) & 3;
+      int current = (can.m_frames[i].data[3] >> 4) & 3;
+      ASSERT(current == ((previous + 1) & 3));
+   }
+}
+
+static void TestOdometer()
+{
+   VX1::SendOdometerMessage("OI FLY", &can);
+   ASSERT(FrameIs(ODOMETER_ID, { 0x6E, 0x38, 0x71, 0x00, 0x06, 0x3F, 0x00, 0xAA }));
+}
+
+static void TestOdometerDisabled()
+{
+   Param::SetInt(Param::VX1mode, 0);
+   ASSERT(!VX1::SendOdometerMessage("OI FLY", &can));
+   ASSERT(can.m_frames.empty());
+}
+
+static void TestClock()
+{
+   VX1::SetClockDisplay('0', '5', '+', '-', 0x43);
+   VX1::SendClockMessage(&can);
+   VX1::SendClockMessage(&can, 0xF9, false, false);
+
+   ASSERT(FrameIs(CLOCK_ID, { 0x3F, 0x6D, 0x70, 0x40, 0x00, 0x00, 0x43, 0xAA }, 0));
+   ASSERT(FrameIs(CLOCK_ID, { 0x3F, 0x6D, 0x70, 0x40, 0x00, 0x00, 0x43, 0x55 }, 1));
+}
+
+static void TestTelltales()
+{
+   VX1::SetTelltaleState(VX1::TelltaleType::WRENCH, VX1::TelltaleState::ON);
+   VX1::SetTelltaleState(VX1::TelltaleType::TEMP, VX1::TelltaleState::BLINKING);
+   VX1::SetTelltaleState(VX1::TelltaleType::BATTERY, VX1::TelltaleState::BLINKING);
+   VX1::SendTelltaleControl(&can);
+
+   ASSERT(FrameIs(TELLTALE_ID, { 0x29, 0x00, 0x00, 0x00, 0x33, 0x00, 0x32, 0x00 }));
+}
+
+REGISTER_TEST(VX1Test, TestFef2Normal, TestFef2MockTempError, TestFef2HotFull, TestFef3VoltageScaling,
+              TestFef3ClampAndHot, TestFef3MockTemp, TestFef4Normal, TestFef4HighWarnings, TestFef4LowWarnings,
+              TestFef4RunningCounter, TestOdometer, TestOdometerDisabled, TestClock, TestTelltales);
@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+#
+# This file is part of the FlyingAdcBms project.
+#
+# Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+"""Control the CAN trace recorder of a BMS module and dump it as candump log.
+
+Frames sent by the BMS are marked with a trailing T so that test/can_replay
+can use them as golden frames and replays only the received ones.
+
+  cantrace_dump.py --node 10 start          # ring buffer, keeps newest
+  cantrace_dump.py --node 10 oneshot        # stops when full, keeps oldest
+  cantrace_dump.py --node 10 dump trace.log # stops recording and reads out
+"""
+import argparse
+import struct
+import sys
+
+import can
+
+SDO_INDEX_CANTRACE = 0x5100
+SUB_MODE, SUB_COUNT, SUB_SELECT, SUB_TIME, SUB_ID, SUB_DATA0, SUB_DATA1 = range(7)
+MODE_STOPPED, MODE_RING, MODE_ONESHOT = range(3)
+FLAG_TX = 1 << 31
+
+
+class Sdo:
+    def __init__(self, bus, node, timeout):
+        self.bus = bus
+        self.node = node
+        self.timeout = timeout
+
+    def _request(self, cmd, sub, value=0):
+        data = struct.pack("<BHBI", cmd, SDO_INDEX_CANTRACE, sub, value)
+        self.bus.send(can.Message(arbitration_id=0x600 + self.node, data=data, is_extended_id=False))
+
+        while True:
+            msg = self.bus.recv(self.timeout)
+            if msg is None:
+                raise TimeoutError("no SDO reply from node %d" % self.node)
+            if msg.arbitration_id != 0x580 + self.node or len(msg.data) < 8:
+                continue
+            rcmd, index, rsub, rvalue = struct.unpack("<BHBI", bytes(msg.data[:8]))
+            if index != SDO_INDEX_CANTRACE or rsub != sub:
+                continue
+            if rcmd == 0x80:
+                raise IOError("SDO abort 0x%08x on sub index %d" % (rvalue, sub))
+            return rvalue
+
+    def read(self, sub):
+        return self._request(0x40, sub)
+
+    def write(self, sub, value):
+        self._request(0x23, sub, value)
+
+
+def dump(sdo, out):
+    sdo.write(SUB_MODE, MODE_STOPPED)
+    count = sdo.read(SUB_COUNT)
+    sdo.write(SUB_SELECT, 0)
+
+    for _ in range(count):
+        time = sdo.read(SUB_TIME)
+        canid = sdo.read(SUB_ID)
+        payload = struct.pack("<II", sdo.read(SUB_DATA0), sdo.read(SUB_DATA1))
+        ms = time & 0x0FFFFFFF
+        dlc = min(time >> 28, 8)
+        ident = canid & 0x1FFFFFFF
+        idstr = "%08X" % ident if ident > 0x7FF else "%03X" % ident
+
+        out.write("(%d.%06d) can0 %s#%s %s\n" % (ms // 1000, (ms % 1000) * 1000, idstr,
+                                               payload[:dlc].hex().upper(), "T" if canid & FLAG_TX else "R"))
+    return count
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--interface", default="socketcan")
+    parser.add_argument("--channel", default="can0")
+    parser.add_argument("--node", type=int, default=10, help="SDO node id of the module")
+    parser.add_argument("--timeout", type=float, default=0.5)
+    parser.add_argument("command", choices=["start", "oneshot", "stop", "dump"])
+    parser.add_argument("output", nargs="?", help="log file for dump, default stdout")
+    args = parser.parse_args()
+
+    with can.Bus(interface=args.interface, channel=args.channel) as bus:
+        sdo = Sdo(bus, args.node, args.timeout)
+
+        if args.command == "dump":
+            out = open(args.output, "w") if args.output else sys.stdout
+            count = dump(sdo, out)
+            if args.output:
+                out.close()
+            print("%d frames" % count, file=sys.stderr)
+        else:
+            mode = {"start": MODE_RING, "oneshot": MODE_ONESHOT, "stop": MODE_STOPPED}[args.command]
+            sdo.write(SUB_MODE, mode)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+#
+# This file is part of the FlyingAdcBms project.
+#
+# Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+"""Read out or clear the event log of a BMS module.
+
+  eventlog_dump.py --node 10 dump                       # all events
+  eventlog_dump.py --node 10 dump --code ERROR --from 60000
+  eventlog_dump.py --node 10 clear
+"""
+import argparse
+import struct
+
+import can
+
+SDO_INDEX_EVENTLOG = 0x5101
+SUB_COUNT, SUB_SELECT, SUB_CODES, SUB_FROM, SUB_TIME, SUB_DATA, SUB_CONTROL = range(7)
+CONTROL_FLUSH, CONTROL_CLEAR = 1, 2
+CODES = ["NONE", "BOOT", "STATE", "ERROR", "PROTECTION", "TEMPSENSOR"]
+STATES = ["BOOT", "GET_ADDR", "SET_ADDR", "REQ_INFO", "RECV_INFO", "INIT", "SELFTEST", "RUN", "IDLE", "ERROR"]
+
+
+class Sdo:
+    def __init__(self, bus, node, timeout):
+        self.bus = bus
+        self.node = node
+        self.timeout = timeout
+
+    def _request(self, cmd, sub, value=0):
+        data = struct.pack("<BHBI", cmd, SDO_INDEX_EVENTLOG, sub, value)
+        self.bus.send(can.Message(arbitration_id=0x600 + self.node, data=data, is_extended_id=False))
+
+        while True:
+            msg = self.bus.recv(self.timeout)
+            if msg is None:
+                raise TimeoutError("no SDO reply from node %d" % self.node)
+            if msg.arbitration_id != 0x580 + self.node or len(msg.data) < 8:
+                continue
+            rcmd, index, rsub, rvalue = struct.unpack("<BHBI", bytes(msg.data[:8]))
+            if index != SDO_INDEX_EVENTLOG or rsub != sub:
+                continue
+            if rcmd == 0x80:
+                raise IOError("SDO abort 0x%08x on sub index %d" % (rvalue, sub))
+            return rvalue
+
+    def read(self, sub):
+        return self._request(0x40, sub)
+
+    def write(self, sub, value):
+        self._request(0x23, sub, value)
+
+
+def describe(code, channel, value):
+    if code == CODES.index("STATE") and channel < len(STATES) and 0 <= value < len(STATES):
+        return "%s -> %s" % (STATES[channel], STATES[value])
+    return "channel %d value %d" % (channel, value)
+
+
+def dump(sdo, codes, since):
+    sdo.write(SUB_CONTROL, CONTROL_FLUSH)
+    sdo.write(SUB_CODES, sum(1 << CODES.index(c) for c in codes))
+    sdo.write(SUB_FROM, since)
+    sdo.write(SUB_SELECT, 0)
+    count = 0
+
+    while True:
+        try:
+            time = sdo.read(SUB_TIME)
+            data = sdo.read(SUB_DATA)
+        except IOError:
+            break  # no further matching event
+        code, source, value = data & 0xFF, (data >> 8) & 0xFF, struct.unpack("<h", struct.pack("<H", data >> 16))[0]
+        name = CODES[code] if code < len(CODES) else str(code)
+        print("%10.3f s  module %d  %-10s %s" % (time / 1000, source >> 4, name, describe(code, source & 0xF, value)))
+        count += 1
+    return count
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--interface", default="socketcan")
+    parser.add_argument("--channel", default="can0")
+    parser.add_argument("--node", type=int, default=10, help="SDO node id of the module")
+    parser.add_argument("--timeout", type=float, default=0.5)
+    parser.add_argument("--code", action="append", default=[], choices=CODES[1:], help="only show this code")
+    parser.add_argument("--from", dest="since", type=int, default=0, help="only show events from this time in ms")
+    parser.add_argument("command", choices=["dump", "clear"])
+    args = parser.parse_args()
+
+    with can.Bus(interface=args.interface, channel=args.channel) as bus:
+        sdo = Sdo(bus, args.node, args.timeout)
+
+        if args.command == "dump":
+            print("%d events" % dump(sdo, args.code, args.since))
+        else:
+            sdo.write(SUB_CONTROL, CONTROL_CLEAR)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+#
+# This file is part of the FlyingAdcBms project.
+#
+# Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+"""Firmware CRC inventory of a BMS stack.
+
+Reads the CRC of every flash page from each module and compares them with the
+pages of a firmware image. This shows which modules run a different firmware
+and where it differs, and after an update whether every module runs the image.
+
+  fw_crc.py --nodes 10-19 inventory stm32_bms.bin              # differing pages per module
+  fw_crc.py --nodes 10-19 inventory stm32_bms.bin -o crcs.json # same, saved as JSON
+  fw_crc.py --nodes 10-19 verify stm32_bms.bin                 # image CRC of each module
+"""
+import argparse
+import json
+import struct
+import sys
+
+import can
+
+SDO_INDEX_IMAGECRC = 0x5104
+SUB_PAGES, SUB_PAGESIZE, SUB_SELECT, SUB_PAGE, SUB_IMAGE = range(5)
+
+
+class Sdo:
+    def __init__(self, bus, node, timeout):
+        self.bus = bus
+        self.node = node
+        self.timeout = timeout
+
+    def _request(self, cmd, sub, value=0):
+        data = struct.pack("<BHBI", cmd, SDO_INDEX_IMAGECRC, sub, value)
+        self.bus.send(can.Message(arbitration_id=0x600 + self.node, data=data, is_extended_id=False))
+
+        while True:
+            msg = self.bus.recv(self.timeout)
+            if msg is None:
+                raise TimeoutError("no SDO reply from node %d" % self.node)
+            if msg.arbitration_id != 0x580 + self.node or len(msg.data) < 8:
+                continue
+            rcmd, index, rsub, rvalue = struct.unpack("<BHBI", bytes(msg.data[:8]))
+            if index != SDO_INDEX_IMAGECRC or rsub != sub:
+                continue
+            if rcmd == 0x80:
+                raise IOError("SDO abort 0x%08x on sub index %d" % (rvalue, sub))
+            return rvalue
+
+    def read(self, sub):
+        return self._request(0x40, sub)
+
+    def write(self, sub, value):
+        self._request(0x23, sub, value)
+
+
+def crc32(data):
+    """CRC-32/MPEG-2 over little endian words like the STM32 CRC unit"""
+    crc = 0xFFFFFFFF
+    for (word,) in struct.iter_unpack("<I", data):
+        crc ^= word
+        for _ in range(32):
+            crc = ((crc << 1) ^ 0x04C11DB7) & 0xFFFFFFFF if crc & 0x80000000 else (crc << 1) & 0xFFFFFFFF
+    return crc
+
+
+def parse_nodes(text):
+    nodes = []
+    for part in text.split(","):
+        first, _, last = part.partition("-")
+        nodes.extend(range(int(first), int(last or first) + 1))
+    return nodes
+
+
+def load_image(path, page_size, pages):
+    with open(path, "rb") as f:
+        image = f.read()
+    if len(image) > page_size * pages:
+        sys.exit("%s is %d bytes, the application area only holds %d" % (path, len(image), page_size * pages))
+    # The boot loader leaves the rest of the last page erased
+    padded = image + b"\xff" * (-len(image) % page_size)
+    return image, [padded[i:i + page_size] for i in range(0, len(padded), page_size)]
+
+
+def image_crc(image, pages):
+    """CRC over the image rounded up to whole words, as SUB_IMAGE computes it"""
+    length = (len(image) + 3) & ~3
+    return length, crc32(b"".join(pages)[:length])
+
+
+def page_crcs(sdo, count):
+    sdo.write(SUB_SELECT, 0)
+    return [sdo.read(SUB_PAGE) for _ in range(count)]
+
+
+def inventory(sdos, path, output):
+    page_size = sdos[0].read(SUB_PAGESIZE)
+    image, pages = load_image(path, page_size, sdos[0].read(SUB_PAGES))
+    wanted = [crc32(p) for p in pages]
+    nodes = {}
+
+    for sdo in sdos:
+        crcs = page_crcs(sdo, len(pages))
+        differ = [n for n, crc in enumerate(crcs) if crc != wanted[n]]
+        nodes[str(sdo.node)] = {"crcs": crcs, "differ": differ}
+        print("node %d: %d of %d pages differ %s" % (sdo.node, len(differ), len(pages),
+                                                      differ if len(differ) < 20 else ""))
+
+    if output:
+        with open(output, "w") as f:
+            json.dump({"image": path, "pagesize": page_size, "length": len(image), "crc": image_crc(image, pages)[1],
+                       "pages": wanted, "nodes": nodes}, f, indent=1)
+
+
+def verify(sdos, path):
+    page_size = sdos[0].read(SUB_PAGESIZE)
+    image, pages = load_image(path, page_size, sdos[0].read(SUB_PAGES))
+    length, wanted = image_crc(image, pages)
+    failed = 0
+
+    for sdo in sdos:
+        sdo.write(SUB_IMAGE, length)
+        if sdo.read(SUB_IMAGE) == wanted:
+            print("node %d: ok" % sdo.node)
+            continue
+        differ = [n for n, crc in enumerate(page_crcs(sdo, len(pages))) if crc != crc32(pages[n])]
+        print("node %d: CRC mismatch, pages %s differ" % (sdo.node, differ))
+        failed += 1
+    return failed
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--interface", default="socketcan")
+    parser.add_argument("--channel", default="can0")
+    parser.add_argument("--nodes", default="10", help="SDO node ids of the modules, e.g. 10-19 or 10,12")
+    parser.add_argument("--timeout", type=float, default=0.5)
+    parser.add_argument("-o", "--output", help="write the inventory as JSON")
+    parser.add_argument("command", choices=["inventory", "verify"])
+    parser.add_argument("image", help="new firmware, e.g. stm32_bms.bin")
+    args = parser.parse_args()
+
+    with can.Bus(interface=args.interface, channel=args.channel) as bus:
+        sdos = [Sdo(bus, node, args.timeout) for node in parse_nodes(args.nodes)]
+
+        if args.command == "inventory":
+            inventory(sdos, args.image, args.output)
+        elif verify(sdos, args.image) > 0:
+            sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
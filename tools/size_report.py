@@ -0,0 +1,286 @@
+#!/usr/bin/env python3
+#
+# This file is part of the FlyingAdcBms project.
+#
+# Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+"""Flash and RAM footprint report from the GNU ld map file.
+
+Prints flash and RAM usage per object file, per output section and the
+largest symbols. Since the firmware is built with -ffunction-sections and
+-fdata-sections every input section is a single function or variable.
+
+  size_report.py linker.map
+  size_report.py linker.map --flash-budget 118k --ram-budget 18k
+  size_report.py linker.map --baseline obj/size.json --save obj/size.json
+
+With --baseline the growth per object against a previous run is printed.
+The exit code is 1 when a budget is exceeded.
+"""
+import argparse
+import json
+import os
+import re
+import shutil
+import subprocess
+import sys
+
+FLASH_START, FLASH_END = 0x08000000, 0x08100000
+RAM_START, RAM_END = 0x20000000, 0x20100000
+
+OUTPUT_RE = re.compile(r"^(\.[\w.]+)(?:\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)(?:\s+load address 0x([0-9a-f]+))?)?\s*$")
+INPUT_RE = re.compile(r"^ (\.[^\s]+|COMMON)(?:\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S.*))?\s*$")
+CONT_RE = re.compile(r"^\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S.*)$")
+FILL_RE = re.compile(r"^ \*fill\*\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)")
+SYMBOL_RE = re.compile(r"^\s+0x([0-9a-f]+)\s+([A-Za-z_][\w.$]*)\s*$")
+
+
+def in_flash(addr):
+    return FLASH_START <= addr < FLASH_END
+
+
+def in_ram(addr):
+    return RAM_START <= addr < RAM_END
+
+
+def object_name(path):
+    """obj/vx1.o -> vx1.o, libopencm3_stm32f1.a(vector.o) -> libopencm3_stm32f1.a(vector.o)"""
+    return os.path.basename(path.strip())
+
+
+def symbol_name(section, symbols):
+    """Prefer the symbol defined in the input section, otherwise strip the section prefix"""
+    if len(symbols) == 1:
+        return symbols[0]
+    if section.startswith(".rodata.str"):
+        return "(string literals)"
+    for prefix in (".text.", ".rodata.", ".data.", ".bss."):
+        if section.startswith(prefix) and len(section) > len(prefix):
+            return section[len(prefix):]
+    return section
+
+
+def parse_map(lines):
+    """Returns a list of output sections and a list of input sections.
+
+    Output: dict(name, addr, size, lma)
+    Input:  dict(output, name, addr, size, object, symbols)
+    """
+    outputs = []
+    inputs = []
+    current = None
+    pending = None   # output or input section name whose numbers wrapped
+    last = None
+    started = False
+
+    for line in lines:
+        line = line.rstrip("\n")
+
+        if not started:
+            started = line.startswith("Linker script and memory map")
+            continue
+
+        if pending is not None:
+            kind, name = pending
+            pending = None
+            m = CONT_RE.match(line)
+            if kind == "output":
+                m = re.match(r"^\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)(?:\s+load address 0x([0-9a-f]+))?", line)
+                if m:
+                    current = dict(name=name, addr=int(m.group(1), 16), size=int(m.group(2), 16),
+                                   lma=int(m.group(3), 16) if m.group(3) else None)
+                    outputs.append(current)
+                continue
+            if m and current is not None:
+                last = dict(output=current["name"], name=name, addr=int(m.group(1), 16),
+                            size=int(m.group(2), 16), object=object_name(m.group(3)), symbols=[])
+                inputs.append(last)
+            continue
+
+        m = OUTPUT_RE.match(line)
+        if m:
+            if m.group(2) is None:
+                pending = ("output", m.group(1))
+            else:
+                current = dict(name=m.group(1), addr=int(m.group(2), 16), size=int(m.group(3), 16),
+                               lma=int(m.group(4), 16) if m.group(4) else None)
+                outputs.append(current)
+            last = None
+            continue
+
+        m = INPUT_RE.match(line)
+        if m and current is not None:
+            if m.group(2) is None:
+                pending = ("input", m.group(1))
+            else:
+                last = dict(output=current["name"], name=m.group(1), addr=int(m.group(2), 16),
+                            size=int(m.group(3), 16), object=object_name(m.group(4)), symbols=[])
+                inputs.append(last)
+            continue
+
+        m = FILL_RE.match(line)
+        if m and current is not None:
+            inputs.append(dict(output=current["name"], name="*fill*", addr=int(m.group(1), 16),
+                               size=int(m.group(2), 16), object="*fill*", symbols=[]))
+            last = None
+            continue
+
+        m = SYMBOL_RE.match(line)
+        if m and last is not None and not m.group(2).startswith("."):
+            last["symbols"].append(m.group(2))
+
+    return outputs, inputs
+
+
+def classify(outputs, inputs):
+    """Sum up flash and RAM per output section and per object"""
+    by_name = {o["name"]: o for o in outputs}
+    sections = {}
+    objects = {}
+    symbols = []
+
+    for o in outputs:
+        if o["size"] == 0:
+            continue
+        flash = o["size"] if in_flash(o["addr"]) or (o["lma"] is not None and in_flash(o["lma"])) else 0
+        ram = o["size"] if in_ram(o["addr"]) else 0
+        if flash or ram:
+            sections[o["name"]] = dict(flash=flash, ram=ram)
+
+    for i in inputs:
+        out = by_name.get(i["output"])
+        if i["size"] == 0 or out is None or out["name"] not in sections:
+            continue
+        flash = i["size"] if sections[out["name"]]["flash"] else 0
+        ram = i["size"] if sections[out["name"]]["ram"] else 0
+        entry = objects.setdefault(i["object"], dict(flash=0, ram=0, sections={}))
+        entry["flash"] += flash
+        entry["ram"] += ram
+        entry["sections"][out["name"]] = entry["sections"].get(out["name"], 0) + i["size"]
+        if i["object"] != "*fill*":
+            symbols.append(dict(name=symbol_name(i["name"], i["symbols"]), object=i["object"],
+                                section=out["name"], flash=flash, ram=ram))
+
+    return sections, objects, symbols
+
+
+def demangle(names):
+    tool = shutil.which("arm-none-eabi-c++filt") or shutil.which("c++filt")
+    if not tool or not names:
+        return names
+    try:
+        result = subprocess.run([tool], input="\n".join(names), capture_output=True, text=True, check=True)
+        demangled = result.stdout.splitlines()
+        return demangled if len(demangled) == len(names) else names
+    except (OSError, subprocess.CalledProcessError):
+        return names
+
+
+def parse_size(text):
+    """Accepts 122880, 0x1e000, 120k or 120K"""
+    text = text.strip().lower()
+    if text.endswith("k"):
+        return int(float(text[:-1]) * 1024)
+    return int(text, 0)
+
+
+def delta(value, previous):
+    if previous is None:
+        return ""
+    diff = value - previous
+    return "%+7d" % diff if diff else "       "
+
+
+def report(sections, objects, symbols, top, baseline, out):
+    prev_objects = baseline.get("objects", {}) if baseline else {}
+    prev_sections = baseline.get("sections", {}) if baseline else {}
+
+    out.write("Sections                    flash      ram\n")
+    for name, s in sorted(sections.items(), key=lambda kv: -(kv[1]["flash"] + kv[1]["ram"])):
+        p = prev_sections.get(name)
+        growth = delta(s["flash"] + s["ram"], p["flash"] + p["ram"] if p else 0) if baseline else ""
+        out.write("  %-22s %8d %8d %s\n" % (name, s["flash"], s["ram"], growth))
+
+    out.write("\nObjects                             flash      ram  sections\n")
+    for name, o in sorted(objects.items(), key=lambda kv: -kv[1]["flash"]):
+        detail = " ".join("%s=%d" % kv for kv in sorted(o["sections"].items(), key=lambda kv: -kv[1]))
+        p = prev_objects.get(name)
+        growth = delta(o["flash"] + o["ram"], p["flash"] + p["ram"] if p else 0) if baseline else ""
+        out.write("  %-32s %8d %8d  %s %s\n" % (name[-32:], o["flash"], o["ram"], growth, detail))
+    if baseline:
+        for name in sorted(set(prev_objects) - set(objects)):
+            p = prev_objects[name]
+            out.write("  %-32s %8d %8d  %s removed\n" % (name[-32:], 0, 0, delta(0, p["flash"] + p["ram"])))
+
+    largest = sorted(symbols, key=lambda s: -(s["flash"] + s["ram"]))[:top]
+    names = demangle([s["name"] for s in largest])
+    out.write("\nLargest %d symbols\n" % len(largest))
+    for s, name in zip(largest, names):
+        out.write("  %6d %-8s %-20s %s\n" % (s["flash"] or s["ram"], s["section"], s["object"][-20:], name[:90]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("mapfile", help="map file written by the linker")
+    parser.add_argument("--flash-budget", type=parse_size, help="maximum flash usage in bytes, e.g. 118k")
+    parser.add_argument("--ram-budget", type=parse_size, help="maximum static RAM usage in bytes, e.g. 18k")
+    parser.add_argument("--top", type=int, default=25, help="number of largest symbols to list")
+    parser.add_argument("--baseline", help="JSON summary of a previous run to diff against")
+    parser.add_argument("--save", help="write a JSON summary of this run")
+    args = parser.parse_args()
+
+    with open(args.mapfile) as f:
+        outputs, inputs = parse_map(f)
+
+    if not outputs:
+        print("%s: no memory map found" % args.mapfile, file=sys.stderr)
+        return 2
+
+    sections, objects, symbols = classify(outputs, inputs)
+
+    baseline = None
+    if args.baseline and os.path.exists(args.baseline):
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+
+    flash = sum(s["flash"] for s in sections.values())
+    ram = sum(s["ram"] for s in sections.values())
+    report(sections, objects, symbols, args.top, baseline, sys.stdout)
+
+    print("\nTotal flash %d bytes%s, static RAM %d bytes%s" % (
+        flash, " (%+d)" % (flash - baseline["flash"]) if baseline else "",
+        ram, " (%+d)" % (ram - baseline["ram"]) if baseline else ""))
+
+    if args.save:
+        with open(args.save, "w") as f:
+            json.dump(dict(flash=flash, ram=ram, sections=sections,
+                           objects={k: dict(flash=v["flash"], ram=v["ram"]) for k, v in objects.items()}),
+                      f, indent=1, sort_keys=True)
+
+    failed = False
+    for what, used, budget in (("flash", flash, args.flash_budget), ("RAM", ram, args.ram_budget)):
+        if budget is None:
+            continue
+        print("%-5s budget %d bytes, %d bytes (%.1f%%) used, %d left" % (
+            what, budget, used, 100.0 * used / budget, budget - used))
+        if used > budget:
+            print("error: %s budget exceeded by %d bytes" % (what, used - budget), file=sys.stderr)
+            failed = True
+
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
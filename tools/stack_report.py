@@ -0,0 +1,192 @@
+#!/usr/bin/env python3
+#
+# This file is part of the FlyingAdcBms project.
+#
+# Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+"""Worst case stack depth from the gcc -fcallgraph-info=su output.
+
+Every .ci file holds the stack frame of each function of one translation
+unit and the calls it makes. The deepest path below each given task is
+searched and printed.
+
+  stack_report.py --isr tim2_isr --task Ms100Task --task main obj/*.ci
+
+Since the scheduler runs the tasks from the timer interrupt, each task is
+also shown with the frames of the ISR and the 32 byte exception frame on
+top. The main stack needs the worst case of main plus the deepest task.
+
+The result is a lower bound when the path contains
+  indirect  calls through function pointers or virtual methods, unless
+            resolved with --indirect
+  extern    calls into functions without call graph info (libopencm3,
+            libgcc), counted as 0
+  dynamic   alloca or variable length arrays
+  recursive recursion, counted once
+"""
+import argparse
+import re
+import sys
+
+EXCEPTION_FRAME = 32
+
+NODE_RE = re.compile(r'^node: \{ title: "([^"]+)" label: "([^"]*)"(.*)\}')
+EDGE_RE = re.compile(r'^edge: \{ sourcename: "([^"]+)" targetname: "([^"]+)"')
+SIZE_RE = re.compile(r"(\d+) bytes \(([\w,]+)\)")
+
+
+def short_name(label):
+    """'void BmsIO::MeasureCurrent()\\nfile:1:2\\n..' -> 'BmsIO::MeasureCurrent'"""
+    decl = label.split("\\n")[0]
+    decl = decl.split("(")[0].strip()
+    return decl.split(" ")[-1] if decl else decl
+
+
+class CallGraph:
+    def __init__(self):
+        self.functions = {}  # title -> dict(name, bytes, qualifier)
+        self.calls = {}      # title -> set of titles
+
+    def load(self, path):
+        with open(path) as f:
+            for line in f:
+                m = NODE_RE.match(line)
+                if m:
+                    size = SIZE_RE.search(m.group(2))
+                    if size:
+                        self.functions[m.group(1)] = dict(name=short_name(m.group(2)), bytes=int(size.group(1)),
+                                                          qualifier=size.group(2))
+                    continue
+                m = EDGE_RE.match(line)
+                if m:
+                    self.calls.setdefault(m.group(1), set()).add(m.group(2))
+
+    def find(self, name):
+        return [t for t, f in self.functions.items() if f["name"] == name or t == name]
+
+    def resolve_indirect(self, suffixes):
+        """Titles of all functions an indirect call may end up in"""
+        return [t for t, f in self.functions.items() if any(f["name"].endswith(s) for s in suffixes)]
+
+
+class Analyzer:
+    def __init__(self, graph, indirect):
+        self.graph = graph
+        self.indirect = indirect
+        self.memo = {}
+
+    def worst(self, title, active=()):
+        """Returns (bytes, path, flags) of the deepest call chain starting at title"""
+        if title in self.memo:
+            return self.memo[title]
+        if title in active:
+            return 0, [], {"recursive"}
+        function = self.graph.functions.get(title)
+        if function is None:
+            return 0, [], {"extern"}
+
+        flags = set()
+        if function["qualifier"] != "static":
+            flags.add("dynamic")
+        best = (0, [])
+        for callee in sorted(self.graph.calls.get(title, ())):
+            if callee == "__indirect_call":
+                if not self.indirect:
+                    flags.add("indirect")
+                targets = self.indirect
+            else:
+                targets = [callee]
+            for target in targets:
+                depth, path, subflags = self.worst(target, active + (title,))
+                flags |= subflags
+                if depth > best[0]:
+                    best = (depth, path)
+
+        result = (function["bytes"] + best[0], [title] + best[1], flags)
+        if not active or "recursive" not in flags:
+            self.memo[title] = result
+        return result
+
+    def describe(self, path):
+        return " > ".join("%s (%d)" % (self.graph.functions[t]["name"], self.graph.functions[t]["bytes"])
+                          for t in path)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("files", nargs="+", help=".ci files written by -fcallgraph-info=su")
+    parser.add_argument("--task", action="append", default=[], help="function to report, may be repeated")
+    parser.add_argument("--isr", help="interrupt handler the tasks are called from")
+    parser.add_argument("--indirect", action="append", default=[],
+                        help="name suffix of functions an indirect call may go to, e.g. ::Send")
+    parser.add_argument("--top", type=int, default=15, help="number of largest frames to list")
+    args = parser.parse_args()
+
+    graph = CallGraph()
+    for path in args.files:
+        graph.load(path)
+
+    if not graph.functions:
+        print("no call graph info found, build with -fcallgraph-info=su (gcc 10 or later)", file=sys.stderr)
+        return 2
+
+    analyzer = Analyzer(graph, graph.resolve_indirect(args.indirect))
+    isrDepth = 0
+
+    if args.isr:
+        titles = graph.find(args.isr)
+        if titles:
+            #The ISR frames without following the indirect call into the tasks
+            isrDepth, path, flags = Analyzer(graph, []).worst(titles[0])
+            flags = flags - {"indirect"}
+            print("ISR %s: %d bytes + %d exception frame %s" % (args.isr, isrDepth, EXCEPTION_FRAME,
+                                                                 " ".join(sorted(flags))))
+            print("  %s\n" % analyzer.describe(path))
+            isrDepth += EXCEPTION_FRAME
+        else:
+            print("ISR %s not found\n" % args.isr, file=sys.stderr)
+
+    print("%-28s %6s %6s %7s  %s" % ("Task", "own", "worst", "in ISR", "lower bound because of"))
+    deepestTask = 0
+    mainDepth = None
+    for task in args.task:
+        titles = graph.find(task)
+        if not titles:
+            print("%-28s not found" % task)
+            continue
+        depth, path, flags = analyzer.worst(titles[0])
+        own = graph.functions[titles[0]]["bytes"]
+        if task == "main":
+            mainDepth = depth
+            print("%-28s %6d %6d %7s  %s" % (task, own, depth, "", " ".join(sorted(flags))))
+        else:
+            deepestTask = max(deepestTask, depth + isrDepth)
+            print("%-28s %6d %6d %7d  %s" % (task, own, depth, depth + isrDepth, " ".join(sorted(flags))))
+        print("  %s" % analyzer.describe(path))
+
+    if mainDepth is not None and deepestTask:
+        print("\nMain stack needs at least %d bytes (main %d + deepest task in ISR %d)" % (
+            mainDepth + deepestTask, mainDepth, deepestTask))
+
+    print("\nLargest stack frames")
+    largest = sorted(graph.functions.values(), key=lambda f: -f["bytes"])[:args.top]
+    for f in largest:
+        print("  %6d %-8s %s" % (f["bytes"], f["qualifier"] if f["qualifier"] != "static" else "", f["name"]))
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,171 @@
+#!/usr/bin/env python3
+#
+# This file is part of the FlyingAdcBms project.
+#
+# Copyright (C) 2025 Johannes Huebner <dev@johanneshuebner.com>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+"""Decode the binary telemetry stream of a BMS module to CSV.
+
+The stream is read from a candump log, e.g. "candump -L can0,7C0:7C0 > tlm.log",
+or straight from the bus with --live. Set the parameters tlmchan, tlmrate and
+tlmcanid on the module to start the stream. Each module sends on tlmcanid plus
+its index, --module selects which one is decoded.
+
+  tlm2csv.py tlm.log > tlm.csv
+  tlm2csv.py --live --canid 0x7C0 --module 2 tlm.csv
+"""
+import argparse
+import re
+import struct
+import sys
+
+FLAG_FIRST = 0x80
+TLM_CELLS, TLM_CURRENT, TLM_TEMPS, TLM_BALANCE, TLM_SOC = 1, 2, 4, 8, 16
+LOGLINE = re.compile(r"\(([\d.]+)\)\s+\S+\s+([0-9A-Fa-f]+)#([0-9A-Fa-f]*)")
+
+
+class Decoder:
+    """Reassembles records from frames and writes one CSV row per record"""
+
+    def __init__(self, out):
+        self.out = out
+        self.buf = bytearray()
+        self.expected = None
+        self.synced = False
+        self.header = None
+        self.records = 0
+        self.lost = 0
+
+    def frame(self, data):
+        if not data:
+            return
+        seq = data[0] & 0x7F
+
+        if self.expected is not None and seq != self.expected:
+            self.lost += (seq - self.expected) & 0x7F
+            self.synced = False
+        self.expected = (seq + 1) & 0x7F
+
+        if data[0] & FLAG_FIRST:
+            self.buf = bytearray()
+            self.synced = True
+        if not self.synced:
+            return
+
+        self.buf += data[1:]
+
+        while self.buf and len(self.buf) >= self.buf[0]:
+            length = self.buf[0]
+            if length < 6:
+                #Garbage, wait for the start of the next buffer
+                self.synced = False
+                self.buf = bytearray()
+                return
+            self.record(bytes(self.buf[:length]))
+            del self.buf[:length]
+
+    def record(self, rec):
+        mask, time = struct.unpack_from("<BI", rec, 1)
+        pos = 6
+        names, values = ["time_ms"], [time]
+
+        if mask & TLM_CELLS:
+            count = rec[pos]
+            cells = struct.unpack_from("<%dH" % count, rec, pos + 1)
+            pos += 1 + 2 * count
+            names += ["u%d" % i for i in range(count)]
+            values += list(cells)
+        if mask & TLM_CURRENT:
+            (idc,) = struct.unpack_from("<h", rec, pos)
+            pos += 2
+            names.append("idc")
+            values.append(idc / 10)
+        if mask & TLM_TEMPS:
+            tmin, tmax = struct.unpack_from("<hh", rec, pos)
+            pos += 4
+            names += ["tempmin", "tempmax"]
+            values += [tmin / 10, tmax / 10]
+        if mask & TLM_BALANCE:
+            (bal,) = struct.unpack_from("<I", rec, pos)
+            pos += 4
+            names += ["u%dcmd" % i for i in range(16)]
+            values += [(bal >> (2 * i)) & 3 for i in range(16)]
+        if mask & TLM_SOC:
+            soc, soh, idcavg, tcore = struct.unpack_from("<hhhh", rec, pos)
+            pos += 8
+            names += ["soc", "soh", "idcavg", "tempcore"]
+            values += [soc / 100, soh / 10, idcavg / 10, tcore / 10]
+
+        #A new channel set starts a new table
+        if names != self.header:
+            self.header = names
+            self.out.write(",".join(names) + "\n")
+        self.out.write(",".join(str(v) for v in values) + "\n")
+        self.records += 1
+
+
+def read_log(infile, canid):
+    for line in infile:
+        match = LOGLINE.match(line.strip())
+        if match and int(match.group(2), 16) == canid:
+            yield bytes.fromhex(match.group(3))
+
+
+def read_bus(interface, channel, canid):
+    import can
+
+    with can.Bus(interface=interface, channel=channel,
+                 can_filters=[{"can_id": canid, "can_mask": 0x7FF}]) as bus:
+        try:
+            while True:
+                msg = bus.recv()
+                if msg is not None and msg.arbitration_id == canid:
+                    yield bytes(msg.data)
+        except KeyboardInterrupt:
+            return
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--canid", type=lambda x: int(x, 0), default=0x7C0, help="value of tlmcanid")
+    parser.add_argument("--module", type=int, default=0, help="module index, added to --canid")
+    parser.add_argument("--live", action="store_true", help="read from the bus instead of a log")
+    parser.add_argument("--interface", default="socketcan")
+    parser.add_argument("--channel", default="can0")
+    parser.add_argument("input", nargs="?", help="candump log, default stdin")
+    parser.add_argument("output", nargs="?", help="CSV file, default stdout")
+    args = parser.parse_args()
+    canid = args.canid + args.module
+
+    if args.live:
+        args.output = args.output or args.input
+        frames = read_bus(args.interface, args.channel, canid)
+    else:
+        infile = open(args.input) if args.input else sys.stdin
+        frames = read_log(infile, canid)
+
+    out = open(args.output, "w") if args.output else sys.stdout
+    decoder = Decoder(out)
+
+    for data in frames:
+        decoder.frame(data)
+
+    if args.output:
+        out.close()
+    print("%d records, %d frames lost" % (decoder.records, decoder.lost), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()